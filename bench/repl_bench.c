@@ -0,0 +1,292 @@
+/* Бенчмарк репликации по loopback: N узлов в одном процессе, общий(е) NetPoller.
+ *
+ *   leader — узел 0: replicator_create_leader_tcp, остальные — client_tcp к нему;
+ *   mesh   — узел 0 слушает, остальные — crdt_mesh с seed 127.0.0.1:<port> (звезда).
+ *
+ * Узлы публикуют операции по кругу (смесь: вставки текста / дельты виджетов /
+ * метаданные промпта), не более -w неподтверждённых одновременно. Операция
+ * подтверждена, когда её доставили слушателям всех остальных узлов; время от
+ * publish до этого момента — confirm latency.
+ *
+ *   make bench BENCH_ARGS="-t mesh -n 8 -o 200000"
+ *
+ * Ключи:
+ *   -t leader|mesh|all   транспорт (all)
+ *   -n N                 узлов, 2..64 (4)
+ *   -o OPS               операций на прогон (100000)
+ *   -w WINDOW            максимум неподтверждённых (1024)
+ *   -b BATCH             publish за итерацию петли (64)
+ *   -m T:D:M             доли вставок текста / дельт / prompt meta (70:25:5)
+ *   -s BYTES             длина текста во вставке (32)
+ *   -p POLLERS           число NetPoller, узлы раскладываются по кругу (1)
+ *   -P PORT              базовый порт (47310)
+ */
+#include "core/perf.h"
+#include "net/net.h"
+#include "net/tcp.h"
+#include "net/wire_tcp.h"
+#include "replication/repl_iface.h"
+#include "replication/backends/leader_tcp.h"
+#include "replication/backends/client_tcp.h"
+#include "replication/backends/crdt_mesh.h"
+#include "common/conop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define BENCH_MAX_NODES   64
+#define BENCH_MAX_POLLERS 16
+#define BENCH_CONSOLE_ID  0xBE7Cu
+/* сколько ждём соединения и хвост подтверждений */
+#define BENCH_SETUP_MS    5000
+#define BENCH_DRAIN_MS    10000
+
+typedef struct {
+    const char* transport;
+    int      nodes, pollers;
+    uint64_t ops;
+    int      window, batch;
+    int      mix[3];      /* text, delta, meta */
+    int      text_len;
+    uint16_t port;
+} BenchCfg;
+
+typedef struct {
+    uint64_t t_pub;       /* perf_now_ns() при publish; 0 — слот свободен */
+    int      left;        /* сколько узлов ещё не получили */
+} Pend;
+
+typedef struct Bench Bench;
+typedef struct {
+    Bench*      b;
+    int         idx;
+    Replicator* r;
+    NetPoller*  np;
+    uint32_t    seq;      /* счётчик op_id узла, как в console_sink */
+} Node;
+
+struct Bench {
+    BenchCfg   cfg;
+    NetPoller* np[BENCH_MAX_POLLERS];
+    Node       node[BENCH_MAX_NODES];
+    Pend*      pend;      /* по глобальному номеру-1 (едет в op->hlc) */
+    uint64_t   published, confirmed, in_flight, deliveries, stray;
+    int        lat_slot;
+};
+
+static uint32_t now_ms(void){ return (uint32_t)(perf_now_ns() / 1000000u); }
+
+static void tick_all(Bench* b){
+    uint32_t t = now_ms();
+    for (int i=0;i<b->cfg.pollers;i++) net_poller_tick(b->np[i], t, 0);
+    cow1tcp_flush_pending();
+}
+
+/* Слушатель узла: учёт доставки */
+static void on_confirm(void* user, const ConOp* op){
+    Node* n = (Node*)user; Bench* b = n->b;
+    if (!op || op->console_id != BENCH_CONSOLE_ID) return;
+    if ((int)op->actor_id == n->idx) return;                /* своё эхо (leader ретранслирует и автору) */
+    if (op->hlc == 0 || op->hlc > b->published){ b->stray++; return; }
+    Pend* p = &b->pend[op->hlc - 1];
+    if (!p->t_pub || p->left <= 0){ b->stray++; return; }  /* повтор */
+    b->deliveries++;
+    if (--p->left == 0){
+        perf_record(b->lat_slot, perf_now_ns() - p->t_pub);
+        b->confirmed++; b->in_flight--;
+    }
+}
+
+/* Следующая операция по смеси (seq — глобальный номер); payload'ы живут до конца publish */
+static void make_op(Bench* b, uint64_t seq, ConOp* op, char* text, uint8_t* delta){
+    memset(op, 0, sizeof(*op));
+    op->topic = (TopicId){ .type_id = 1u, .inst_id = BENCH_CONSOLE_ID };
+    op->console_id = BENCH_CONSOLE_ID;
+    op->hlc = seq;
+    int total = b->cfg.mix[0] + b->cfg.mix[1] + b->cfg.mix[2];
+    int k = (int)((seq * 2654435761u) % (uint64_t)(total > 0 ? total : 1));
+    if (k < b->cfg.mix[0]){
+        op->type = CON_OP_INSERT_TEXT;
+        op->new_item_id = seq;
+        op->parent_left = seq - 1;
+        op->pos.depth = 2;
+        op->pos.comp[0].digit = (uint16_t)(seq >> 16); op->pos.comp[0].actor = 1;
+        op->pos.comp[1].digit = (uint16_t)seq;         op->pos.comp[1].actor = 1;
+        for (int i=0;i<b->cfg.text_len;i++) text[i] = (char)('a' + (seq + (uint64_t)i) % 26);
+        op->data = text; op->size = (size_t)b->cfg.text_len;
+    } else if (k < b->cfg.mix[0] + b->cfg.mix[1]){
+        op->type = CON_OP_WIDGET_DELTA;
+        op->widget_id = 1 + seq % 8;
+        op->tag = "color";
+        delta[0] = (uint8_t)seq; delta[1] = (uint8_t)(seq >> 8); delta[2] = 0; delta[3] = 0xFF;
+        op->data = delta; op->size = 4;
+    } else {
+        op->type = CON_OP_PROMPT_META;
+        op->prompt_edits_inc = 1;
+        op->prompt_nonempty = (int32_t)(seq & 1);
+    }
+}
+
+static int all_connected(Bench* b, int mesh){
+    if (mesh){
+        int peers = 0, listen = 0, topics = 0;
+        repl_crdt_mesh_stat(b->node[0].r, &peers, &listen, &topics);
+        if (peers < b->cfg.nodes - 1) return 0;
+        for (int i=1;i<b->cfg.nodes;i++){
+            repl_crdt_mesh_stat(b->node[i].r, &peers, &listen, &topics);
+            if (peers < 1) return 0;
+        }
+        return 1;
+    }
+    for (int i=1;i<b->cfg.nodes;i++) if (!repl_client_tcp_is_connected(b->node[i].r)) return 0;
+    return 1;
+}
+
+static void bench_teardown(Bench* b){
+    /* клиенты раньше лидера — чтобы не ловить их закрытие в его поллере */
+    for (int i=b->cfg.nodes-1;i>=0;i--){ replicator_destroy(b->node[i].r); b->node[i].r = NULL; }
+    for (int i=0;i<b->cfg.pollers;i++){ if (b->np[i]) net_poller_destroy(b->np[i]); b->np[i] = NULL; }
+    free(b->pend); b->pend = NULL;
+}
+
+/* Один прогон; 0 — ок */
+static int bench_run(const BenchCfg* cfg, const char* transport){
+    int mesh = strcmp(transport, "mesh") == 0;
+    Bench* b = (Bench*)calloc(1, sizeof(Bench));
+    if (!b) return -1;
+    b->cfg = *cfg;
+    b->pend = (Pend*)calloc((size_t)cfg->ops, sizeof(Pend));
+    char slot_name[32];
+    snprintf(slot_name, sizeof(slot_name), "%s.confirm", transport);
+    b->lat_slot = perf_slot(slot_name);
+    int rc = -1;
+    if (!b->pend) goto out;
+
+    for (int i=0;i<cfg->pollers;i++) if (!(b->np[i] = net_poller_create())) goto out;
+
+    char seed[64];
+    snprintf(seed, sizeof(seed), "127.0.0.1:%u", (unsigned)cfg->port);
+    const char* seeds[1] = { seed };
+    for (int i=0;i<cfg->nodes;i++){
+        Node* n = &b->node[i];
+        n->b = b; n->idx = i; n->np = b->np[i % cfg->pollers];
+        if (mesh)        n->r = replicator_create_crdt_mesh(n->np, i == 0 ? cfg->port : 0, i == 0 ? NULL : seeds, i == 0 ? 0 : 1);
+        else if (i == 0) n->r = replicator_create_leader_tcp(n->np, BENCH_CONSOLE_ID, cfg->port);
+        else             n->r = replicator_create_client_tcp(n->np, BENCH_CONSOLE_ID, "127.0.0.1", cfg->port);
+        if (!n->r){ fprintf(stderr, "%s: node %d: create failed (port %u busy?)\n", transport, i, (unsigned)cfg->port); goto out; }
+        replicator_set_listener(n->r, (TopicId){ .type_id = 1u, .inst_id = BENCH_CONSOLE_ID }, on_confirm, n);
+        if (i == 0) tick_all(b); /* лидер слушает до первых connect */
+    }
+
+    uint32_t t_setup = now_ms();
+    while (!all_connected(b, mesh)){
+        if (now_ms() - t_setup > BENCH_SETUP_MS){ fprintf(stderr, "%s: peers did not connect\n", transport); goto out; }
+        tick_all(b);
+    }
+
+    perf_reset();
+    Cow1TcpStats s0; cow1tcp_stats(&s0);
+    char text[4096]; uint8_t delta[4];
+    uint64_t t0 = perf_now_ns();
+    uint64_t t_last = t0;
+    int next_node = 0;
+    while (b->confirmed < cfg->ops){
+        for (int k=0; k<cfg->batch && b->published < cfg->ops && b->in_flight < (uint64_t)cfg->window; k++){
+            Node* n = &b->node[next_node];
+            next_node = (next_node + 1) % cfg->nodes;
+            ConOp op;
+            make_op(b, b->published + 1, &op, text, delta);
+            op.actor_id = (uint32_t)n->idx;
+            op.op_id = ((uint64_t)op.actor_id << 32) | ++n->seq;
+            Pend* p = &b->pend[b->published];
+            p->t_pub = perf_now_ns(); p->left = cfg->nodes - 1;
+            b->published++; b->in_flight++;
+            replicator_publish(n->r, &op);
+        }
+        uint64_t before = b->confirmed;
+        tick_all(b);
+        uint64_t t = perf_now_ns();
+        if (b->confirmed != before) t_last = t;
+        else if (t - t_last > (uint64_t)BENCH_DRAIN_MS * 1000000u){
+            fprintf(stderr, "%s: stalled at %" PRIu64 "/%" PRIu64 " confirmed\n", transport, b->confirmed, cfg->ops);
+            break;
+        }
+    }
+    uint64_t dt = perf_now_ns() - t0;
+    Cow1TcpStats s1; cow1tcp_stats(&s1);
+
+    PerfSummary ps[PERF_MAX_SLOTS]; PerfSummary* lat = NULL;
+    int ns = perf_summary(ps, PERF_MAX_SLOTS);
+    for (int i=0;i<ns;i++) if (strcmp(ps[i].name, slot_name) == 0) lat = &ps[i];
+
+    double secs = (double)dt / 1e9;
+    uint64_t tx = s1.tx_bytes - s0.tx_bytes, frames = s1.tx_frames - s0.tx_frames;
+    printf("%-6s nodes=%d pollers=%d ops=%" PRIu64 " mix=%d:%d:%d text=%d\n",
+           transport, cfg->nodes, cfg->pollers, b->confirmed,
+           cfg->mix[0], cfg->mix[1], cfg->mix[2], cfg->text_len);
+    printf("       ops/s=%.0f  deliveries/s=%.0f  bytes/op=%.1f  bytes/frame=%.1f  frames/op=%.2f\n",
+           secs > 0 ? (double)b->confirmed / secs : 0.0,
+           secs > 0 ? (double)b->deliveries / secs : 0.0,
+           b->published ? (double)tx / (double)b->published : 0.0,
+           frames ? (double)tx / (double)frames : 0.0,
+           b->published ? (double)frames / (double)b->published : 0.0);
+    if (lat)
+        printf("       confirm us: p50=%.1f p99=%.1f max=%.1f mean=%.1f\n",
+               lat->p50_ns / 1000.0, lat->p99_ns / 1000.0, lat->max_ns / 1000.0,
+               lat->count ? (double)lat->total_ns / (double)lat->count / 1000.0 : 0.0);
+    if (b->stray) printf("       stray/duplicate deliveries: %" PRIu64 "\n", b->stray);
+    rc = b->confirmed == cfg->ops ? 0 : 1;
+out:
+    bench_teardown(b);
+    free(b);
+    return rc;
+}
+
+static void usage(const char* argv0){
+    fprintf(stderr, "usage: %s [-t leader|mesh|all] [-n nodes] [-o ops] [-w window] [-b batch]\n"
+                    "       [-m text:delta:meta] [-s text_bytes] [-p pollers] [-P port]\n", argv0);
+}
+
+int main(int argc, char** argv){
+    BenchCfg cfg = { .transport = "all", .nodes = 4, .pollers = 1, .ops = 100000,
+                     .window = 1024, .batch = 64, .mix = { 70, 25, 5 }, .text_len = 32, .port = 47310 };
+    for (int i=1;i<argc;i++){
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i+1] : NULL;
+        if (a[0] != '-' || !a[1] || a[2] || !v){ usage(argv[0]); return 2; }
+        switch (a[1]){
+        case 't': cfg.transport = v; break;
+        case 'n': cfg.nodes = atoi(v); break;
+        case 'o': cfg.ops = strtoull(v, NULL, 0); break;
+        case 'w': cfg.window = atoi(v); break;
+        case 'b': cfg.batch = atoi(v); break;
+        case 'm': if (sscanf(v, "%d:%d:%d", &cfg.mix[0], &cfg.mix[1], &cfg.mix[2]) != 3){ usage(argv[0]); return 2; } break;
+        case 's': cfg.text_len = atoi(v); break;
+        case 'p': cfg.pollers = atoi(v); break;
+        case 'P': cfg.port = (uint16_t)atoi(v); break;
+        default: usage(argv[0]); return 2;
+        }
+        i++;
+    }
+    if (cfg.nodes < 2) cfg.nodes = 2;
+    if (cfg.nodes > BENCH_MAX_NODES) cfg.nodes = BENCH_MAX_NODES;
+    if (cfg.pollers < 1) cfg.pollers = 1;
+    if (cfg.pollers > BENCH_MAX_POLLERS) cfg.pollers = BENCH_MAX_POLLERS;
+    if (cfg.pollers > cfg.nodes) cfg.pollers = cfg.nodes;
+    if (cfg.window < 1) cfg.window = 1;
+    if (cfg.batch < 1) cfg.batch = 1;
+    if (cfg.text_len < 0) cfg.text_len = 0;
+    if (cfg.text_len > 4096) cfg.text_len = 4096;
+    if (cfg.mix[0] < 0 || cfg.mix[1] < 0 || cfg.mix[2] < 0 || cfg.mix[0] + cfg.mix[1] + cfg.mix[2] <= 0){ usage(argv[0]); return 2; }
+    if (!cfg.ops) cfg.ops = 1;
+    tcp_init();
+
+    int rc = 0;
+    int all = strcmp(cfg.transport, "all") == 0;
+    if (all || strcmp(cfg.transport, "leader") == 0) rc |= bench_run(&cfg, "leader");
+    if (all){ cfg.port++; }  /* TIME_WAIT на старом порту не мешает */
+    if (all || strcmp(cfg.transport, "mesh") == 0)   rc |= bench_run(&cfg, "mesh");
+    if (!all && strcmp(cfg.transport, "leader") && strcmp(cfg.transport, "mesh")){ usage(argv[0]); return 2; }
+    return rc;
+}
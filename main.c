@@ -30,7 +30,9 @@
 #include "gfx/text.h"
 
 #include "core/loop_hooks.h"
+#include "core/perf.h"
 #include "net/net.h"
+#include "net/wire_tcp.h"
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
@@ -84,7 +86,45 @@ static void s_net_hook(void* user, uint32_t now_ms){
 #else
     /* в wasm всегда неблокирующе */
 #endif
+    static int s_tick = -1, s_flush = -1;
+    uint64_t t0 = perf_now_ns();
     net_poller_tick(c->poller, now_ms, budget);
+    uint64_t t1 = perf_now_ns();
+    perf_record_named(&s_tick, "net.tick", t1 - t0);
+#ifndef __EMSCRIPTEN__
+    /* всё, что репликация наставила за кадр, — одним writev на соединение */
+    cow1tcp_flush_pending();
+    perf_record_named(&s_flush, "net.flush", perf_now_ns() - t1);
+#endif
+}
+
+/* ===== Кадр по фазам (общий для native и wasm), с записью в профайлер ===== */
+static bool s_frame_events(Platform* plat, WM* wm, uint64_t* t_frame){
+    static int s_ev = -1;
+    *t_frame = perf_now_ns();
+    bool running = plat_poll_events_and_dispatch(plat, wm);
+    perf_record_named(&s_ev, "events", perf_now_ns() - *t_frame);
+    return running;
+}
+
+static void s_frame_rest(Platform* plat, WM* wm, uint64_t t_frame){
+    static int s_anim = -1, s_comp = -1, s_hooks = -1, s_total = -1;
+    uint32_t now = plat_now_ms();
+    uint64_t t0 = perf_now_ns();
+    if (wm_any_animating(wm)){
+        wm_tick_animations(wm, now);
+        uint64_t t1 = perf_now_ns();
+        perf_record_named(&s_anim, "anim", t1 - t0);
+        t0 = t1;
+    }
+    plat_compose_and_present(plat, wm);
+    uint64_t t1 = perf_now_ns();
+    perf_record_named(&s_comp, "compose", t1 - t0);
+    /* исполняем хуки конца кадра (сеть и т.п.) */
+    loop_hook_run_end_of_frame(now);
+    uint64_t t2 = perf_now_ns();
+    perf_record_named(&s_hooks, "hooks", t2 - t1);
+    perf_record_named(&s_total, "frame", t2 - t_frame);
 }
 
 
@@ -105,7 +145,8 @@ typedef struct {
 static LoopCtx g_ctx;
 static void s_main_loop(void *p){
     LoopCtx* c = (LoopCtx*)p;
-    bool running = plat_poll_events_and_dispatch(c->plat, c->wm);
+    uint64_t t_frame;
+    bool running = s_frame_events(c->plat, c->wm, &t_frame);
     if (!running) {
         /* порядок как в native: сперва останавливаем цикл и уничтожаем WM, затем консоль/репликация, потом поллер и платформа */
         if (c->h_net) { loop_hook_remove(c->h_net); c->h_net = NULL; }
@@ -120,11 +161,8 @@ static void s_main_loop(void *p){
         plat_destroy(c->plat);
         return;
     }
-    uint32_t now = plat_now_ms();
-    if (wm_any_animating(c->wm)) wm_tick_animations(c->wm, now);
-    plat_compose_and_present(c->plat, c->wm);
-    /* исполняем хуки конца кадра (в т.ч. сетевой поллер) */
-    loop_hook_run_end_of_frame(now);
+    /* анимации, компоновка, хуки конца кадра (в т.ч. сетевой поллер) */
+    s_frame_rest(c->plat, c->wm, t_frame);
 }
 #endif
 
@@ -133,12 +171,15 @@ static void s_main_loop(void *p){
 
 static void s_console_init_from_blob(void* user, uint32_t schema,
                                      const void* blob, size_t len){
-    con_processor_init_from_blob((ConsoleProcessor*)user, schema, blob, len);
+    (void)con_processor_init_from_blob((ConsoleProcessor*)user, schema, blob, len);
 }
 
 static void s_console_apply(void* user, const ConOp* op){
+    static int s_apply = -1;
     ConsoleProcessor* p = (ConsoleProcessor*)user;
+    uint64_t t0 = perf_now_ns();
     con_processor_apply_external(p, op);
+    perf_record_named(&s_apply, "net.apply", perf_now_ns() - t0);
 }
 
 static int s_console_snapshot(void* user,
@@ -159,6 +200,10 @@ static const TypeVt s_console_type_vt = {
 int main(void) {
     Platform *plat = plat_create("Cross WM", 800, 600);
     if (!plat){ fprintf(stderr,"platform init failed\n"); return 1; }
+#ifndef __EMSCRIPTEN__
+    /* COMPOSE_THREADS: не задано — по числу ядер, 0/1 — компоновка в одном потоке */
+    plat_set_compose_threads(plat, getenv("COMPOSE_THREADS") ? env_int("COMPOSE_THREADS", 1) : -1);
+#endif
 
     /* NET POLLER + регистрация хука конца кадра === */
     NetPoller* poller = net_poller_create();
@@ -172,6 +217,7 @@ int main(void) {
     s_nethook_ctx.poller = poller;
     s_nethook_ctx.wm      = NULL; /* заполним ниже, когда создадим WM */
     LoopHookHandle* h_net = loop_hook_add_end_of_frame(/*priority=*/0, /*fn=*/s_net_hook, /*user=*/&s_nethook_ctx);
+    loop_hook_set_name(h_net, "net");
 
     // FONT
     // ВАЖНО: путь к шрифту разный для native/web
@@ -317,12 +363,9 @@ int main(void) {
     /* native-петля */
     bool running = true;
     while (running){
-        running = plat_poll_events_and_dispatch(plat, wm);
-        uint32_t now = plat_now_ms();
-        if (wm_any_animating(wm)) wm_tick_animations(wm, now);
-        plat_compose_and_present(plat, wm);
-        /* исполняем хуки конца кадра (сеть и т.п.) */
-        loop_hook_run_end_of_frame(now);
+        uint64_t t_frame;
+        running = s_frame_events(plat, wm, &t_frame);
+        s_frame_rest(plat, wm, t_frame);
     }
     wm_destroy(wm);
     text_shutdown();
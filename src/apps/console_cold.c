@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L  /* mkstemp/pwrite/mmap */
+
+#include "apps/console_cold.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#  include <fcntl.h>
+#  define CON_COLD_MMAP 1
+#endif
+
+/* ---- Формат сегмента в файле (LE-хост, файл живёт только в пределах процесса) ----
+   [ColdSegHdr][ColdLine × n][текст строк, каждая с завершающим '\0']
+   Смещения сегментов выровнены на страницу, чтобы отображать их напрямую. */
+#define COLD_SEG_MAGIC 0x47455343u /* 'CSEG' */
+
+typedef struct { uint32_t magic, n; } ColdSegHdr;
+typedef struct {
+    uint64_t id;
+    uint32_t off;   /* смещение текста от начала области текста */
+    uint32_t len;   /* длина без '\0' */
+    int32_t  user;
+    uint32_t rsv;
+} ColdLine;
+
+typedef struct { uint64_t file_off; size_t bytes; } ColdSeg;
+
+typedef struct {
+    int      seg;   /* -1 — слот свободен */
+    void*    base;
+    size_t   len;
+    uint32_t tick;
+} ColdMap;
+
+struct ConColdLog {
+#ifdef CON_COLD_MMAP
+    int       fd;
+#else
+    FILE*     fp;
+#endif
+    size_t    align;
+    uint64_t  file_end;
+
+    ColdSeg*  segs;        /* запечатанные сегменты */
+    int       segs_n, segs_cap;
+
+    /* открытый сегмент — в памяти, пока не заполнится */
+    ColdLine* open_lines;  /* [CON_COLD_SEG_LINES] */
+    int       open_n;
+    char*     open_text;
+    size_t    open_len, open_cap;
+
+    ColdMap   maps[CON_COLD_MAPPED];
+    uint32_t  tick;
+};
+
+/* ===== Платформенная часть: файл и отображение ===== */
+static int file_open(ConColdLog* c){
+#ifdef __EMSCRIPTEN__
+    (void)c; return -1; /* в wasm «файл» всё равно живёт в памяти — смысла нет */
+#elif defined(CON_COLD_MMAP)
+    const char* dir = getenv("TMPDIR");
+    char path[512];
+    snprintf(path, sizeof(path), "%s/macforth-con-XXXXXX", (dir && *dir) ? dir : "/tmp");
+    c->fd = mkstemp(path);
+    if (c->fd < 0) return -1;
+    unlink(path); /* анонимный файл: исчезнет вместе с процессом */
+    long pg = sysconf(_SC_PAGESIZE);
+    c->align = (pg > 0) ? (size_t)pg : 4096;
+    return 0;
+#else
+    c->fp = tmpfile();
+    if (!c->fp) return -1;
+    c->align = 1;
+    return 0;
+#endif
+}
+
+static void file_close(ConColdLog* c){
+#ifdef CON_COLD_MMAP
+    if (c->fd >= 0) close(c->fd);
+#elif !defined(__EMSCRIPTEN__)
+    if (c->fp) fclose(c->fp);
+#else
+    (void)c;
+#endif
+}
+
+static int file_write_at(ConColdLog* c, uint64_t off, const void* p, size_t n){
+#ifdef CON_COLD_MMAP
+    const char* b = (const char*)p;
+    while (n){
+        ssize_t w = pwrite(c->fd, b, n, (off_t)off);
+        if (w <= 0) return -1;
+        b += w; off += (uint64_t)w; n -= (size_t)w;
+    }
+    return 0;
+#elif !defined(__EMSCRIPTEN__)
+    if (fseek(c->fp, (long)off, SEEK_SET) != 0) return -1;
+    return (fwrite(p, 1, n, c->fp) == n) ? 0 : -1;
+#else
+    (void)c; (void)off; (void)p; (void)n; return -1;
+#endif
+}
+
+static void* seg_map(ConColdLog* c, const ColdSeg* s){
+#ifdef CON_COLD_MMAP
+    void* p = mmap(NULL, s->bytes, PROT_READ, MAP_PRIVATE, c->fd, (off_t)s->file_off);
+    return (p == MAP_FAILED) ? NULL : p;
+#elif !defined(__EMSCRIPTEN__)
+    void* p = malloc(s->bytes);
+    if (!p) return NULL;
+    fflush(c->fp);
+    if (fseek(c->fp, (long)s->file_off, SEEK_SET) != 0 || fread(p, 1, s->bytes, c->fp) != s->bytes){ free(p); return NULL; }
+    return p;
+#else
+    (void)c; (void)s; return NULL;
+#endif
+}
+
+static void seg_unmap(void* base, size_t len){
+#ifdef CON_COLD_MMAP
+    munmap(base, len);
+#else
+    (void)len; free(base);
+#endif
+}
+
+/* ===== Создание/удаление ===== */
+ConColdLog* con_cold_open(void){
+    ConColdLog* c = (ConColdLog*)calloc(1, sizeof(ConColdLog));
+    if (!c) return NULL;
+#ifdef CON_COLD_MMAP
+    c->fd = -1;
+#endif
+    c->open_lines = (ColdLine*)calloc(CON_COLD_SEG_LINES, sizeof(ColdLine));
+    if (!c->open_lines || file_open(c) != 0){ free(c->open_lines); free(c); return NULL; }
+    for (int i=0;i<CON_COLD_MAPPED;i++) c->maps[i].seg = -1;
+    return c;
+}
+
+void con_cold_close(ConColdLog* c){
+    if (!c) return;
+    for (int i=0;i<CON_COLD_MAPPED;i++) if (c->maps[i].seg >= 0) seg_unmap(c->maps[i].base, c->maps[i].len);
+    file_close(c);
+    free(c->segs); free(c->open_lines); free(c->open_text);
+    free(c);
+}
+
+int con_cold_count(const ConColdLog* c){
+    return c ? c->segs_n * CON_COLD_SEG_LINES + c->open_n : 0;
+}
+
+/* Запечатать открытый сегмент: один последовательный write в конец файла */
+static int seal_open(ConColdLog* c){
+    if (c->segs_n == c->segs_cap){
+        int nc = c->segs_cap ? c->segs_cap*2 : 64;
+        ColdSeg* ns = (ColdSeg*)realloc(c->segs, (size_t)nc*sizeof(ColdSeg));
+        if (!ns) return -1;
+        c->segs = ns; c->segs_cap = nc;
+    }
+    ColdSegHdr h = { COLD_SEG_MAGIC, (uint32_t)c->open_n };
+    size_t meta = sizeof(h) + (size_t)c->open_n*sizeof(ColdLine);
+    uint64_t off = c->file_end;
+    if (file_write_at(c, off, &h, sizeof(h)) != 0 ||
+        file_write_at(c, off + sizeof(h), c->open_lines, meta - sizeof(h)) != 0 ||
+        file_write_at(c, off + meta, c->open_text, c->open_len) != 0) return -1;
+    ColdSeg* s = &c->segs[c->segs_n++];
+    s->file_off = off;
+    s->bytes    = meta + c->open_len;
+    c->file_end = off + s->bytes;
+    c->file_end = (c->file_end + c->align - 1) / c->align * c->align;
+    c->open_n = 0; c->open_len = 0;
+    return 0;
+}
+
+int con_cold_append(ConColdLog* c, ConItemId id, int user_id, const char* s, int len){
+    if (!c || !s || len < 0) return -1;
+    if (c->open_len + (size_t)len + 1 > c->open_cap){
+        size_t nc = c->open_cap ? c->open_cap : 64*1024;
+        while (nc < c->open_len + (size_t)len + 1) nc *= 2;
+        char* nt = (char*)realloc(c->open_text, nc);
+        if (!nt) return -1;
+        c->open_text = nt; c->open_cap = nc;
+    }
+    ColdLine* L = &c->open_lines[c->open_n];
+    L->id = id; L->off = (uint32_t)c->open_len; L->len = (uint32_t)len; L->user = user_id; L->rsv = 0;
+    memcpy(c->open_text + c->open_len, s, (size_t)len);
+    c->open_text[c->open_len + (size_t)len] = 0;
+    c->open_len += (size_t)len + 1;
+    c->open_n++;
+    if (c->open_n == CON_COLD_SEG_LINES && seal_open(c) != 0){
+        /* не удалось сбросить — строка не сохранена, сегмент остаётся открытым */
+        c->open_n--; c->open_len = L->off;
+        return -1;
+    }
+    return 0;
+}
+
+/* Отобразить сегмент (LRU по тикам среди CON_COLD_MAPPED слотов) */
+static const uint8_t* seg_get(ConColdLog* c, int seg){
+    ColdMap* victim = &c->maps[0];
+    for (int i=0;i<CON_COLD_MAPPED;i++){
+        ColdMap* m = &c->maps[i];
+        if (m->seg == seg){ m->tick = ++c->tick; return (const uint8_t*)m->base; }
+        if (m->seg < 0 || (victim->seg >= 0 && m->tick < victim->tick)) victim = m;
+    }
+    void* p = seg_map(c, &c->segs[seg]);
+    if (!p) return NULL;
+    if (victim->seg >= 0) seg_unmap(victim->base, victim->len);
+    victim->seg = seg; victim->base = p; victim->len = c->segs[seg].bytes; victim->tick = ++c->tick;
+    return (const uint8_t*)p;
+}
+
+const char* con_cold_get(ConColdLog* c, int index, int* out_len, ConItemId* out_id, int* out_user){
+    if (!c || index < 0 || index >= con_cold_count(c)) return NULL;
+    int seg = index / CON_COLD_SEG_LINES, k = index % CON_COLD_SEG_LINES;
+    const ColdLine* L; const char* text;
+    if (seg == c->segs_n){
+        L = &c->open_lines[k]; text = c->open_text;
+    } else {
+        const uint8_t* base = seg_get(c, seg);
+        if (!base) return NULL;
+        const ColdSegHdr* h = (const ColdSegHdr*)base;
+        if (h->magic != COLD_SEG_MAGIC || (uint32_t)k >= h->n) return NULL;
+        L = (const ColdLine*)(base + sizeof(ColdSegHdr)) + k;
+        text = (const char*)(base + sizeof(ColdSegHdr) + (size_t)h->n*sizeof(ColdLine));
+    }
+    if (out_len)  *out_len  = (int)L->len;
+    if (out_id)   *out_id   = (ConItemId)L->id;
+    if (out_user) *out_user = L->user;
+    return text + L->off;
+}
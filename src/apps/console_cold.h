@@ -0,0 +1,41 @@
+#pragma once
+/* Холодный ярус истории консоли: неизменяемые сегменты строк в append-only файле.
+ * Store вытесняет туда старые TEXT-строки вместо того, чтобы их выбрасывать;
+ * при прокрутке сегменты подгружаются обратно через mmap (на Windows — чтением).
+ * Резидентно держим только открытый (дописываемый) сегмент и несколько отображённых. */
+#include <stddef.h>
+#include <stdint.h>
+#include "console/replicator.h" /* ConItemId */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Строк в одном сегменте (сегмент запечатывается и уходит в файл, когда заполнен) */
+#ifndef CON_COLD_SEG_LINES
+#define CON_COLD_SEG_LINES 4096
+#endif
+
+/* Сколько запечатанных сегментов держим отображёнными одновременно (LRU) */
+#ifndef CON_COLD_MAPPED
+#define CON_COLD_MAPPED 4
+#endif
+
+    typedef struct ConColdLog ConColdLog;
+
+    /* NULL — холодный ярус недоступен (нет временного файла, wasm): вызывающий
+       откатывается на прежнюю «свёртку» в SNAPSHOT. */
+    ConColdLog* con_cold_open(void);
+    void        con_cold_close(ConColdLog*);
+
+    /* Дописать строку в конец. 0 — ок, -1 — ошибка (строка не сохранена). */
+    int         con_cold_append(ConColdLog*, ConItemId id, int user_id, const char* s, int len);
+    int         con_cold_count(const ConColdLog*);
+
+    /* Строка по индексу 0..count-1 (0 — самая старая). Указатель смотрит в отображение
+       сегмента и валиден до следующего обращения к холодному ярусу. NULL — ошибка. */
+    const char* con_cold_get(ConColdLog*, int index, int* out_len, ConItemId* out_id, int* out_user);
+
+#ifdef __cplusplus
+}
+#endif
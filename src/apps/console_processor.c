@@ -5,6 +5,7 @@
 #include "apps/echo_component.h"
 #include "apps/widget_color.h"
 #include <SDL.h>
+#include "platform/platform_sdl.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -72,6 +73,8 @@ ConsoleProcessor* con_processor_create(ConsoleStore* store){
     return p;
 }
 
+ConsoleStore* con_processor_get_store(ConsoleProcessor* p){ return p ? p->store : NULL; }
+
 void con_processor_destroy(ConsoleProcessor* p){
     if (!p) return;
     /* Закрыть сеть/сокеты до разрушения поллера */
@@ -123,6 +126,7 @@ void con_processor_on_command(ConsoleProcessor* p, const char* line){
         reply(p, "commands: help | echo <text> | time | color | widgets | color set <id> <0..255>");
         reply(p, "net: net leader [port] | net client <ip> [port] | net stop");
         reply(p, "replication: type 'help repl' for hub commands");
+        reply(p, "profiler: perf | perf reset | perf on|off (type 'help perf')");
         return;
 
     }
@@ -133,7 +137,7 @@ void con_processor_on_command(ConsoleProcessor* p, const char* line){
     }
     if (starts_with(s, "time")){
         char buf[64];
-        unsigned ms = SDL_GetTicks();
+        unsigned ms = plat_now_ms();
         snprintf(buf, sizeof(buf), "time: %u ms since start", ms);
         reply(p, buf);
         return;
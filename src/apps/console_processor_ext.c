@@ -8,15 +8,15 @@
 #include "console/processor.h"
 #include "console/store.h"   /* прототипы con_store_* и тип ConsoleStore */
 #include "console/sink.h"
+#include "console/widget.h"
+#include "apps/widget_color.h"
+#include "core/perf.h"
 
 #include "replication/hub.h"
 #include "replication/repl_types.h"
 #include "replication/backends/client_tcp.h"
 #include "replication/backends/crdt_mesh.h"
 
-/* forward for widget pointer type (opaque is fine) */
-typedef struct ConsoleWidget ConsoleWidget;
-
 #if defined(_WIN32) && !defined(__MINGW32__)
 #  define strtok_r(s,delim,saveptr) strtok_s((s),(delim),(saveptr))
 #endif
@@ -89,12 +89,19 @@ int con_processor_ext_try_handle(ConsoleProcessor* proc, const char* line_utf8)
         out_line(proc, "  hub require <caps-bitmask>        — требуемые возможности для console/<CONSOLE_ID>");
         out_line(proc, "  hub switch [<to_idx>]             — мягкое переключение (snapshot+буфер)");
         out_line(proc, "  net client connect <host> <port>  — подключиться к лидеру");
-        out_line(proc, "  net client disconnect             — разорвать подключение");
+        out_line(proc, "  net client disconnect             — разорвать (без переподключения)");
         out_line(proc, "  net client stat                   — состояние клиента");
-        out_line(proc, "  mesh seed add <host>              — добавить seed (CRDT mesh)");
+        out_line(proc, "  mesh seed add <host[:port]>       — добавить seed (CRDT mesh)");
         out_line(proc, "  mesh stat                         — статистика CRDT mesh");
         return 1;
     }
+    if (strcmp(line_utf8, "help perf")==0){
+        out_line(proc, "profiler:");
+        out_line(proc, "  perf                              — фазы кадра: count, p50/p99/max (мкс)");
+        out_line(proc, "  perf reset                        — обнулить гистограммы");
+        out_line(proc, "  perf on|off                       — включить/выключить сбор");
+        return 1;
+    }
 
     /* Грубая токенизация для наших коротких команд */
     char tmp[256]; strncpy(tmp, line_utf8, sizeof(tmp)-1); tmp[sizeof(tmp)-1]=0;
@@ -166,13 +173,35 @@ int con_processor_ext_try_handle(ConsoleProcessor* proc, const char* line_utf8)
             return 1;
         } else if (argc>=3 && strcmp(argv[2],"stat")==0){
             int ok = repl_client_tcp_is_connected(cli);
-            outf(proc, "net client: %s", ok ? "CONNECTED" : "DISCONNECTED");
+            outf(proc, "net client: %s seq=%" PRIu64, ok ? "CONNECTED" : "DISCONNECTED",
+                 repl_client_tcp_last_seq(cli));
+            int obn = 0; size_t obb = 0; uint64_t dropped = 0, reconn = 0;
+            repl_client_tcp_stat(cli, &obn, &obb, &dropped, &reconn);
+            outf(proc, "net client: outbox=%d (%" PRIu64 " B) dropped=%" PRIu64 " reconnects=%" PRIu64,
+                 obn, (uint64_t)obb, dropped, reconn);
             return 1;
         }
         return 0;
 #endif
     }
 
+    /* ------- perf ... ------- */
+    if (strcmp(argv[0],"perf")==0){
+        if (argc>=2 && strcmp(argv[1],"reset")==0){ perf_reset(); out_line(proc, "perf: reset"); return 1; }
+        if (argc>=2 && strcmp(argv[1],"on")==0)   { perf_set_enabled(1); out_line(proc, "perf: on");  return 1; }
+        if (argc>=2 && strcmp(argv[1],"off")==0)  { perf_set_enabled(0); out_line(proc, "perf: off"); return 1; }
+        if (argc>=2) return 0;
+        PerfSummary ps[PERF_MAX_SLOTS];
+        int n = perf_summary(ps, PERF_MAX_SLOTS);
+        if (n == 0){ outf(proc, "perf: нет данных%s", perf_enabled() ? "" : " (сбор выключен)"); return 1; }
+        outf(proc, "%-16s %8s %9s %9s %9s", "phase", "count", "p50us", "p99us", "maxus");
+        for (int i=0;i<n;i++){
+            outf(proc, "%-16s %8" PRIu64 " %9.1f %9.1f %9.1f", ps[i].name, ps[i].count,
+                 ps[i].p50_ns / 1000.0, ps[i].p99_ns / 1000.0, ps[i].max_ns / 1000.0);
+        }
+        return 1;
+    }
+
     /* ------- mesh ... ------- */
     if (argc>=2 && strcmp(argv[0],"mesh")==0){
 #if defined(__EMSCRIPTEN__)
@@ -192,7 +221,15 @@ int con_processor_ext_try_handle(ConsoleProcessor* proc, const char* line_utf8)
         } else if (strcmp(argv[1],"stat")==0){
             int peers=0, listen=0, topics=0;
             (void)repl_crdt_mesh_stat(mesh, &peers, &listen, &topics);
-            outf(proc, "mesh: peers=%d listen=%s topics=%d", peers, listen?"yes":"no", topics);
+            int actors=0; uint64_t nfar=0;
+            (void)repl_crdt_mesh_dedup_stat(mesh, &actors, &nfar);
+            outf(proc, "mesh: peers=%d listen=%s topics=%d actors=%d far=%" PRIu64, peers, listen?"yes":"no", topics, actors, nfar);
+            int logn=0; uint64_t delta=0, snaps=0;
+            (void)repl_crdt_mesh_ae_stat(mesh, &logn, &delta, &snaps);
+            outf(proc, "mesh: log=%d ae_delta_ops=%" PRIu64 " ae_snapshots=%" PRIu64, logn, delta, snaps);
+            int lagging=0; uint64_t lagged=0;
+            (void)repl_crdt_mesh_lag_stat(mesh, &lagging, &lagged);
+            outf(proc, "mesh: lagging=%d lagged=%" PRIu64, lagging, lagged);
             return 1;
         }
         return 0;
@@ -212,11 +249,13 @@ void con_processor_apply_external(ConsoleProcessor* self, const ConOp* op)
     char* tmp = NULL;
     const char* as_cstr = "";
 
-    /* NB: Hub/mesh могут прислать снапшот всего состояния: tag="snapshot", init_blob!=NULL.
-       Это вне списка типов, но полезно поддержать — безболезненно для остальных кейсов. */
-    if (op->init_blob && op->init_size) {
+    /* NB: Hub/mesh могут прислать снапшот всего состояния: op_id==0, init_blob!=NULL.
+       Это вне списка типов, но полезно поддержать — безболезненно для остальных кейсов.
+       (INSERT_WIDGET тоже несёт init_blob, поэтому маркер — именно op_id==0.) */
+    if (op->op_id == 0 && op->init_blob && op->init_size) {
 
-        con_processor_init_from_blob(self, op->schema, op->init_blob, op->init_size);
+        /* снапшот не принят — состояние прежнее, уведомлять не о чем */
+        if (con_processor_init_from_blob(self, op->schema, op->init_blob, op->init_size) != 0) return;
         /* обычно Store сам дёрнет notify внутри своих операций; для снапшота можно явно: на всякий случай дёрнем уведомление */
         con_store_notify_changed(st);
         return;
@@ -241,8 +280,6 @@ void con_processor_apply_external(ConsoleProcessor* self, const ConOp* op)
     }
 
     case CON_OP_INSERT_WIDGET: {
-        /* Фабрика виджетов: реализована в console_processor_ext.c (переименуй, если нужно) */
-        extern ConsoleWidget* con_ext_make_widget(uint32_t kind, const void* init_blob, size_t init_size);
         ConsoleWidget* w = con_ext_make_widget(op->widget_kind, op->init_blob, op->init_size);
         if (w) {
             con_store_insert_widget_at(st, op->new_item_id, &op->pos, w, op->user_id);
@@ -295,13 +332,14 @@ void con_processor_apply_external(ConsoleProcessor* self, const ConOp* op)
 }
 
 
+/* Контракт TypeVt: 0 — успех, !=0 — снапшота нет */
 int con_processor_snapshot(ConsoleProcessor* self, uint32_t* schema, void** blob, size_t* len)
 {
-    if (!self || !schema || !blob || !len) return 0;
+    if (!self || !schema || !blob || !len) return -1;
     ConsoleStore* st = con_processor_get_store(self);
-    if (!st) return 0;
+    if (!st) return -1;
 
-    *schema = 0;    /* минимально валидное значение; при наличии явной схемы — подставь нужную */
+    *schema = CON_STORE_SNAPSHOT_VERSION;
     *blob   = NULL;
     *len    = 0;
 
@@ -309,23 +347,37 @@ int con_processor_snapshot(ConsoleProcessor* self, uint32_t* schema, void** blob
     if (!con_store_serialize(st, blob, len) || !*blob || *len == 0) {
         if (*blob) { free(*blob); *blob=NULL; }
         *len = 0;
-        return 0;
+        return -1;
     }
-    return 1;
+    return 0;
 }
 
+/* Фабрика виджетов по ConOp.widget_kind. init — либо init_blob вставки (u8),
+   либо состояние из снапшота (get_state_blob: int). NULL — вид неизвестен. */
+ConsoleWidget* con_ext_make_widget(uint32_t kind, const void* init_blob, size_t init_size)
+{
+    if (kind == 1 /* ColorSlider */){
+        int v = 128;
+        if (init_blob && init_size >= sizeof(int)) memcpy(&v, init_blob, sizeof(int));
+        else if (init_blob && init_size >= 1)      v = *(const uint8_t*)init_blob;
+        return widget_color_create((uint8_t)(v<0 ? 0 : v>255 ? 255 : v));
+    }
+    return NULL;
+}
 
-// В этой минимальной реализации делаем безопасный фолбэк: трактуем blob как UTF-8 текст,
-// разбиваем по переводам строк и добавляем в Store. При необходимости позже можно
-// заменить на полноценную десериализацию по schema.
-void con_processor_init_from_blob(ConsoleProcessor* self, uint32_t schema, const void* blob, size_t len)
+/* schema == CON_STORE_SNAPSHOT_VERSION — бинарный снапшот Store (CSN1); битый
+   снапшот отвергается целиком (-1, Store не тронут), текстом его не читаем.
+   Иначе — совместимый фолбэк: blob как UTF-8 текст, построчно. */
+int con_processor_init_from_blob(ConsoleProcessor* self, uint32_t schema, const void* blob, size_t len)
 {
-    (void)schema; /* пока схема не используется */
-    if (!self || !blob || len == 0) return;
+    if (!self || !blob || len == 0) return -1;
     ConsoleStore* st = con_processor_get_store(self);
-    if (!st) return;
+    if (!st) return -1;
+
+    if (schema == CON_STORE_SNAPSHOT_VERSION)
+        return con_store_load_snapshot(st, blob, len, con_ext_make_widget) ? 0 : -1;
 
-    /* ----- Фолбэк: не COW1-поток. Считаем, что это просто текстовый дамп. ----- */
+    /* ----- Фолбэк: не снапшот Store. Считаем, что это просто текстовый дамп. ----- */
     const char* bytes = (const char*)blob;
     size_t i = 0;
     while (i < len){
@@ -345,4 +397,5 @@ void con_processor_init_from_blob(ConsoleProcessor* self, uint32_t schema, const
         i = j;
     }
     con_store_notify_changed(st);
+    return 0;
 }
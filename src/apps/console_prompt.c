@@ -1,6 +1,7 @@
 #include "console/prompt.h"
 #include "gfx/text.h"
 #include <SDL.h>
+#include "platform/platform_sdl.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,7 +33,7 @@ ConsolePrompt* con_prompt_create(int user_id, ConsoleSink* sink, ConsoleStore* s
     p->sink    = sink;
     p->store   = store;
     p->cursor_col = 0;
-    p->next_blink_ms = SDL_GetTicks() + 500;
+    p->next_blink_ms = plat_now_ms() + 500;
     p->blink_on = 1;
     p->col_bg = 0xFF0A0A0A;
     p->col_fg = 0xFFFFFFFF;
@@ -51,10 +52,7 @@ void con_prompt_set_colors(ConsolePrompt* p, uint32_t bg, uint32_t fg){
 
 static void draw_line_text(Surface *dst, int x, int y, const char *s, uint32_t argb){
     if (!s || !*s) return;
-    Surface *glyph = text_render_utf8(s, argb);
-    if (!glyph) return;
-    surface_blit(glyph, 0,0, surface_w(glyph), surface_h(glyph), dst, x,y);
-    surface_free(glyph);
+    text_draw_utf8(dst, x, y, s, argb);
 }
 
 void con_prompt_draw(ConsolePrompt* p, Surface* dst, int x, int y, int w, int h){
@@ -6,6 +6,7 @@
 #include "replication/repl_types.h"
 #include "replication/repl_iface.h"
 #include <SDL.h>
+#include "platform/platform_sdl.h"
 #include "apps/widget_color.h"
 #include <stdint.h>
 #include <stdio.h>
@@ -211,7 +212,7 @@ ConsoleSink* con_sink_create(ConsoleStore* store, ConsoleProcessor* proc, Replic
     s->next_op_id = 1;
     /* простой actor_id: смесь адреса и стартового времени */
     s->actor_id = (uint32_t)((uintptr_t)s ^ (uintptr_t)SDL_GetTicks());
-    s->last_hlc = SDL_GetTicks();
+    s->last_hlc = plat_now_ms();
     s->next_item_seq = 1;
     s->pending_n = 0;
     s->applied_n = 0;
@@ -241,7 +242,7 @@ static void publish_prompt_meta(ConsoleSink* s, int user_id){
     int nonempty = con_store_prompt_len(s->store, user_id) > 0 ? 1 : 0;
     ConOp op = (ConOp){0};
     op.op_id   = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-    op.hlc     = con_sink_tick_hlc(s, SDL_GetTicks());
+    op.hlc     = con_sink_tick_hlc(s, plat_now_ms());
     op.actor_id= s->actor_id;
     op.console_id = s->console_id;
     op.user_id = user_id;
@@ -288,7 +289,7 @@ void con_sink_append_line(ConsoleSink* s, int user_id, const char* utf8_line){
     if (s->repl){
         ConOp op = {0};
         op.op_id   = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-        op.hlc     = con_sink_tick_hlc(s, SDL_GetTicks());
+        op.hlc     = con_sink_tick_hlc(s, plat_now_ms());
         op.actor_id= s->actor_id;
         op.console_id = s->console_id;
         op.user_id = user_id;
@@ -311,7 +312,7 @@ void con_sink_insert_text_between(ConsoleSink* s, int user_id, ConItemId left, C
     if (s->repl){
         ConOp op = (ConOp){0};
         op.op_id   = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-        op.hlc     = con_sink_tick_hlc(s, SDL_GetTicks());
+        op.hlc     = con_sink_tick_hlc(s, plat_now_ms());
         op.actor_id= s->actor_id;
         op.console_id = s->console_id;
         op.user_id = user_id;
@@ -355,7 +356,7 @@ void con_sink_insert_widget_color(ConsoleSink* s, int user_id, uint8_t initial_r
     if (s->repl){
         ConOp op = (ConOp){0};
         op.op_id       = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-        op.hlc         = con_sink_tick_hlc(s, SDL_GetTicks());
+        op.hlc         = con_sink_tick_hlc(s, plat_now_ms());
         op.actor_id    = s->actor_id;
         op.console_id  = s->console_id;
         op.user_id     = user_id;
@@ -386,7 +387,7 @@ void con_sink_widget_message(ConsoleSink* s, int user_id,
     if (s->repl){
         ConOp op = {0};
         op.op_id   = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-        op.hlc     = con_sink_tick_hlc(s, SDL_GetTicks());
+        op.hlc     = con_sink_tick_hlc(s, plat_now_ms());
         op.actor_id= s->actor_id;
         op.console_id = s->console_id;
         op.user_id = user_id;
@@ -410,7 +411,7 @@ void con_sink_widget_delta(ConsoleSink* s, int user_id,
     if (s->repl){
         ConOp op = {0};
         op.op_id   = ((uint64_t)s->actor_id<<32) | (s->next_op_id++);
-        op.hlc     = con_sink_tick_hlc(s, SDL_GetTicks());
+        op.hlc     = con_sink_tick_hlc(s, plat_now_ms());
         op.actor_id= s->actor_id;
         op.console_id = s->console_id;
         op.user_id = user_id;
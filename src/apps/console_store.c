@@ -1,5 +1,6 @@
 #include "console/store.h"
 #include "console/widget.h"
+#include "apps/console_cold.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -62,14 +63,32 @@ static ConPosId pos_between_impl(const ConPosId* L, const ConPosId* R, uint32_t
 }
 
 
+/* Ёмкость индекса ID->слот: степень двойки, не меньше 2*CON_BUF_LINES (заполненность <= 0.5) */
+#ifndef CON_ID_INDEX_CAP
+#  define CON_ID_INDEX_CAP 2048
+#endif
+#if (CON_ID_INDEX_CAP & (CON_ID_INDEX_CAP-1)) || CON_ID_INDEX_CAP < 2*CON_BUF_LINES
+#  error "CON_ID_INDEX_CAP must be a power of two >= 2*CON_BUF_LINES"
+#endif
+
 /* ===== Внутренние типы ===== */
 struct SubEntry { ConsoleStoreListener cb; void* user; };
 
+/* Общий буфер текстов, принятый из снапшота одним memcpy: строки TEXT-записей
+   смотрят прямо в data[], буфер освобождается, когда уходит последняя ссылка. */
+typedef struct SnapArena {
+    int  refs;
+    char data[];
+} SnapArena;
+
+static void arena_unref(SnapArena* a){ if (a && --a->refs == 0) free(a); }
+
 typedef struct ConEntry {
     ConEntryType  type;
     ConItemId     id;      /* стабильный ID */
     ConPosId      pos;     /* CRDT-позиция (лексикографическая) */
     int           user_id; /* источник (для окраски): -1 = системная/неизвестно */
+    SnapArena*    arena;   /* TEXT: строка лежит в арене снапшота (не free()), иначе NULL */
     union {
         struct { char* s; int len; } text;
         ConsoleWidget* widget;
@@ -87,9 +106,18 @@ struct ConsoleStore {
 
     ConItemId next_id;
 
-    /* отсортированный порядок отображения: индексы в entries[] */
+    /* индекс ID -> слот entries[] (открытая адресация, линейное пробирование) */
+    ConItemId idx_key[CON_ID_INDEX_CAP];
+    int       idx_val[CON_ID_INDEX_CAP];
+
+    /* отсортированный по (pos,id) порядок отображения: индексы в entries[].
+       Поддерживается инкрементально при каждой вставке/вытеснении. */
     int   order[CON_BUF_LINES];
-    int   order_valid;
+    int   order_n;
+
+    /* холодный ярус: вытесненные из кольца строки (создаётся при первой компактации) */
+    ConColdLog* cold;
+    int         cold_failed; /* 1 — ярус недоступен, работаем по-старому (SNAPSHOT) */
 
     /* --- очередь «точечных» изменений и флаг all для инкрементального редрава --- */
     ConItemId changes[CON_STORE_CHANGES_MAX];
@@ -107,29 +135,151 @@ struct ConsoleStore {
 
 /* ===== Утилиты ===== */
 
+/* Видимый индекс: [0, cold_n) — холодный ярус, дальше — горячее окно в порядке order[] */
+static int cold_n(const ConsoleStore* st){ return st->cold ? con_cold_count(st->cold) : 0; }
+
 static int phys_index(const ConsoleStore* st, int visible_index){
-    if (!st || visible_index<0 || visible_index>=st->count) return -1;
-    return st->order[visible_index];
+    if (!st) return -1;
+    int i = visible_index - cold_n(st);
+    if (i<0 || i>=st->order_n) return -1;
+    return st->order[i];
+}
+
+/* ---- Упорядоченный вид: бинарный поиск по (pos, id) ---- */
+static int entry_cmp(const ConEntry* a, const ConEntry* b){
+    int c = pos_cmp(&a->pos, &b->pos);
+    if (c) return c;
+    if (a->id < b->id) return -1;
+    if (a->id > b->id) return  1;
+    return 0;
 }
 
-static int has_id(const ConsoleStore* st, ConItemId id){
-    for (int i=0;i<st->count;i++){ int p=(st->head+i)%CON_BUF_LINES; if (st->entries[p].id==id) return 1; }
-    return 0;
+/* Первый видимый индекс, чей элемент не меньше e */
+static int order_lower_bound(const ConsoleStore* st, const ConEntry* e){
+    int lo = 0, hi = st->order_n;
+    while (lo < hi){
+        int mid = lo + (hi-lo)/2;
+        if (entry_cmp(&st->entries[st->order[mid]], e) < 0) lo = mid+1; else hi = mid;
+    }
+    return lo;
+}
+
+static void order_insert(ConsoleStore* st, int phys){
+    const ConEntry* e = &st->entries[phys];
+    int n = st->order_n, at;
+    /* быстрый путь: обычное добавление в хвост */
+    if (n==0 || entry_cmp(&st->entries[st->order[n-1]], e) < 0) at = n;
+    else {
+        at = order_lower_bound(st, e);
+        memmove(&st->order[at+1], &st->order[at], (size_t)(n-at)*sizeof(int));
+    }
+    st->order[at] = phys;
+    st->order_n = n+1;
+}
+
+/* Видимый индекс живого слота phys (по его ещё не стёртой позиции), -1 если нет */
+static int order_find(const ConsoleStore* st, int phys){
+    int i = order_lower_bound(st, &st->entries[phys]);
+    /* равные (pos,id) возможны только у дубликатов — досмотрим серию */
+    for (; i<st->order_n; i++){
+        if (st->order[i]==phys) return i;
+        if (entry_cmp(&st->entries[st->order[i]], &st->entries[phys]) != 0) break;
+    }
+    return -1;
+}
+
+static void order_remove(ConsoleStore* st, int phys){
+    int at = order_find(st, phys);
+    if (at < 0) return;
+    memmove(&st->order[at], &st->order[at+1], (size_t)(st->order_n-at-1)*sizeof(int));
+    st->order_n--;
+}
+
+static int slot_is_live(const ConsoleStore* st, int phys){
+    return ((phys - st->head + CON_BUF_LINES) % CON_BUF_LINES) < st->count;
 }
 
+/* ---- Индекс ID -> физический слот ----
+   Ключ 0 (CON_ITEMID_INVALID) — пустая ячейка. Удаление — обратным сдвигом,
+   без надгробий, так что цепочки не деградируют при долгой жизни кольца. */
+static inline unsigned id_hash(ConItemId id){
+    uint64_t x = id;
+    x ^= x >> 33; x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (unsigned)x & (CON_ID_INDEX_CAP-1);
+}
+
+static void idx_put(ConsoleStore* st, ConItemId id, int phys){
+    if (id==CON_ITEMID_INVALID) return;
+    unsigned i = id_hash(id);
+    while (st->idx_key[i] && st->idx_key[i]!=id) i = (i+1) & (CON_ID_INDEX_CAP-1);
+    st->idx_key[i] = id;
+    st->idx_val[i] = phys;
+}
+
+static int idx_find(const ConsoleStore* st, ConItemId id){
+    if (!st || id==CON_ITEMID_INVALID) return -1;
+    for (unsigned i = id_hash(id); st->idx_key[i]; i = (i+1) & (CON_ID_INDEX_CAP-1))
+        if (st->idx_key[i]==id) return st->idx_val[i];
+    return -1;
+}
+
+/* Удаляет запись, только если она всё ещё указывает на phys (защита от дубликатов ID) */
+static void idx_del(ConsoleStore* st, ConItemId id, int phys){
+    if (id==CON_ITEMID_INVALID) return;
+    const unsigned m = CON_ID_INDEX_CAP-1;
+    unsigned i = id_hash(id);
+    while (st->idx_key[i] && st->idx_key[i]!=id) i = (i+1) & m;
+    if (!st->idx_key[i] || st->idx_val[i]!=phys) return;
+    for (unsigned j=i;;){
+        j = (j+1) & m;
+        if (!st->idx_key[j]) break;
+        unsigned h = id_hash(st->idx_key[j]);
+        /* ключ из j можно сдвинуть в дыру i, если его «домашняя» ячейка не лежит в (i, j] */
+        int movable = (i<=j) ? (h<=i || h>j) : (h<=i && h>j);
+        if (movable){ st->idx_key[i]=st->idx_key[j]; st->idx_val[i]=st->idx_val[j]; i=j; }
+    }
+    st->idx_key[i] = CON_ITEMID_INVALID;
+}
+
+static int has_id(const ConsoleStore* st, ConItemId id){ return idx_find(st, id) >= 0; }
+
 static void free_entry(ConEntry* e){
     if (!e) return;
     if (e->type == CON_ENTRY_TEXT){
-        free(e->as.text.s); e->as.text.s=NULL; e->as.text.len=0;
+        if (e->arena) arena_unref(e->arena); else free(e->as.text.s);
+        e->arena=NULL; e->as.text.s=NULL; e->as.text.len=0;
     } else if (e->type == CON_ENTRY_WIDGET){
         if (e->as.widget){ con_widget_destroy(e->as.widget); e->as.widget=NULL; }
     }
     e->type = 0; e->id = 0; e->pos = (ConPosId){0};
 }
 
+/* Освободить слот кольца перед перезаписью/вытеснением: снять его с индекса и из порядка */
+static void slot_release(ConsoleStore* st, int phys){
+    ConEntry* e = &st->entries[phys];
+    if (e->type && slot_is_live(st, phys)) order_remove(st, phys);
+    idx_del(st, e->id, phys);
+    free_entry(e);
+}
+
+/* Заполненный слот записи (head+count) становится видимым: индекс, порядок, кольцо */
+static void slot_commit(ConsoleStore* st, int idx){
+    idx_put(st, st->entries[idx].id, idx);
+    order_insert(st, idx);
+    if (st->count < CON_BUF_LINES) st->count++;
+    else st->head = (st->head + 1) % CON_BUF_LINES;
+}
+
+/* Заполнить слот не удалось: при полном кольце вытесненная голова уже снята — сдвигаем её */
+static void slot_abort(ConsoleStore* st, int idx){
+    free_entry(&st->entries[idx]);
+    if (st->count == CON_BUF_LINES){ st->head = (st->head + 1) % CON_BUF_LINES; st->count--; }
+}
+
 
 static void notify(ConsoleStore* st){
-    st->order_valid = 0;
     for (int i=0;i<st->subs_n;i++){
         if (st->subs[i].cb) st->subs[i].cb(st->subs[i].user);
     }
@@ -146,32 +296,6 @@ static void notify(ConsoleStore* st){
 #  define CON_SNAPSHOT_MIN_DROP  64
 #endif
 
-/* portable qsort (без qsort_r): компаратор читает глобальный указатель */
-static const ConsoleStore* g_sort_store = NULL;
-static int cmp_order_by_pos_id(const void* a, const void* b){
-    int ia = *(const int*)a;
-    int ib = *(const int*)b;
-    const ConEntry* ea = &g_sort_store->entries[ia];
-    const ConEntry* eb = &g_sort_store->entries[ib];
-    int c = pos_cmp(&ea->pos, &eb->pos);
-    if (c<0) return -1;
-    if (c>0) return  1;
-    if (ea->id  < eb->id)  return -1;
-    if (ea->id  > eb->id)  return  1;
-    return 0;
-}
-static void rebuild_order(ConsoleStore* st){
-    if (!st) return;
-    int n = st->count;
-    for (int i=0;i<n;i++){
-        st->order[i] = (st->head + i) % CON_BUF_LINES;
-    }
-    g_sort_store = st;
-    qsort(st->order, n, sizeof(int), cmp_order_by_pos_id);
-    g_sort_store = NULL;
-    st->order_valid = 1;
-}
-
 /* ==== Трекинг изменений для инкрементальной перерисовки ==== */
 static void changes_reset(ConsoleStore* st){ st->changes_n = 0; st->changes_all = 0; }
 static void changes_mark_all(ConsoleStore* st){ st->changes_all = 1; }
@@ -193,50 +317,66 @@ int con_store_drain_changes(ConsoleStore* st, ConItemId* out_ids, int cap, int*
     changes_reset(st); if (out_all_flag) *out_all_flag = all; return n;
 }
 
+/* Вытеснить визуально самый старый элемент (order[0]). Если он не в физической голове,
+   переносим голову в освободившийся слот — кольцо остаётся непрерывным. */
+static void evict_oldest(ConsoleStore* st){
+    int p = st->order[0], h = st->head;
+    slot_release(st, p);
+    if (p != h){
+        int at = order_find(st, h);
+        st->entries[p] = st->entries[h];
+        memset(&st->entries[h], 0, sizeof(ConEntry));
+        idx_put(st, st->entries[p].id, p);
+        if (at >= 0) st->order[at] = p;
+    }
+    st->head = (h + 1) % CON_BUF_LINES;
+    st->count--;
+}
+
 /* ===== Компактация хвоста =====
-   Удаляем самые старые TEXT-строки (но не WIDGET), пока не останется минимум keep_last.
-   Если удалили достаточно (>= min_drop), добавляем в конец строку-заглушку. */
+   Вытесняем самые старые TEXT-строки (но не WIDGET), пока не останется минимум keep_last.
+   Строки уходят в холодный ярус и остаются доступны по индексу; если яруса нет
+   (или запись не удалась) — строки теряются, и при достаточной пачке (>= min_drop)
+   в конец добавляется строка-заглушка SNAPSHOT. */
 static void maybe_compact_tail(ConsoleStore* st){
     if (!st) return;
     /* буфер ещё не под давлением — выходим */
     if (st->count < CON_BUF_LINES - 2) return;
+    if (!st->cold && !st->cold_failed){
+        st->cold = con_cold_open();
+        if (!st->cold) st->cold_failed = 1;
+    }
 
-    int drop = 0;
-    /* удаляем с головы только TEXT, пока не достигнем keep_last */
-    while (st->count > CON_SNAPSHOT_KEEP_LAST){
-        ConEntry* head = &st->entries[st->head];
-        /* если на голове виджет — не тянем дальше (сохраняем интерактив) */
-        if (head->type == CON_ENTRY_WIDGET) break;
-        /* TEXT — можно удалить */
-        free_entry(head);
-        st->head = (st->head + 1) % CON_BUF_LINES;
-        st->count--;
-        drop++;
+    int drop = 0, spilled = 0;
+    while (st->count > CON_SNAPSHOT_KEEP_LAST && st->order_n > 0){
+        ConEntry* e = &st->entries[st->order[0]];
+        /* если первым идёт виджет — не тянем дальше (сохраняем интерактив) */
+        if (e->type == CON_ENTRY_WIDGET) break;
+        if (e->type == CON_ENTRY_TEXT && st->cold &&
+            con_cold_append(st->cold, e->id, e->user_id, e->as.text.s ? e->as.text.s : "", e->as.text.len) == 0)
+            spilled++;
+        else
+            drop++;
+        evict_oldest(st);
     }
+    if (spilled) changes_mark_all(st);
     if (drop >= CON_SNAPSHOT_MIN_DROP){
         /* Добавляем агрегатный SNAPSHOT-элемент вместо текстовой строки-заглушки */
         int idx = (st->head + st->count) % CON_BUF_LINES;
-        free_entry(&st->entries[idx]);
+        slot_release(st, idx);
         st->entries[idx].type = CON_ENTRY_SNAPSHOT;
         st->entries[idx].id   = st->next_id++;
         st->entries[idx].pos  = con_store_gen_between(st, con_store_last_id(st), CON_ITEMID_INVALID, 0);
         st->entries[idx].user_id = -1;
         st->entries[idx].as.snap.dropped_count = drop;
-        if (st->count < CON_BUF_LINES) st->count++; else st->head = (st->head + 1) % CON_BUF_LINES;
+        slot_commit(st, idx);
         /* после компактации структура изменилась → полный redraw */
         changes_mark_all(st);
     }
 }
 
 /* ---- Поиск позиции элемента по ID (для gen_between) ---- */
-static int find_phys_by_id(const ConsoleStore* st, ConItemId id){
-    if (!st || id==CON_ITEMID_INVALID) return -1;
-    for (int i=0;i<st->count;i++){
-        int p=(st->head+i)%CON_BUF_LINES;
-        if (st->entries[p].id==id) return p;
-    }
-    return -1;
-}
+static int find_phys_by_id(const ConsoleStore* st, ConItemId id){ return idx_find(st, id); }
 
 ConPosId con_store_gen_between(const ConsoleStore* st, ConItemId left, ConItemId right, uint32_t actor){
     ConPosId L={0}, R={0}; ConPosId* pL=NULL; ConPosId* pR=NULL;
@@ -260,7 +400,7 @@ ConsoleStore* con_store_create(void){
     st->next_id = 1;
     st->head = 0;
     st->count = 0;
-    st->order_valid = 0;
+    st->order_n = 0;
     /* очередь изменений пуста */
     changes_reset(st);
     /* промпты по умолчанию пустые */
@@ -272,6 +412,7 @@ ConsoleStore* con_store_create(void){
 void con_store_destroy(ConsoleStore* st){
     if (!st) return;
     for (int i=0;i<CON_BUF_LINES;i++) free_entry(&st->entries[i]);
+    con_cold_close(st->cold);
     free(st);
 }
 
@@ -287,7 +428,7 @@ void con_store_subscribe(ConsoleStore* st, ConsoleStoreListener cb, void* user){
 static void append_line_internal(ConsoleStore* st, const char* s){
     if (!s) return;
     int idx = (st->head + st->count) % CON_BUF_LINES;
-    free_entry(&st->entries[idx]);
+    slot_release(st, idx);
     st->entries[idx].type = CON_ENTRY_TEXT;
     st->entries[idx].id   = st->next_id++;
     st->entries[idx].pos  = con_store_gen_between(st, con_store_last_id(st), CON_ITEMID_INVALID, 0);
@@ -298,9 +439,8 @@ static void append_line_internal(ConsoleStore* st, const char* s){
         memcpy(st->entries[idx].as.text.s, s, n);
         st->entries[idx].as.text.s[n]=0;
         st->entries[idx].as.text.len = (int)n;
-        if (st->count < CON_BUF_LINES) st->count++;
-        else st->head = (st->head + 1) % CON_BUF_LINES;
-    }
+        slot_commit(st, idx);
+    } else slot_abort(st, idx);
     /* изменение структуры (добавление) - проще пометить как all */
     changes_mark_all(st);
     /* компактацию не вызываем здесь, чтобы избежать рекурсии */
@@ -309,15 +449,14 @@ static void append_line_internal(ConsoleStore* st, const char* s){
 static ConItemId append_widget_internal(ConsoleStore* st, ConsoleWidget* w){
     if (!w) return CON_ITEMID_INVALID;
     int idx = (st->head + st->count) % CON_BUF_LINES;
-    free_entry(&st->entries[idx]);
+    slot_release(st, idx);
     st->entries[idx].type = CON_ENTRY_WIDGET;
     st->entries[idx].id   = st->next_id++;
     st->entries[idx].pos  = con_store_gen_between(st, con_store_last_id(st), CON_ITEMID_INVALID, 0);
     st->entries[idx].user_id = -1;
     st->entries[idx].as.widget = w;
     ConItemId id = st->entries[idx].id;
-    if (st->count < CON_BUF_LINES) st->count++;
-    else st->head = (st->head + 1) % CON_BUF_LINES;
+    slot_commit(st, idx);
     /* компактацию не вызываем здесь, чтобы избежать рекурсии */
     return id;
 }
@@ -347,12 +486,12 @@ void con_store_notify_changed(ConsoleStore* st){
 
 
 int con_store_count(const ConsoleStore* st){
-    return st ? st->count : 0;
+    return st ? cold_n(st) + st->order_n : 0;
 }
 
 const char* con_store_get_line(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return NULL;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return NULL;
+    if (index < cold_n(st)) return con_cold_get(st->cold, index, NULL, NULL, NULL);
     int phys = phys_index(st, index);
     if (phys<0) return NULL;
     const ConEntry* e = &st->entries[phys];
@@ -361,8 +500,8 @@ const char* con_store_get_line(const ConsoleStore* st, int index){
 }
 
 int con_store_get_line_len(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return 0;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return 0;
+    if (index < cold_n(st)){ int len=0; return con_cold_get(st->cold, index, &len, NULL, NULL) ? len : 0; }
     int phys = phys_index(st, index);
     if (phys<0) return 0;
     const ConEntry* e = &st->entries[phys];
@@ -371,17 +510,15 @@ int con_store_get_line_len(const ConsoleStore* st, int index){
 }
 
 int con_store_get_user(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return -1;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return -1;
+    if (index < cold_n(st)){ int u=-1; return con_cold_get(st->cold, index, NULL, NULL, &u) ? u : -1; }
     int phys = phys_index(st, index);
     if (phys<0) return -1;
     return st->entries[phys].user_id;
 }
 
 ConsoleWidget* con_store_get_widget(const ConsoleStore* st, int index){
-    if (!st) return NULL;
-    if (index<0 || index>=st->count) return NULL;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return NULL;
     int phys = phys_index(st, index);
     if (phys<0) return NULL;
     const ConEntry* e = &st->entries[phys];
@@ -390,8 +527,8 @@ ConsoleWidget* con_store_get_widget(const ConsoleStore* st, int index){
 }
 
 ConItemId con_store_get_id(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return CON_ITEMID_INVALID;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return CON_ITEMID_INVALID;
+    if (index < cold_n(st)){ ConItemId id=0; return con_cold_get(st->cold, index, NULL, &id, NULL) ? id : CON_ITEMID_INVALID; }
     int phys = phys_index(st, index);
     if (phys<0) return CON_ITEMID_INVALID;
     return st->entries[phys].id;
@@ -399,28 +536,16 @@ ConItemId con_store_get_id(const ConsoleStore* st, int index){
 
 int con_store_find_index_by_id(const ConsoleStore* st, ConItemId id){
     if (!st || id==CON_ITEMID_INVALID) return -1;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
-    int n = st->count;
-    int phys_of_id = -1;
-    for (int i=0;i<n;i++){
-        int phys = (st->head + i) % CON_BUF_LINES;
-        if (st->entries[phys].id == id){ phys_of_id = phys; break; }
-    }
+    int phys_of_id = idx_find(st, id);
     if (phys_of_id<0) return -1;
-    for (int i=0;i<n;i++){
-        if (st->order[i] == phys_of_id) return i;
-    }
-    return -1;
+    int i = order_find(st, phys_of_id);
+    return (i<0) ? -1 : cold_n(st) + i;
 }
 
 int con_store_widget_message(ConsoleStore* st, ConItemId id,
                              const char* tag, const void* data, size_t size){
     if (!st || id==CON_ITEMID_INVALID) return 0;
-    int phys = -1;
-    for (int i=0;i<st->count;i++){
-        int p = (st->head + i) % CON_BUF_LINES;
-        if (st->entries[p].id == id){ phys = p; break; }
-    }
+    int phys = idx_find(st, id);
     if (phys < 0) return 0;
     ConsoleWidget* w = (st->entries[phys].type==CON_ENTRY_WIDGET)? st->entries[phys].as.widget : NULL;
     if (!w || !w->on_message) return 0;
@@ -434,8 +559,8 @@ int con_store_widget_message(ConsoleStore* st, ConItemId id,
 }
 
 ConEntryType con_store_get_type(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return 0;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return 0;
+    if (index < cold_n(st)) return CON_ENTRY_TEXT;
     int phys = phys_index(st, index);
     if (phys<0) return 0;
     return st->entries[phys].type;
@@ -446,7 +571,7 @@ ConItemId con_store_insert_text_between(ConsoleStore* st, ConItemId left, ConIte
     if (!st || !s) return CON_ITEMID_INVALID;
     ConPosId pos = con_store_gen_between(st, left, right, 0);
     int idx = (st->head + st->count) % CON_BUF_LINES;
-    free_entry(&st->entries[idx]);
+    slot_release(st, idx);
     st->entries[idx].type = CON_ENTRY_TEXT;
     st->entries[idx].id   = st->next_id++;
     st->entries[idx].pos  = pos;
@@ -456,12 +581,12 @@ ConItemId con_store_insert_text_between(ConsoleStore* st, ConItemId left, ConIte
         memcpy(st->entries[idx].as.text.s, s, n);
         st->entries[idx].as.text.s[n]=0;
         st->entries[idx].as.text.len = (int)n;
-        if (st->count < CON_BUF_LINES) st->count++;
-        else st->head = (st->head + 1) % CON_BUF_LINES;
+        slot_commit(st, idx);
         changes_mark_all(st); /* вставка меняет порядки — безопасно перерисовать всё */
         notify(st);
         return st->entries[idx].id;
     }
+    slot_abort(st, idx);
     return CON_ITEMID_INVALID;
 }
 
@@ -469,7 +594,7 @@ ConItemId con_store_insert_text_at(ConsoleStore* st, ConItemId forced_id, const
     if (!st || !pos || !s) return CON_ITEMID_INVALID;
     if (forced_id && has_id(st, forced_id)) return forced_id; /* идемпотентность */
     int idx = (st->head + st->count) % CON_BUF_LINES;
-    free_entry(&st->entries[idx]);
+    slot_release(st, idx);
     st->entries[idx].type = CON_ENTRY_TEXT;
     st->entries[idx].id   = forced_id ? forced_id : st->next_id++;
     st->entries[idx].pos  = *pos;
@@ -480,12 +605,13 @@ ConItemId con_store_insert_text_at(ConsoleStore* st, ConItemId forced_id, const
         memcpy(st->entries[idx].as.text.s, s, n);
         st->entries[idx].as.text.s[n]=0;
         st->entries[idx].as.text.len = (int)n;
-        if (st->count < CON_BUF_LINES) st->count++; else st->head = (st->head + 1) % CON_BUF_LINES;
+        slot_commit(st, idx);
         changes_mark_all(st); /* структура менялась */
         notify(st);
         maybe_compact_tail(st);
         return st->entries[idx].id;
     }
+    slot_abort(st, idx);
     return CON_ITEMID_INVALID;
 }
 
@@ -493,31 +619,30 @@ ConItemId con_store_insert_widget_at(ConsoleStore* st, ConItemId forced_id, cons
     if (!st || !pos || !w) return CON_ITEMID_INVALID;
     if (forced_id && has_id(st, forced_id)) { con_widget_destroy(w); return forced_id; }
     int idx = (st->head + st->count) % CON_BUF_LINES;
-    free_entry(&st->entries[idx]);
+    slot_release(st, idx);
     st->entries[idx].type = CON_ENTRY_WIDGET;
     st->entries[idx].id   = forced_id ? forced_id : st->next_id++;
     st->entries[idx].pos  = *pos;
     st->entries[idx].user_id = (user_id>=0)? user_id : -1;
     st->entries[idx].as.widget = w;
-    if (st->count < CON_BUF_LINES) st->count++; else st->head = (st->head + 1) % CON_BUF_LINES;
+    ConItemId id = st->entries[idx].id;
+    slot_commit(st, idx);
     changes_mark_all(st); /* структура менялась */
     notify(st);
     maybe_compact_tail(st);
-    return st->entries[idx].id;
+    return id;
 }
 
 ConItemId con_store_last_id(const ConsoleStore* st){
-    if (!st || st->count<=0) return CON_ITEMID_INVALID;
-    /* найдём самый правый по order */
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
-    int phys = st->order[st->count-1];
+    if (!st || st->order_n<=0) return CON_ITEMID_INVALID;
+    /* самый правый по order */
+    int phys = st->order[st->order_n-1];
     return st->entries[phys].id;
 }
 
 /* ===== Снапшоты ===== */
 int con_store_get_snapshot_dropped(const ConsoleStore* st, int index){
-    if (!st || index<0 || index>=st->count) return -1;
-    if (!st->order_valid) rebuild_order((ConsoleStore*)st);
+    if (!st || index<0) return -1;
     int phys = phys_index(st, index);
     if (phys<0) return -1;
     const ConEntry* e = &st->entries[phys];
@@ -590,3 +715,186 @@ void con_store_prompt_apply_meta(ConsoleStore* st, int user_id, int edits_inc, i
     /* содержимое buf не трогаем — оно локальное */
     notify(st);
 }
+
+/* ===== Бинарный снапшот =====
+   Все числа — little-endian. Раскладка:
+     magic "CSN1" | u16 ver | u16 flags(0) | u64 next_id | u32 n_entries | u32 n_prompts
+     | u32 text_bytes | u32 blob_bytes                                       (32 байта)
+     n_prompts × { i32 edits | u32 nonempty }
+     n_entries × { u8 type | u8 depth | u16 rsv | i32 user | u64 id
+                   | CON_POS_MAX_DEPTH × (u16 digit, u32 actor) | u32 a | u32 b | u32 c }
+       TEXT:     a=смещение в области текста, b=длина (без '\0')
+       WIDGET:   a=смещение в области blob’ов, b=длина, c=kind (ConsoleWidget.kind)
+       SNAPSHOT: b=dropped_count
+     область текста: строки подряд, каждая с '\0' (загрузчик берёт её целиком одним memcpy)
+     область blob’ов: состояния виджетов (get_state_blob)
+   В снапшот попадает только горячее окно; холодный ярус остаётся локальным. */
+#define SNAP_HDR_BYTES    32u
+#define SNAP_PROMPT_BYTES 8u
+#define SNAP_REC_BYTES    (1u+1u+2u+4u+8u + (unsigned)CON_POS_MAX_DEPTH*(2u+4u) + 12u)
+
+static inline void wr16(uint8_t** p, uint16_t v){ uint8_t* d=*p; d[0]=(uint8_t)v; d[1]=(uint8_t)(v>>8); *p+=2; }
+static inline void wr32(uint8_t** p, uint32_t v){
+    uint8_t* d=*p; d[0]=(uint8_t)v; d[1]=(uint8_t)(v>>8); d[2]=(uint8_t)(v>>16); d[3]=(uint8_t)(v>>24); *p+=4;
+}
+static inline void wr64(uint8_t** p, uint64_t v){ wr32(p,(uint32_t)v); wr32(p,(uint32_t)(v>>32)); }
+static inline uint16_t rd16(const uint8_t** p){ const uint8_t* s=*p; *p+=2; return (uint16_t)(s[0] | (uint16_t)s[1]<<8); }
+static inline uint32_t rd32(const uint8_t** p){ const uint8_t* s=*p; *p+=4; return (uint32_t)s[0] | ((uint32_t)s[1]<<8) | ((uint32_t)s[2]<<16) | ((uint32_t)s[3]<<24); }
+static inline uint64_t rd64(const uint8_t** p){ uint64_t lo=rd32(p), hi=rd32(p); return lo | (hi<<32); }
+
+static size_t widget_blob_size(ConsoleWidget* w){
+    size_t n = 0;
+    if (!w || !w->kind || !w->get_state_blob) return 0;
+    w->get_state_blob(w, NULL, &n); /* запрос размера */
+    return n;
+}
+
+int con_store_serialize(ConsoleStore* st, void** out_blob, size_t* out_len){
+    if (out_blob) *out_blob = NULL;
+    if (out_len)  *out_len  = 0;
+    if (!st || !out_blob || !out_len) return 0;
+
+    /* проход 1: размеры областей */
+    size_t text_bytes = 0, blob_bytes = 0;
+    for (int i=0;i<st->order_n;i++){
+        const ConEntry* e = &st->entries[st->order[i]];
+        if (e->type == CON_ENTRY_TEXT) text_bytes += (size_t)e->as.text.len + 1;
+        else if (e->type == CON_ENTRY_WIDGET) blob_bytes += widget_blob_size(e->as.widget);
+    }
+    if (text_bytes > UINT32_MAX || blob_bytes > UINT32_MAX) return 0;
+    size_t total = SNAP_HDR_BYTES + (size_t)CON_MAX_USERS*SNAP_PROMPT_BYTES
+                 + (size_t)st->order_n*SNAP_REC_BYTES + text_bytes + blob_bytes;
+    uint8_t* buf = (uint8_t*)malloc(total ? total : 1);
+    if (!buf) return 0;
+
+    /* проход 2: запись */
+    uint8_t* p = buf;
+    memcpy(p, "CSN1", 4); p += 4;
+    wr16(&p, CON_STORE_SNAPSHOT_VERSION); wr16(&p, 0);
+    wr64(&p, st->next_id);
+    wr32(&p, (uint32_t)st->order_n); wr32(&p, CON_MAX_USERS);
+    wr32(&p, (uint32_t)text_bytes);  wr32(&p, (uint32_t)blob_bytes);
+    for (int u=0;u<CON_MAX_USERS;u++){ wr32(&p, (uint32_t)st->prompts[u].edits); wr32(&p, (uint32_t)st->prompts[u].nonempty); }
+
+    uint8_t* text = buf + total - blob_bytes - text_bytes;
+    uint8_t* blobs = buf + total - blob_bytes;
+    uint32_t toff = 0, boff = 0;
+    for (int i=0;i<st->order_n;i++){
+        const ConEntry* e = &st->entries[st->order[i]];
+        uint32_t a = 0, b = 0, c = 0;
+        if (e->type == CON_ENTRY_TEXT){
+            a = toff; b = (uint32_t)e->as.text.len;
+            if (b) memcpy(text + toff, e->as.text.s, b);
+            text[toff + b] = 0;
+            toff += b + 1;
+        } else if (e->type == CON_ENTRY_WIDGET){
+            size_t n = widget_blob_size(e->as.widget);
+            if (n && !e->as.widget->get_state_blob(e->as.widget, blobs + boff, &n)) n = 0;
+            a = boff; b = (uint32_t)n; c = e->as.widget ? e->as.widget->kind : 0;
+            boff += b;
+        } else if (e->type == CON_ENTRY_SNAPSHOT){
+            b = (uint32_t)e->as.snap.dropped_count;
+        }
+        *p++ = (uint8_t)e->type;
+        *p++ = e->pos.depth;
+        wr16(&p, 0);
+        wr32(&p, (uint32_t)e->user_id);
+        wr64(&p, e->id);
+        for (int k=0;k<CON_POS_MAX_DEPTH;k++){
+            wr16(&p, k<e->pos.depth ? e->pos.comp[k].digit : 0);
+            wr32(&p, k<e->pos.depth ? e->pos.comp[k].actor : 0);
+        }
+        wr32(&p, a); wr32(&p, b); wr32(&p, c);
+    }
+    /* область blob’ов могла оказаться короче (виджет отказался сериализоваться) — хвост нулевой */
+    if (boff < blob_bytes) memset(blobs + boff, 0, blob_bytes - boff);
+    *out_blob = buf;
+    *out_len  = total;
+    return 1;
+}
+
+int con_store_load_snapshot(ConsoleStore* st, const void* blob, size_t len, ConWidgetFactory make_widget){
+    if (!st || !blob || len < SNAP_HDR_BYTES) return 0;
+    const uint8_t* p = (const uint8_t*)blob;
+    if (memcmp(p, "CSN1", 4) != 0) return 0;
+    p += 4;
+    uint16_t ver = rd16(&p); (void)rd16(&p);
+    if (ver != CON_STORE_SNAPSHOT_VERSION) return 0;
+    uint64_t next_id   = rd64(&p);
+    uint32_t n         = rd32(&p);
+    uint32_t n_prompts = rd32(&p);
+    uint32_t text_bytes= rd32(&p);
+    uint32_t blob_bytes= rd32(&p);
+    /* проверка размеров целиком до какой-либо мутации */
+    uint64_t need = (uint64_t)SNAP_HDR_BYTES + (uint64_t)n_prompts*SNAP_PROMPT_BYTES
+                  + (uint64_t)n*SNAP_REC_BYTES + text_bytes + blob_bytes;
+    if (need != len) return 0;
+    const uint8_t* prompts = p;
+    const uint8_t* recs    = prompts + (size_t)n_prompts*SNAP_PROMPT_BYTES;
+    const char*    text    = (const char*)(recs + (size_t)n*SNAP_REC_BYTES);
+    const uint8_t* blobs   = (const uint8_t*)text + text_bytes;
+
+    /* тексты — одним memcpy в арену; +1 ссылка на время загрузки
+       (компактация внутри цикла может отпустить уже вставленные строки) */
+    SnapArena* arena = (SnapArena*)malloc(sizeof(SnapArena) + (text_bytes ? text_bytes : 1));
+    if (!arena) return 0;
+    arena->refs = 1;
+    if (text_bytes) memcpy(arena->data, text, text_bytes);
+
+    int applied = 0;
+    for (uint32_t i=0;i<n;i++){
+        const uint8_t* r = recs + (size_t)i*SNAP_REC_BYTES;
+        ConEntryType type = (ConEntryType)*r++;
+        uint8_t depth = *r++;
+        r += 2;
+        int user = (int)rd32(&r);
+        ConItemId id = rd64(&r);
+        ConPosId pos; memset(&pos, 0, sizeof(pos));
+        pos.depth = (depth > CON_POS_MAX_DEPTH) ? CON_POS_MAX_DEPTH : depth;
+        for (int k=0;k<CON_POS_MAX_DEPTH;k++){
+            uint16_t d = rd16(&r); uint32_t a = rd32(&r);
+            if (k < pos.depth){ pos.comp[k].digit = d; pos.comp[k].actor = a; }
+        }
+        uint32_t a = rd32(&r), b = rd32(&r), c = rd32(&r);
+        if (id==CON_ITEMID_INVALID || has_id(st, id)) continue; /* идемпотентно: уже есть */
+
+        ConsoleWidget* w = NULL;
+        if (type == CON_ENTRY_TEXT){
+            /* строка обязана целиком лежать в области текста и кончаться '\0' */
+            if ((uint64_t)a + b >= text_bytes || arena->data[a + b] != 0) continue;
+        } else if (type == CON_ENTRY_WIDGET){
+            if ((uint64_t)a + b > blob_bytes || !make_widget) continue;
+            w = make_widget(c, b ? blobs + a : NULL, b);
+            if (!w) continue;
+        } else if (type != CON_ENTRY_SNAPSHOT) continue;
+
+        int idx = (st->head + st->count) % CON_BUF_LINES;
+        slot_release(st, idx);
+        ConEntry* e = &st->entries[idx];
+        e->type = type; e->id = id; e->pos = pos; e->user_id = (user>=0)? user : -1;
+        if (type == CON_ENTRY_TEXT){
+            e->as.text.s = arena->data + a; e->as.text.len = (int)b;
+            e->arena = arena; arena->refs++;
+        } else if (type == CON_ENTRY_WIDGET){
+            e->as.widget = w;
+        } else {
+            e->as.snap.dropped_count = (int)b;
+        }
+        slot_commit(st, idx);
+        maybe_compact_tail(st);
+        applied++;
+    }
+    arena_unref(arena);
+
+    if (next_id > st->next_id) st->next_id = next_id;
+    for (uint32_t u=0; u<n_prompts && u<CON_MAX_USERS; u++){
+        const uint8_t* q = prompts + (size_t)u*SNAP_PROMPT_BYTES;
+        int edits = (int)rd32(&q), nonempty = (int)rd32(&q);
+        if (edits > st->prompts[u].edits) st->prompts[u].edits = edits;
+        /* собственный локальный буфер главнее удалённой метки */
+        if (st->prompts[u].len == 0) st->prompts[u].nonempty = nonempty ? 1 : 0;
+    }
+    if (applied) changes_mark_all(st);
+    notify(st);
+    return 1;
+}
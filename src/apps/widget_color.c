@@ -57,11 +57,7 @@ static void color_draw(ConsoleWidget* self, Surface* dst, int x, int y, int w, i
 
     /* подпись */
     char label[32]; SDL_snprintf(label, sizeof(label), "R=%d", cs->value);
-    Surface* lab = text_render_utf8(label, 0xFFFFFFFF);
-    if (lab){
-        surface_blit(lab, 0,0, surface_w(lab), surface_h(lab), dst, x+4, y+4);
-        surface_free(lab);
-    }
+    text_draw_utf8(dst, x+4, y+4, label, 0xFFFFFFFF);
 }
 
 /* адресные сообщения
@@ -165,5 +161,6 @@ ConsoleWidget* widget_color_create(uint8_t initial_r0_255){
     cs->base.as_text  = color_as_text;
     cs->base.get_state_blob = color_get_state_blob;
     cs->base.destroy  = color_destroy;
+    cs->base.kind     = 1; /* ColorSlider (ConOp.widget_kind) */
     return (ConsoleWidget*)cs;
 }
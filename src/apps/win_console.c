@@ -4,6 +4,7 @@
 #include "../core/drag.h"
 #include "../core/timing.h"
 #include "../core/wm.h"
+#include "../platform/platform_sdl.h"
 #include <SDL.h>
 #include <string.h>
 #include <stdlib.h>
@@ -191,10 +192,7 @@ static void console_on_frame_changed(Window* w, int old_w, int old_h){
 
 static void draw_line_text(Surface *dst, int x, int y, const char *s, uint32_t argb){
     if (!s || !*s) return;
-    Surface *glyph = text_render_utf8(s, argb);
-    if (!glyph) return;
-    surface_blit(glyph, 0,0, surface_w(glyph), surface_h(glyph), dst, x,y);
-    surface_free(glyph);
+    text_draw_utf8(dst, x, y, s, argb);
 }
 
 /* Текст для снапшота */
@@ -322,13 +320,12 @@ static void console_draw(Window *w, const Rect *area){
             if (nonempty){
                 char msg[64];
                 SDL_snprintf(msg, sizeof(msg), "user_%d typing [%d]", uid, edits);
-                Surface* g = text_render_utf8(msg, USER_COLORS[uid & 1]);
-                if (g){
+                int mw = 0, mh = 0;
+                if (text_measure_utf8(msg, &mw, &mh) == 0){
                     /* рисуем справа от поля */
-                    int gx = surface_w(w->cache) - surface_w(g) - 8;
+                    int gx = surface_w(w->cache) - mw - 8;
                     if (gx < 8) gx = 8;
-                    surface_blit(g, 0,0, surface_w(g), surface_h(g), w->cache, gx, label_y);
-                    surface_free(g);
+                    text_draw_utf8(w->cache, gx, label_y, msg, USER_COLORS[uid & 1]);
                 }
             }
         }
@@ -542,7 +539,7 @@ static void console_on_event(Window *w, void* wm, const InputEvent *e, int lx, i
                                 pkt.h.schema   = CON_DELTA_SCHEMA_V1;
                                 pkt.h.kind     = CON_DELTA_KIND_LWW_SET;
                                 pkt.h.flags    = 0;
-                                pkt.h.hlc      = con_sink_tick_hlc(st->sink, SDL_GetTicks());
+                                pkt.h.hlc      = con_sink_tick_hlc(st->sink, plat_now_ms());
                                 pkt.h.actor_id = con_sink_get_actor_id(st->sink);
                                 pkt.h.reserved = 0;
                                 con_sink_widget_delta(st->sink, e->user_id, wid, "cw.delta", &pkt, sizeof(pkt));
@@ -744,6 +741,7 @@ void win_console_set_lazy_mode(Window* w, LazyMode mode){
 
 void win_console_init(Window *w, WM* wm, Rect frame, int z, ConsoleStore* store, ConsoleProcessor* proc, ConsoleSink* sink, int prompt_user_id){
     window_init(w, "console", frame, z, &V);
+    w->opaque = true; /* фон col_bg непрозрачный, строки перерисовываются поверх него */
 
     ConsoleViewState *st = (ConsoleViewState*)calloc(1, sizeof(ConsoleViewState));
     st->col_bg = 0xFF000000;
@@ -56,5 +56,6 @@ static const WindowVTable V = {
 
 void win_paint_init(Window *w, Rect frame, int z){
     window_init(w, "paint", frame, z, &V);
+    w->opaque = true; /* шахматка + белые штрихи — без прозрачности */
     surface_checkerboard(w->cache, 16, 0xFF181818, 0xFF101010);
 }
@@ -3,6 +3,7 @@
 #include "../core/wm.h"
 #include "../core/drag.h"
 #include "../core/timing.h"
+#include "../platform/platform_sdl.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -145,7 +146,7 @@ static void on_drop(Window* w, WMDrag* d, int lx, int ly){
         st->colB = p->colB;
         st->period_ms = p->period_ms;
         st->phase_bias = p->phase_bias;
-        st->start_ms = SDL_GetTicks();
+        st->start_ms = plat_now_ms();
         w->invalid_all = true;
     }
     d->effect = WM_DRAG_COPY;
@@ -166,12 +167,13 @@ static const WindowVTable V = {
 void win_square_init(Window *w, Rect frame, int z,
                      uint32_t colA, uint32_t colB, uint32_t period_ms, float phase){
     window_init(w, "square", frame, z, &V);
+    w->opaque = true; /* фон залит 0xFF101010 */
     SquareState *st = (SquareState*)malloc(sizeof(SquareState));
     memset(st,0,sizeof(*st));
     st->colA=colA; st->colB=colB; st->period_ms=period_ms; st->phase_bias=phase;
-    st->start_ms = SDL_GetTicks();
+    st->start_ms = plat_now_ms();
     st->color = colA;
     w->user = st;
     w->animating = true;
-    w->next_anim_ms = SDL_GetTicks();
+    w->next_anim_ms = plat_now_ms();
 }
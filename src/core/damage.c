@@ -1,5 +1,193 @@
-// damage.c — реализация находится в static inline-функциях damage.h.
-// Этот файл нужен только для того, чтобы существовал объектный модуль
-// при сборке по Makefile (SRC_CORE включает damage.c).
-
 #include "damage.h"
+#include <string.h>
+
+/* Рабочий стек кусков при вставке: каждый разрез даёт ≤4 куска */
+#define DAMAGE_WORK (4*MAX_DAMAGE + 4)
+
+static inline int  r_x1(Rect r){ return r.x + r.w; }
+static inline int  r_y1(Rect r){ return r.y + r.h; }
+static inline long long r_area(Rect r){ return (long long)r.w * r.h; }
+static inline int  r_contains(Rect a, Rect b){
+    return b.x >= a.x && b.y >= a.y && r_x1(b) <= r_x1(a) && r_y1(b) <= r_y1(a);
+}
+static inline int  r_overlaps(Rect a, Rect b){
+    return a.x < r_x1(b) && b.x < r_x1(a) && a.y < r_y1(b) && b.y < r_y1(a);
+}
+/* перекрываются или касаются стороной */
+static inline int  r_touches(Rect a, Rect b){
+    return a.x <= r_x1(b) && b.x <= r_x1(a) && a.y <= r_y1(b) && b.y <= r_y1(a);
+}
+static inline Rect r_union(Rect a, Rect b){
+    int x0 = a.x < b.x ? a.x : b.x, y0 = a.y < b.y ? a.y : b.y;
+    int x1 = r_x1(a) > r_x1(b) ? r_x1(a) : r_x1(b);
+    int y1 = r_y1(a) > r_y1(b) ? r_y1(a) : r_y1(b);
+    return rect_make(x0, y0, x1 - x0, y1 - y0);
+}
+static int r_mergeable(Rect a, Rect b){
+    Rect u = r_union(a, b);
+    long long waste = r_area(u) - r_area(a) - r_area(b) + r_area(rect_intersect(a, b));
+    return waste <= DAMAGE_MERGE_SLACK_PX || waste * 8 <= r_area(u);
+}
+static Rect clip(const DamageList* d, Rect rc){
+    if (d->bw > 0 && d->bh > 0) rc = rect_intersect(rc, rect_make(0, 0, d->bw, d->bh));
+    return rc;
+}
+
+void damage_init(DamageList *d){ memset(d, 0, sizeof(*d)); }
+
+void damage_clear(DamageList *d){
+    d->n = 0;
+    if (d->tiled){ memset(d->tiles, 0, sizeof(d->tiles)); d->tiled = 0; }
+    d->dirty = 0;
+}
+
+void damage_set_bounds(DamageList *d, int w, int h){
+    d->bw = w > 0 ? w : 0; d->bh = h > 0 ? h : 0;
+    int tw = (d->bw + DAMAGE_GRID - 1) / DAMAGE_GRID, th = (d->bh + DAMAGE_GRID - 1) / DAMAGE_GRID;
+    d->tile_w = tw > DAMAGE_TILE_MIN ? tw : DAMAGE_TILE_MIN;
+    d->tile_h = th > DAMAGE_TILE_MIN ? th : DAMAGE_TILE_MIN;
+    /* накопленное в старой сетке переводим в rect'ы и растеризуем заново */
+    if (d->tiled){
+        int n = damage_count(d);
+        Rect tmp[MAX_DAMAGE]; memcpy(tmp, d->r, (size_t)n * sizeof(Rect));
+        damage_clear(d);
+        for (int i=0;i<n;i++) damage_add(d, tmp[i]);
+    }
+}
+
+/* ===== Режим плиток ===== */
+static void tiles_mark(DamageList *d, Rect rc){
+    rc = clip(d, rc);
+    if (rect_is_empty(rc)) return;
+    int tx0 = rc.x / d->tile_w, tx1 = (r_x1(rc) - 1) / d->tile_w;
+    int ty0 = rc.y / d->tile_h, ty1 = (r_y1(rc) - 1) / d->tile_h;
+    if (tx1 >= DAMAGE_GRID) tx1 = DAMAGE_GRID - 1;
+    if (ty1 >= DAMAGE_GRID) ty1 = DAMAGE_GRID - 1;
+    uint64_t hi = (tx1 == 63) ? ~0ull : ((1ull << (tx1 + 1)) - 1ull);
+    uint64_t mask = hi & ~((1ull << tx0) - 1ull);
+    for (int y = ty0; y <= ty1; y++) d->tiles[y] |= mask;
+    d->dirty = 1;
+}
+
+static Rect tile_rect(const DamageList *d, int tx0, int tx1, int ty0, int ty1){
+    Rect r = rect_make(tx0 * d->tile_w, ty0 * d->tile_h,
+                       (tx1 - tx0 + 1) * d->tile_w, (ty1 - ty0 + 1) * d->tile_h);
+    return clip(d, r);
+}
+
+/* Битмап → rect'ы: серии плиток в строке, одинаковые серии соседних строк
+   сливаются по вертикали. Если выходит больше MAX_DAMAGE — полосы по строкам
+   (bbox серий строки), их не больше DAMAGE_GRID. */
+static void tiles_emit(DamageList *d){
+    int n = 0, ok = 1;
+    int sx0[MAX_DAMAGE], sx1[MAX_DAMAGE], sy0[MAX_DAMAGE], sy1[MAX_DAMAGE];
+    for (int y = 0; y < DAMAGE_GRID && ok; y++){
+        uint64_t m = d->tiles[y];
+        int x = 0;
+        while (ok && x < 64 && (m >> x)){
+            while (!((m >> x) & 1ull)) x++;
+            int x0 = x;
+            while (x < 64 && ((m >> x) & 1ull)) x++;
+            int x1 = x - 1, k;
+            for (k = 0; k < n; k++) if (sy1[k] == y - 1 && sx0[k] == x0 && sx1[k] == x1) break;
+            if (k < n){ sy1[k] = y; continue; }
+            if (n == MAX_DAMAGE){ ok = 0; break; }
+            sx0[n] = x0; sx1[n] = x1; sy0[n] = sy1[n] = y;
+            n++;
+        }
+    }
+    if (ok){
+        for (int k = 0; k < n; k++) d->r[k] = tile_rect(d, sx0[k], sx1[k], sy0[k], sy1[k]);
+        d->n = n;
+        return;
+    }
+    /* фолбэк: по полосе на строку (bbox серий), одинаковые соседние полосы — вместе */
+    n = 0;
+    int have = 0, bx0 = 0, bx1 = 0, by0 = 0;
+    for (int y = 0; y <= DAMAGE_GRID; y++){
+        uint64_t m = (y < DAMAGE_GRID) ? d->tiles[y] : 0;
+        int x0 = -1, x1 = -1;
+        if (m){
+            x0 = 0; while (!((m >> x0) & 1ull)) x0++;
+            x1 = 63; while (!((m >> x1) & 1ull)) x1--;
+        }
+        if (have && (x0 != bx0 || x1 != bx1)){
+            d->r[n++] = tile_rect(d, bx0, bx1, by0, y - 1);
+            have = 0;
+        }
+        if (m && !have){ have = 1; bx0 = x0; bx1 = x1; by0 = y; }
+    }
+    d->n = n;
+}
+
+static void to_tiles(DamageList *d){
+    d->tiled = 1;
+    for (int i=0;i<d->n;i++) tiles_mark(d, d->r[i]);
+    d->n = 0;
+    d->dirty = 1;
+}
+
+/* Без границ плитки не построить — сворачиваем всё в один bbox */
+static void to_bbox(DamageList *d, Rect extra){
+    Rect u = extra;
+    for (int i=0;i<d->n;i++) u = rect_is_empty(u) ? d->r[i] : r_union(u, d->r[i]);
+    d->r[0] = u; d->n = rect_is_empty(u) ? 0 : 1;
+}
+
+void damage_add(DamageList *d, Rect rc){
+    rc = clip(d, rc);
+    if (rect_is_empty(rc)) return;
+    if (d->tiled){ tiles_mark(d, rc); return; }
+
+    /* куски после разреза больше не склеиваем — иначе два соседа могут
+       бесконечно перетягивать друг у друга одни и те же полосы */
+    Rect st[DAMAGE_WORK]; int sp = 0;
+    st[sp++] = rc;
+    int merge_ok = 1;
+    while (sp){
+        Rect r = st[--sp];
+    rescan:
+        for (int i=0;i<d->n;i++){
+            Rect e = d->r[i];
+            if (!r_touches(e, r)) continue;
+            if (r_contains(e, r)) goto next;
+            if (r_contains(r, e) || (merge_ok && r_mergeable(e, r))){
+                /* e поглощается; объединение может задеть других — проверяем заново */
+                r = r_union(e, r);
+                d->r[i] = d->r[--d->n];
+                goto rescan;
+            }
+            if (r_overlaps(e, r)){
+                Rect parts[4];
+                int k = rect_subtract(r, e, parts);
+                if (sp + k > DAMAGE_WORK) break; /* не влезло — ниже уйдём в плитки */
+                for (int j=0;j<k;j++) st[sp++] = parts[j];
+                merge_ok = 0;
+                goto next;
+            }
+        }
+        if (d->n >= DAMAGE_RECT_SOFT || d->n >= MAX_DAMAGE || sp >= DAMAGE_WORK - 4){
+            if (d->bw > 0 && d->bh > 0){
+                to_tiles(d);
+                tiles_mark(d, r);
+                while (sp) tiles_mark(d, st[--sp]);
+            } else {
+                while (sp){ Rect s = st[--sp]; r = r_union(r, s); }
+                to_bbox(d, r);
+            }
+            return;
+        }
+        d->r[d->n++] = r;
+    next:;
+    }
+}
+
+int damage_count(DamageList *d){
+    if (d->tiled && d->dirty){ tiles_emit(d); d->dirty = 0; }
+    return d->n;
+}
+
+Rect damage_at(DamageList *d, int i){
+    damage_count(d);
+    return (i >= 0 && i < d->n) ? d->r[i] : rect_make(0, 0, 0, 0);
+}
@@ -1,17 +1,46 @@
 #pragma once
+#include <stdint.h>
 #include "window.h"
 
+/* Накопитель damage за кадр. Прямоугольники хранятся непересекающимися:
+ * новый rect режется о старые, соседние/перекрывающиеся с малым перерасходом
+ * площади склеиваются. Когда прямоугольников становится много — переходим
+ * на грубый битмап плиток (DAMAGE_GRID × DAMAGE_GRID над экраном) и выдаём
+ * из него полосы. Ничего не теряется: в худшем случае регион чуть шире. */
+
+/* Максимум прямоугольников, отдаваемых компоновщику */
 #define MAX_DAMAGE 64
+
+/* Порог числа rect'ов, после которого копим в плитках */
+#ifndef DAMAGE_RECT_SOFT
+#define DAMAGE_RECT_SOFT 32
+#endif
+/* Плиток по каждой оси (строка плиток — одно 64-битное слово) */
+#define DAMAGE_GRID 64
+/* Минимальная сторона плитки, px */
+#ifndef DAMAGE_TILE_MIN
+#define DAMAGE_TILE_MIN 16
+#endif
+/* Склейка двух rect'ов допустима, если лишняя площадь ≤ 1/8 объединения или ≤ этого числа px */
+#ifndef DAMAGE_MERGE_SLACK_PX
+#define DAMAGE_MERGE_SLACK_PX (32*32)
+#endif
+
 typedef struct {
-    Rect r[MAX_DAMAGE];
+    Rect r[MAX_DAMAGE];   /* непересекающиеся; в режиме плиток — собираются из битмапа */
     int n;
+    int bw, bh;           /* границы экрана; 0 — неизвестны (тогда вместо плиток — общий bbox) */
+    int tiled;            /* копим в tiles[] */
+    int dirty;            /* tiles[] изменился, r[] надо пересобрать */
+    int tile_w, tile_h;
+    uint64_t tiles[DAMAGE_GRID];
 } DamageList;
 
-static inline void damage_init(DamageList *d){ d->n=0; }
-static inline void damage_clear(DamageList *d){ d->n=0; }
-static inline int  damage_count(const DamageList *d){ return d->n; }
-static inline Rect damage_at(const DamageList *d, int i){ return d->r[i]; }
-static inline void damage_add(DamageList *d, Rect rc){
-    if (rc.w<=0 || rc.h<=0) return;
-    if (d->n < MAX_DAMAGE) d->r[d->n++] = rc;
-}
+void damage_init(DamageList *d);
+void damage_clear(DamageList *d);
+/* Границы экрана: rect'ы обрезаются по ним, размер плиток считается от них */
+void damage_set_bounds(DamageList *d, int w, int h);
+void damage_add(DamageList *d, Rect rc);
+/* Непересекающийся набор, покрывающий всё добавленное с последнего clear */
+int  damage_count(DamageList *d);
+Rect damage_at(DamageList *d, int i);
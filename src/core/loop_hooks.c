@@ -1,4 +1,6 @@
 #include "core/loop_hooks.h"
+#include "core/perf.h"
+#include <stdio.h>
 #include <stdlib.h>
 
 struct LoopHookHandle {
@@ -6,6 +8,7 @@ struct LoopHookHandle {
     LoopHookFn fn;
     void* user;
     int alive; /* 1 — активен, 0 — к удалению */
+    int perf_slot; /* -1 — не меряется */
     struct LoopHookHandle* next;
 };
 
@@ -18,6 +21,7 @@ LoopHookHandle* loop_hook_add_end_of_frame(int priority, LoopHookFn fn, void* us
     h->fn = fn;
     h->user = user;
     h->alive = 1;
+    h->perf_slot = -1;
 
     /* Вставка по приоритету (меньше — раньше) */
     if (!g_end_of_frame || priority < g_end_of_frame->priority){
@@ -32,6 +36,13 @@ LoopHookHandle* loop_hook_add_end_of_frame(int priority, LoopHookFn fn, void* us
     return h;
 }
 
+void loop_hook_set_name(LoopHookHandle* h, const char* name){
+    if (!h) return;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "hook:%s", name ? name : "");
+    h->perf_slot = name ? perf_slot(buf) : -1;
+}
+
 void loop_hook_remove(LoopHookHandle* h){
     if (!h) return;
     h->alive = 0; /* фактическое освобождение — после прогона */
@@ -40,7 +51,14 @@ void loop_hook_remove(LoopHookHandle* h){
 void loop_hook_run_end_of_frame(uint32_t now_ms){
     /* вызов */
     for (struct LoopHookHandle* it = g_end_of_frame; it; it = it->next){
-        if (it->alive && it->fn) it->fn(it->user, now_ms);
+        if (!it->alive || !it->fn) continue;
+        if (it->perf_slot >= 0 && perf_enabled()){
+            uint64_t t0 = perf_now_ns();
+            it->fn(it->user, now_ms);
+            perf_record(it->perf_slot, perf_now_ns() - t0);
+        } else {
+            it->fn(it->user, now_ms);
+        }
     }
     /* сборка мусора (удаляем помеченные) */
     struct LoopHookHandle* prev = NULL;
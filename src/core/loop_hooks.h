@@ -11,6 +11,9 @@ extern "C" {
     /* Добавить хук конца кадра. Чем меньше priority — тем раньше выполняется. */
     LoopHookHandle* loop_hook_add_end_of_frame(int priority, LoopHookFn fn, void* user);
 
+    /* Имя для профайлера: время хука пишется в слот "hook:<name>" (безымянные не меряются). */
+    void loop_hook_set_name(LoopHookHandle* h, const char* name);
+
     /* Ленивая отписка (удаляется/освобождается после ближайшего прогона). */
     void loop_hook_remove(LoopHookHandle* h);
 
@@ -0,0 +1,111 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime/CLOCK_MONOTONIC */
+#endif
+#include "core/perf.h"
+#include <string.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+typedef struct {
+    char     name[32];
+    uint64_t count, total, max;
+    uint32_t hist[PERF_BUCKETS];
+} PerfSlot;
+
+static PerfSlot g_slots[PERF_MAX_SLOTS];
+static int      g_nslots = 0;
+int g_perf_enabled = 1;
+
+uint64_t perf_now_ns(void){
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER c;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)((double)c.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void perf_set_enabled(int on){ g_perf_enabled = on ? 1 : 0; }
+
+/* Корзина: 0..3 — точные значения, дальше по PERF_SUB на октаву */
+static int bucket_of(uint64_t v){
+    if (v < PERF_SUB) return (int)v;
+    int e = 63;
+    while (!((v >> e) & 1u)) e--;
+    if (e > PERF_OCTAVES) return PERF_BUCKETS - 1;
+    int b = (e - 1) * PERF_SUB + (int)((v >> (e - 2)) & (PERF_SUB - 1));
+    return b < PERF_BUCKETS ? b : PERF_BUCKETS - 1;
+}
+/* Верхняя граница корзины — оценка перцентиля сверху */
+static uint64_t bucket_hi(int b){
+    if (b < PERF_SUB) return (uint64_t)b;
+    int e = b / PERF_SUB + 1, sub = b % PERF_SUB;
+    uint64_t lo = (uint64_t)(PERF_SUB + sub) << (e - 2);
+    return lo + (1ull << (e - 2)) - 1;
+}
+
+int perf_slot(const char* name){
+    if (!name) return -1;
+    for (int i = 0; i < g_nslots; i++) if (strcmp(g_slots[i].name, name) == 0) return i;
+    if (g_nslots >= PERF_MAX_SLOTS) return -1;
+    PerfSlot* s = &g_slots[g_nslots];
+    memset(s, 0, sizeof(*s));
+    strncpy(s->name, name, sizeof(s->name) - 1);
+    return g_nslots++;
+}
+
+void perf_record(int slot, uint64_t ns){
+    if (!g_perf_enabled || slot < 0 || slot >= g_nslots) return;
+    PerfSlot* s = &g_slots[slot];
+    s->count++; s->total += ns;
+    if (ns > s->max) s->max = ns;
+    s->hist[bucket_of(ns)]++;
+}
+
+void perf_record_named(int* slot, const char* name, uint64_t ns){
+    if (!g_perf_enabled || !slot) return;
+    if (*slot < 0) *slot = perf_slot(name);
+    perf_record(*slot, ns);
+}
+
+static uint64_t percentile(const PerfSlot* s, uint64_t rank){
+    uint64_t acc = 0;
+    for (int b = 0; b < PERF_BUCKETS; b++){
+        acc += s->hist[b];
+        if (acc >= rank){ uint64_t hi = bucket_hi(b); return hi < s->max ? hi : s->max; }
+    }
+    return s->max;
+}
+
+int perf_summary(PerfSummary* out, int cap){
+    int n = 0;
+    for (int i = 0; i < g_nslots && n < cap; i++){
+        const PerfSlot* s = &g_slots[i];
+        if (!s->count) continue;
+        PerfSummary* o = &out[n++];
+        o->name = s->name;
+        o->count = s->count;
+        o->total_ns = s->total;
+        o->max_ns = s->max;
+        o->p50_ns = percentile(s, (s->count + 1) / 2);
+        o->p99_ns = percentile(s, s->count - s->count / 100);
+    }
+    return n;
+}
+
+void perf_reset(void){
+    for (int i = 0; i < g_nslots; i++){
+        PerfSlot* s = &g_slots[i];
+        s->count = s->total = s->max = 0;
+        memset(s->hist, 0, sizeof(s->hist));
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* Покадровый профайлер: именованные слоты, в каждом — гистограмма длительностей
+ * с фиксированными корзинами (по PERF_SUB на каждую степень двойки наносекунд,
+ * ошибка оценки перцентиля ≤ 1/PERF_SUB). Запись — O(1), без аллокаций.
+ * Вызывать только из главного потока (рабочие потоки компоновщика не пишут).
+ *
+ *   static int s_slot = -1;
+ *   uint64_t t0 = perf_now_ns();
+ *   ...
+ *   perf_record_named(&s_slot, "compose", perf_now_ns() - t0);
+ */
+
+#ifndef PERF_MAX_SLOTS
+#define PERF_MAX_SLOTS 64
+#endif
+/* корзин на октаву и число октав (2^PERF_OCTAVES нс ≈ 18 минут) */
+#define PERF_SUB     4
+#define PERF_OCTAVES 40
+#define PERF_BUCKETS (PERF_SUB * PERF_OCTAVES)
+
+typedef struct {
+    const char* name;
+    uint64_t    count;
+    uint64_t    p50_ns, p99_ns, max_ns;
+    uint64_t    total_ns;
+} PerfSummary;
+
+/* Монотонное время, нс */
+uint64_t perf_now_ns(void);
+
+/* Включён ли сбор (по умолчанию — да). Выключенный профайлер сводится к одной проверке. */
+extern int g_perf_enabled;
+static inline int perf_enabled(void){ return g_perf_enabled; }
+void perf_set_enabled(int on);
+
+/* Слот по имени (создаётся при первом обращении; имя копируется). -1 — слоты кончились */
+int  perf_slot(const char* name);
+void perf_record(int slot, uint64_t ns);
+/* То же с кешированием номера слота в *slot (изначально -1) */
+void perf_record_named(int* slot, const char* name, uint64_t ns);
+
+/* Сводка по слотам с записями; возвращает число заполненных out[] (≤ cap) */
+int  perf_summary(PerfSummary* out, int cap);
+/* Обнулить гистограммы (имена слотов сохраняются) */
+void perf_reset(void);
@@ -12,6 +12,7 @@ void window_init(Window *w, const char *name, Rect frame, int z, const WindowVTa
     w->animating = false;
     w->invalid_all = true;
     w->vt = vt;
+    w->perf_slot = -1;
     /* защитимся от нулевых размеров */
     int cw = frame.w > 0 ? frame.w : 1;
     int ch = frame.h > 0 ? frame.h : 1;
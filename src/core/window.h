@@ -17,6 +17,17 @@ static inline Rect rect_intersect(Rect a, Rect b){
     int y1=(a.y+a.h<b.y+b.h)?a.y+a.h:b.y+b.h;
     Rect r={x0,y0,x1-x0,y1-y0}; if(r.w<0)r.w=0; if(r.h<0)r.h=0; return r;
 }
+/* r минус e: до 4 непересекающихся полос (верх, низ, лево, право); если e не задевает r — сам r */
+static inline int  rect_subtract(Rect r, Rect e, Rect out[4]){
+    Rect i = rect_intersect(r, e);
+    if (rect_is_empty(i)){ out[0] = r; return 1; }
+    int n = 0;
+    if (i.y > r.y)                 out[n++] = rect_make(r.x, r.y, r.w, i.y - r.y);
+    if (i.y + i.h < r.y + r.h)     out[n++] = rect_make(r.x, i.y + i.h, r.w, r.y + r.h - (i.y + i.h));
+    if (i.x > r.x)                 out[n++] = rect_make(r.x, i.y, i.x - r.x, i.h);
+    if (i.x + i.w < r.x + r.w)     out[n++] = rect_make(i.x + i.w, i.y, r.x + r.w - (i.x + i.w), i.h);
+    return n;
+}
 
 typedef struct {
     int user_id;
@@ -64,11 +75,13 @@ typedef struct Window {
 
     Surface *cache;     // ARGB32 per-window surface
     bool     invalid_all;
+    bool     opaque;    // cache целиком непрозрачен (alpha=0xFF): под окном компоновщик не рисует
 
     struct { int dragging, dx, dy; } drag;
 
     const WindowVTable *vt;
     void *user; // per-window state
+    int   perf_slot; // слот профайлера "draw:<name>" (-1 — ещё не заведён)
 } Window;
 
 void window_init(Window *w, const char *name, Rect frame, int z, const WindowVTable *vt);
@@ -27,6 +27,7 @@ WM* wm_create(int sw, int sh){
     WM *wm = (WM*)calloc(1,sizeof(WM));
     wm->screen_w = sw; wm->screen_h = sh;
     damage_init(&wm->damage);
+    damage_set_bounds(&wm->damage, sw, sh);
     /* drag-сессии пустые */
     memset(wm->drag, 0, sizeof(wm->drag));
     return wm;
@@ -80,6 +81,7 @@ Window* wm_topmost_at(WM* wm, int x,int y){
 void wm_resize(WM* wm, int newW, int newH){
     int oldW = wm->screen_w, oldH = wm->screen_h;
     wm->screen_w = newW; wm->screen_h = newH;
+    damage_set_bounds(&wm->damage, newW, newH);
     /* damage всего экрана */
     wm_damage_add(wm, rect_make(0,0,newW,newH));
     /* эвристика «фон»: окно, равное предыдущему экрану и привязанное к (0,0), растягиваем */
@@ -127,6 +129,27 @@ void wm_damage_add(WM* wm, Rect r){ damage_add(&wm->damage, r); }
 int  wm_damage_count(WM* wm){ return damage_count(&wm->damage); }
 Rect wm_damage_get(WM* wm, int i){ return damage_at(&wm->damage,i); }
 
+int wm_visible_parts(WM* wm, int below, Rect r, Rect out[WM_OCCLUDE_PARTS]){
+    if (rect_is_empty(r)) return 0;
+    int n = 1; out[0] = r;
+    Rect tmp[WM_OCCLUDE_PARTS];
+    for (int j = wm->count - 1; j > below && n; --j){
+        Window* o = wm->win[j];
+        if (!o->visible || !o->opaque) continue;
+        int m = 0;
+        for (int i = 0; i < n; i++){
+            Rect cut[4];
+            int k = rect_subtract(out[i], o->frame, cut);
+            /* остальным кускам место оставляем: каждый займёт минимум один слот */
+            if (m + k + (n - i - 1) > WM_OCCLUDE_PARTS){ tmp[m++] = out[i]; continue; }
+            for (int c = 0; c < k; c++) tmp[m++] = cut[c];
+        }
+        memcpy(out, tmp, (size_t)m * sizeof(Rect));
+        n = m;
+    }
+    return n;
+}
+
 void wm_focus_set(WM* wm, int uid, Window *w){
     if (uid<0 || uid>= (int)(sizeof(wm->focus)/sizeof(wm->focus[0]))) return;
     Window *old = wm->focus[uid].focused;
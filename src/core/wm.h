@@ -10,6 +10,11 @@
 #define WM_MAX_USERS 8
 #endif
 
+/* Сколько кусков максимум даёт вычитание перекрывающих окон из одного rect'а */
+#ifndef WM_OCCLUDE_PARTS
+#define WM_OCCLUDE_PARTS 32
+#endif
+
 typedef struct FocusEntry {
     int user_id;
     Window *focused;
@@ -46,6 +51,11 @@ void wm_damage_add(WM*, Rect r);
 int  wm_damage_count(WM*);
 Rect wm_damage_get(WM*, int i);
 
+/* Видимые части r: r минус frame'ы видимых opaque-окон выше индекса below
+   (below = -1 — над фоном). Не влезающие в WM_OCCLUDE_PARTS куски остаются
+   неразрезанными — лишняя перерисовка, но не потеря. Возвращает число кусков. */
+int  wm_visible_parts(WM*, int below, Rect r, Rect out[WM_OCCLUDE_PARTS]);
+
 void wm_focus_set(WM*, int user_id, Window *w);
 Window* wm_focus_get(WM*, int user_id);
 
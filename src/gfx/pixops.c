@@ -0,0 +1,219 @@
+#include "pixops.h"
+#include <string.h>
+
+/* x86: ядра собираются через target-атрибуты, так что общие CFLAGS не трогаем
+   и бинарник запускается на любом x86; выбор — по CPUID во время работы. */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(__EMSCRIPTEN__)
+#  define PIXOPS_X86 1
+#  include <immintrin.h>
+#  define PIXOPS_TARGET(t) __attribute__((target(t)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define PIXOPS_X86 1
+#  include <intrin.h>
+#  include <immintrin.h>
+#  define PIXOPS_TARGET(t)
+#endif
+
+/* ===== Скаляр (эталон) ===== */
+/* t/255 с округлением, точно для t ∈ [0, 255*255] */
+static inline uint32_t div255(uint32_t t){ t += 128; return (t + (t >> 8)) >> 8; }
+
+static inline uint32_t blend_px(uint32_t d, uint32_t s){
+    uint32_t a = s >> 24;
+    if (a == 255) return s;
+    if (a == 0) return d;
+    uint32_t ia = 255 - a, r = 0;
+    for (int sh = 0; sh < 24; sh += 8)
+        r |= div255(((s >> sh) & 0xFF) * a + ((d >> sh) & 0xFF) * ia) << sh;
+    return r | div255(255u * a + (d >> 24) * ia) << 24;
+}
+
+static void fill_scalar(uint32_t* dst, size_t n, uint32_t argb){
+    for (size_t i = 0; i < n; i++) dst[i] = argb;
+}
+/* Копия — memcpy на всех уровнях: libc сама выбирает векторный вариант (и
+   non-temporal store на больших строках); ручной SSE2/AVX2 цикл на 4K-строках
+   выходил медленнее */
+static void copy_scalar(uint32_t* dst, const uint32_t* src, size_t n){
+    memcpy(dst, src, n * sizeof(uint32_t));
+}
+static void blend_scalar(uint32_t* dst, const uint32_t* src, size_t n){
+    for (size_t i = 0; i < n; i++) dst[i] = blend_px(dst[i], src[i]);
+}
+
+#ifdef PIXOPS_X86
+/* ===== SSE2: 4 px за шаг ===== */
+PIXOPS_TARGET("sse2")
+static void fill_sse2(uint32_t* dst, size_t n, uint32_t argb){
+    __m128i v = _mm_set1_epi32((int)argb);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+        _mm_storeu_si128((__m128i*)(dst + i + 4), v);
+    }
+    for (; i < n; i++) dst[i] = argb;
+}
+/* Половина (2 px) в 16-битных каналах: (s*a + d*(255-a)) / 255 */
+PIXOPS_TARGET("sse2")
+static inline __m128i blend_half_sse2(__m128i s, __m128i d, __m128i a){
+    const __m128i c255 = _mm_set1_epi16(255), c128 = _mm_set1_epi16(128);
+    a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, 0xFF), 0xFF);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, _mm_sub_epi16(c255, a)));
+    t = _mm_add_epi16(t, c128);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+PIXOPS_TARGET("sse2")
+static void blend_sse2(uint32_t* dst, const uint32_t* src, size_t n){
+    const __m128i z = _mm_setzero_si128(), amask = _mm_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i a = _mm_and_si128(s, amask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, amask)) == 0xFFFF){ _mm_storeu_si128((__m128i*)(dst + i), s); continue; }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, z)) == 0xFFFF) continue;
+        __m128i d  = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s1 = _mm_or_si128(s, amask); /* в альфа-канале «цвет» = 255 → dstA по формуле выше */
+        __m128i lo = blend_half_sse2(_mm_unpacklo_epi8(s1, z), _mm_unpacklo_epi8(d, z), _mm_unpacklo_epi8(s, z));
+        __m128i hi = blend_half_sse2(_mm_unpackhi_epi8(s1, z), _mm_unpackhi_epi8(d, z), _mm_unpackhi_epi8(s, z));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < n; i++) dst[i] = blend_px(dst[i], src[i]);
+}
+
+/* ===== AVX2: 8 px за шаг ===== */
+PIXOPS_TARGET("avx2")
+static void fill_avx2(uint32_t* dst, size_t n, uint32_t argb){
+    __m256i v = _mm256_set1_epi32((int)argb);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16){
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+        _mm256_storeu_si256((__m256i*)(dst + i + 8), v);
+    }
+    for (; i < n; i++) dst[i] = argb;
+}
+PIXOPS_TARGET("avx2")
+static inline __m256i blend_half_avx2(__m256i s, __m256i d, __m256i a){
+    const __m256i c255 = _mm256_set1_epi16(255), c128 = _mm256_set1_epi16(128);
+    a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, 0xFF), 0xFF);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(s, a), _mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a)));
+    t = _mm256_add_epi16(t, c128);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+PIXOPS_TARGET("avx2")
+static void blend_avx2(uint32_t* dst, const uint32_t* src, size_t n){
+    const __m256i z = _mm256_setzero_si256(), amask = _mm256_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i a = _mm256_and_si256(s, amask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, amask)) == -1){ _mm256_storeu_si256((__m256i*)(dst + i), s); continue; }
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, z)) == -1) continue;
+        __m256i d  = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i s1 = _mm256_or_si256(s, amask);
+        /* unpack/pack работают внутри 128-битных половин — порядок пикселей сохраняется */
+        __m256i lo = blend_half_avx2(_mm256_unpacklo_epi8(s1, z), _mm256_unpacklo_epi8(d, z), _mm256_unpacklo_epi8(s, z));
+        __m256i hi = blend_half_avx2(_mm256_unpackhi_epi8(s1, z), _mm256_unpackhi_epi8(d, z), _mm256_unpackhi_epi8(s, z));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    for (; i < n; i++) dst[i] = blend_px(dst[i], src[i]);
+}
+
+static PixopsIsa detect_isa(void){
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    int maxleaf = r[0];
+    __cpuid(r, 1);
+    if (!(r[3] & (1 << 26))) return PIXOPS_SCALAR;
+    int osxsave = (r[2] & (1 << 27)) != 0;
+    if (maxleaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6){
+        __cpuidex(r, 7, 0);
+        if (r[1] & (1 << 5)) return PIXOPS_AVX2;
+    }
+    return PIXOPS_SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return PIXOPS_AVX2;
+    if (__builtin_cpu_supports("sse2")) return PIXOPS_SSE2;
+    return PIXOPS_SCALAR;
+#endif
+}
+#else
+static PixopsIsa detect_isa(void){ return PIXOPS_SCALAR; }
+#endif /* PIXOPS_X86 */
+
+typedef struct {
+    void (*fill)(uint32_t*, size_t, uint32_t);
+    void (*copy)(uint32_t*, const uint32_t*, size_t);
+    void (*blend)(uint32_t*, const uint32_t*, size_t);
+} PixopsVT;
+
+static const PixopsVT k_vt[] = {
+    { fill_scalar, copy_scalar, blend_scalar },
+#ifdef PIXOPS_X86
+    { fill_sse2,   copy_scalar, blend_sse2   },
+    { fill_avx2,   copy_scalar, blend_avx2   },
+#endif
+};
+
+static const PixopsVT* g_vt = NULL;
+static PixopsIsa g_best = PIXOPS_SCALAR, g_isa = PIXOPS_SCALAR;
+
+void pixops_init(void){
+    if (g_vt) return;
+    g_best = g_isa = detect_isa();
+    g_vt = &k_vt[g_isa];
+}
+
+PixopsIsa pixops_isa(void){ pixops_init(); return g_isa; }
+
+PixopsIsa pixops_set_isa(PixopsIsa want){
+    pixops_init();
+    if (want < PIXOPS_SCALAR) want = PIXOPS_SCALAR;
+    g_isa = want < g_best ? want : g_best;
+    g_vt = &k_vt[g_isa];
+    return g_isa;
+}
+
+const char* pixops_isa_name(PixopsIsa isa){
+    switch (isa){
+    case PIXOPS_SSE2: return "sse2";
+    case PIXOPS_AVX2: return "avx2";
+    default:          return "scalar";
+    }
+}
+
+void pixops_fill(uint32_t* dst, size_t n, uint32_t argb){
+    if (!g_vt) pixops_init();
+    g_vt->fill(dst, n, argb);
+}
+void pixops_copy(uint32_t* dst, const uint32_t* src, size_t n){
+    if (!g_vt) pixops_init();
+    g_vt->copy(dst, src, n);
+}
+void pixops_blend(uint32_t* dst, const uint32_t* src, size_t n){
+    if (!g_vt) pixops_init();
+    g_vt->blend(dst, src, n);
+}
+
+void pixops_blend_mask(uint32_t* dst, int dst_pitch_px,
+                       int cx, int cy, int cw, int ch,
+                       const uint8_t* cov, int cov_pitch,
+                       int x, int y, int w, int h, uint32_t argb){
+    if (!dst || !cov) return;
+    int sx = 0, sy = 0;
+    if (x < cx){ sx = cx - x; w -= sx; x = cx; }
+    if (y < cy){ sy = cy - y; h -= sy; y = cy; }
+    if (x + w > cx + cw) w = cx + cw - x;
+    if (y + h > cy + ch) h = cy + ch - y;
+    if (w <= 0 || h <= 0) return;
+    const uint32_t ca = argb >> 24, rgb = argb & 0x00FFFFFFu;
+    for (int yy = 0; yy < h; yy++){
+        const uint8_t* c = cov + (size_t)(sy + yy) * (size_t)cov_pitch + sx;
+        uint32_t* row = dst + (size_t)(y + yy) * (size_t)dst_pitch_px + x;
+        for (int xx = 0; xx < w; xx++){
+            if (!c[xx]) continue;
+            row[xx] = blend_px(row[xx], div255(c[xx] * ca) << 24 | rgb);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* Строчные ядра ARGB8888 (без SDL): заливка, непрозрачная копия и
+ * source-over смешивание. Заливка и смешивание — скаляр, SSE2 и AVX2; нужная
+ * реализация выбирается один раз по CPU при первом вызове (или pixops_init()).
+ * Копия везде идёт через memcpy (у libc она уже векторная).
+ *
+ * Смешивание (как SDL_BLENDMODE_BLEND, с округлением до ближайшего):
+ *   dstRGB = (srcRGB*srcA + dstRGB*(255-srcA)) / 255
+ *   dstA   =  srcA + dstA*(255-srcA) / 255
+ * Все реализации дают бит-в-бит одинаковый результат. */
+
+typedef enum {
+    PIXOPS_SCALAR = 0,
+    PIXOPS_SSE2   = 1,
+    PIXOPS_AVX2   = 2
+} PixopsIsa;
+
+/* Выбрать лучшую доступную реализацию (идемпотентно). Вызвать до запуска
+   потоков, если ядра будут дёргаться параллельно. */
+void      pixops_init(void);
+PixopsIsa pixops_isa(void);
+/* Принудительно понизить уровень (тесты/замеры); выше доступного не поднимет.
+   Возвращает фактически выбранный. */
+PixopsIsa pixops_set_isa(PixopsIsa want);
+const char* pixops_isa_name(PixopsIsa isa);
+
+void pixops_fill (uint32_t* dst, size_t n, uint32_t argb);
+/* dst и src не должны перекрываться */
+void pixops_copy (uint32_t* dst, const uint32_t* src, size_t n);
+void pixops_blend(uint32_t* dst, const uint32_t* src, size_t n);
+
+/* Маска покрытия w×h (cov, шаг cov_pitch байт) цветом argb с углом в (x,y)
+ * приёмника, с отсечением по прямоугольнику (cx,cy,cw,ch) — обычно clip_rect
+ * поверхности. Альфа пикселя — cov*A/255 с округлением, смешивание как у
+ * pixops_blend. Всегда скаляр: глифы узкие, векторной версии не окупиться. */
+void pixops_blend_mask(uint32_t* dst, int dst_pitch_px,
+                       int cx, int cy, int cw, int ch,
+                       const uint8_t* cov, int cov_pitch,
+                       int x, int y, int w, int h, uint32_t argb);
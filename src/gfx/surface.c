@@ -1,4 +1,5 @@
 #include "surface.h"
+#include "pixops.h"
 #include <string.h>
 
 Surface* surface_create_argb(int w,int h){
@@ -20,50 +21,94 @@ uint32_t* surface_pixels(Surface* sf){ return (sf && sf->s)? (uint32_t*)sf->s->p
 
 void surface_fill(Surface* sf, uint32_t argb){
     if (!sf || !sf->s) return;
-    int pitch_px = sf->s->pitch/4;
-    uint32_t *base = (uint32_t*)sf->s->pixels;
-    for (int y=0;y<sf->s->h;y++){
-        uint32_t *row = base + y*pitch_px;
-        for (int x=0;x<sf->s->w;x++) row[x]=argb;
-    }
+    surface_fill_rect(sf, 0, 0, sf->s->w, sf->s->h, argb);
 }
 void surface_fill_rect(Surface* sf, int x,int y,int w,int h, uint32_t argb){
     if (!sf||!sf->s||w<=0||h<=0) return;
     int pitch_px=sf->s->pitch/4;
     int xs=x, xe=x+w; if(xs<0) xs=0; if(xe>sf->s->w) xe=sf->s->w;
-    for(int yy=0; yy<h; ++yy){
-        int ry=y+yy; if(ry<0||ry>=sf->s->h) continue;
-        uint32_t *row = (uint32_t*)sf->s->pixels + ry*pitch_px;
-        for(int rx=xs; rx<xe; ++rx) row[rx]=argb;
+    int ys=y, ye=y+h; if(ys<0) ys=0; if(ye>sf->s->h) ye=sf->s->h;
+    if (xs>=xe) return;
+    uint32_t *row = (uint32_t*)sf->s->pixels + ys*pitch_px + xs;
+    for(int ry=ys; ry<ye; ++ry, row+=pitch_px) pixops_fill(row, (size_t)(xe-xs), argb);
+}
+
+/* Поверхности, с которыми ядра pixops работают напрямую: 32 бита, A/X в старшем
+   байте (ARGB8888 или XRGB8888 = SDL_PIXELFORMAT_RGB888), без RLE-блокировки */
+static int s_direct(const SDL_Surface* s){
+    Uint32 f = s->format->format;
+    return (f==SDL_PIXELFORMAT_ARGB8888 || f==SDL_PIXELFORMAT_RGB888) && !SDL_MUSTLOCK(s);
+}
+
+/* 0 — копия, 1 — source-over, -1 — режим, который ядра не повторят (отдаём SDL) */
+static int s_blit_mode(SDL_Surface* src){
+    SDL_BlendMode bm = SDL_BLENDMODE_NONE;
+    Uint8 am = 255, cr = 255, cg = 255, cb = 255;
+    Uint32 key;
+    SDL_GetSurfaceBlendMode(src, &bm);
+    SDL_GetSurfaceAlphaMod(src, &am);
+    SDL_GetSurfaceColorMod(src, &cr, &cg, &cb);
+    if (am != 255 || (cr & cg & cb) != 255 || SDL_GetColorKey(src, &key) == 0) return -1;
+    if (bm == SDL_BLENDMODE_NONE) return 0;
+    if (bm != SDL_BLENDMODE_BLEND) return -1;
+    /* у XRGB альфы нет — SDL такой источник тоже просто копирует */
+    return src->format->format == SDL_PIXELFORMAT_ARGB8888 ? 1 : 0;
+}
+
+bool surface_blit_direct(Surface* src, SDL_Surface* dst, bool opaque){
+    if (!src||!src->s||!dst) return false;
+    return (opaque || s_blit_mode(src->s) >= 0) && s_direct(src->s) && s_direct(dst);
+}
+
+void surface_blit_sdl(Surface* src, int sx,int sy,int w,int h, SDL_Surface* dst, int dx,int dy, bool opaque){
+    if (!src||!src->s||!dst) return;
+    SDL_Surface* ss = src->s;
+    int mode = opaque ? 0 : s_blit_mode(ss);
+    if (mode < 0 || !s_direct(ss) || !s_direct(dst)){
+        SDL_Rect s = { sx,sy,w,h }, d = { dx,dy,w,h };
+        SDL_BlitSurface(ss, &s, dst, &d);
+        return;
+    }
+    /* отсечение по источнику и по clip_rect приёмника — как у SDL_BlitSurface */
+    if (sx<0){ dx-=sx; w+=sx; sx=0; }
+    if (sy<0){ dy-=sy; h+=sy; sy=0; }
+    if (sx+w > ss->w) w = ss->w - sx;
+    if (sy+h > ss->h) h = ss->h - sy;
+    SDL_Rect c = dst->clip_rect;
+    if (dx<c.x){ int k=c.x-dx; sx+=k; w-=k; dx=c.x; }
+    if (dy<c.y){ int k=c.y-dy; sy+=k; h-=k; dy=c.y; }
+    if (dx+w > c.x+c.w) w = c.x+c.w - dx;
+    if (dy+h > c.y+c.h) h = c.y+c.h - dy;
+    if (w<=0 || h<=0) return;
+    int sp = ss->pitch/4, dp = dst->pitch/4;
+    const uint32_t* srow = (const uint32_t*)ss->pixels + sy*sp + sx;
+    uint32_t*       drow = (uint32_t*)dst->pixels + dy*dp + dx;
+    for (int y=0; y<h; ++y, srow+=sp, drow+=dp){
+        if (mode) pixops_blend(drow, srow, (size_t)w);
+        else      pixops_copy (drow, srow, (size_t)w);
     }
 }
 void surface_blit(Surface* src, int sx,int sy,int w,int h, Surface* dst, int dx,int dy){
-    if (!src||!dst||!src->s||!dst->s) return;
-    SDL_Rect s = { sx,sy,w,h }, d = { dx,dy,w,h };
-    SDL_BlitSurface(src->s, &s, dst->s, &d);
+    if (!dst) return;
+    surface_blit_sdl(src, sx,sy,w,h, dst->s, dx,dy, false);
+}
+void surface_copy(Surface* src, int sx,int sy,int w,int h, Surface* dst, int dx,int dy){
+    if (!dst) return;
+    surface_blit_sdl(src, sx,sy,w,h, dst->s, dx,dy, true);
 }
 void surface_checkerboard(Surface* s, int tile, uint32_t c0, uint32_t c1){
     if (!s||!s->s||tile<=0) return;
-    int pitch_px=s->s->pitch/4;
+    int pitch_px=s->s->pitch/4, W=s->s->w;
+    const uint32_t grid = 0xFF202020; /* линии сетки — непрозрачные, без «memset 0x20» */
     for (int y=0;y<s->s->h;y++){
         uint32_t *row=(uint32_t*)s->s->pixels + y*pitch_px;
+        if (y%tile==0){ pixops_fill(row, (size_t)W, grid); continue; }
         int by=(y/tile)&1;
-        for (int x=0;x<s->s->w;x++){
-            int bx=(x/tile)&1; row[x]= (bx^by)? c0:c1;
-        }
-    }
-    /* горизонтальные линии сетки — непрозрачные, без «memset 0x20» */
-    for (int y=0;y<s->s->h;y++){
-        if (y%tile==0){
-            uint32_t *row=(uint32_t*)s->s->pixels + y*pitch_px;
-            for (int x=0;x<s->s->w;x++) row[x] = 0xFF202020;
-        }
-    }
-    for (int x=0;x<s->s->w;x++){
-        if (x%tile==0){
-            for (int y=0;y<s->s->h;y++){
-                ((uint32_t*)s->s->pixels)[y*pitch_px + x] = 0xFF202020;
-            }
+        /* клетка за клеткой: первый столбец — сетка, остальное — цвет клетки */
+        for (int x=0;x<W;x+=tile){
+            int bx=(x/tile)&1, n = W-x < tile ? W-x : tile;
+            row[x] = grid;
+            pixops_fill(row+x+1, (size_t)(n-1), (bx^by)? c0:c1);
         }
     }
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 #include <SDL.h>
 
 /* Публичное определение — внутри gfx это ок */
@@ -17,5 +18,16 @@ uint32_t* surface_pixels(Surface*); // ARGB8888
 
 void surface_fill(Surface*, uint32_t argb);
 void surface_fill_rect(Surface*, int x,int y,int w,int h, uint32_t argb);
+/* Блиты ARGB8888/XRGB8888 идут через SIMD-ядра pixops (см. pixops.h), прочие
+   форматы и режимы (colorkey, alpha/color mod) — через SDL_BlitSurface.
+   surface_blit смешивает по blend-режиму источника (по умолчанию source-over),
+   surface_copy копирует как есть — для заведомо непрозрачных источников. */
 void surface_blit(Surface* src, int sx,int sy,int w,int h, Surface* dst, int dx,int dy);
+void surface_copy(Surface* src, int sx,int sy,int w,int h, Surface* dst, int dx,int dy);
+/* То же в чужую SDL-поверхность (экран окна); opaque — копия вместо смешивания */
+void surface_blit_sdl(Surface* src, int sx,int sy,int w,int h, SDL_Surface* dst, int dx,int dy, bool opaque);
+/* Пойдёт ли блит мимо SDL_BlitSurface. Только такие блиты можно делать из
+   нескольких потоков в разные области одного приёмника (SDL кеширует blit map
+   в самой поверхности). */
+bool surface_blit_direct(Surface* src, SDL_Surface* dst, bool opaque);
 void surface_checkerboard(Surface*, int tile, uint32_t c0, uint32_t c1);
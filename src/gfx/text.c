@@ -1,21 +1,188 @@
 #include "text.h"
 #include <SDL_ttf.h>
 #include <SDL.h>
+#include <string.h>
+#include "../core/perf.h"
+#include "pixops.h"
 
 static TTF_Font *g_font = NULL;
 
+/* 32-битные кодпоинты в RenderGlyph/GlyphMetrics — с SDL_ttf 2.0.18 */
+#if defined(SDL_TTF_VERSION_ATLEAST)
+#  if SDL_TTF_VERSION_ATLEAST(2,0,18)
+#    define TEXT_HAVE_GLYPH32 1
+#  endif
+#endif
+
+/* ===== Атлас глифов =====
+   Покрытие (альфа) каждого глифа растеризуется один раз белым цветом и кладётся
+   в 8-битный атлас полками; цвет применяется при отрисовке. Таблица глифов —
+   открытая адресация по кодпоинту. Переполнение атласа/таблицы — полный сброс
+   (глифы тут же перерастеризуются по мере надобности). */
+#ifndef TEXT_ATLAS_W
+#define TEXT_ATLAS_W 1024
+#endif
+#ifndef TEXT_ATLAS_H
+#define TEXT_ATLAS_H 1024
+#endif
+#ifndef TEXT_GLYPH_SLOTS
+#define TEXT_GLYPH_SLOTS 2048   /* степень двойки; заполняем не более чем наполовину */
+#endif
+
+typedef struct {
+    uint32_t cp;
+    uint8_t  used;
+    int16_t  w, h;    /* размер маски покрытия (0 — пустой глиф, напр. пробел) */
+    int16_t  adv;     /* сдвиг пера */
+    uint16_t ax, ay;  /* положение маски в атласе */
+} Glyph;
+
+static uint8_t* g_atlas = NULL;            /* TEXT_ATLAS_W × TEXT_ATLAS_H покрытия */
+static Glyph    g_glyphs[TEXT_GLYPH_SLOTS];
+static int      g_glyphs_n = 0;
+static int      g_shelf_x = 0, g_shelf_y = 0, g_shelf_h = 0;
+
+static void atlas_reset(void){
+    memset(g_glyphs, 0, sizeof(g_glyphs));
+    g_glyphs_n = 0;
+    g_shelf_x = g_shelf_y = g_shelf_h = 0;
+}
+
+/* Место под маску w×h на текущей/следующей полке; 0 — нет места */
+static int atlas_alloc(int w, int h, int* ox, int* oy){
+    if (w > TEXT_ATLAS_W || h > TEXT_ATLAS_H) return 0;
+    if (g_shelf_x + w > TEXT_ATLAS_W){ g_shelf_y += g_shelf_h; g_shelf_x = 0; g_shelf_h = 0; }
+    if (g_shelf_y + h > TEXT_ATLAS_H) return 0;
+    *ox = g_shelf_x; *oy = g_shelf_y;
+    g_shelf_x += w;
+    if (h > g_shelf_h) g_shelf_h = h;
+    return 1;
+}
+
+static SDL_Surface* render_glyph(uint32_t cp){
+    SDL_Color white = { 255, 255, 255, 255 };
+#ifdef TEXT_HAVE_GLYPH32
+    return TTF_RenderGlyph32_Blended(g_font, cp, white);
+#else
+    return TTF_RenderGlyph_Blended(g_font, (Uint16)(cp > 0xFFFF ? 0xFFFD : cp), white);
+#endif
+}
+
+static int glyph_advance(uint32_t cp){
+    int adv = 0;
+#ifdef TEXT_HAVE_GLYPH32
+    if (TTF_GlyphMetrics32(g_font, cp, NULL, NULL, NULL, NULL, &adv) != 0) adv = 0;
+#else
+    if (TTF_GlyphMetrics(g_font, (Uint16)(cp > 0xFFFF ? 0xFFFD : cp), NULL, NULL, NULL, NULL, &adv) != 0) adv = 0;
+#endif
+    return adv;
+}
+
+/* Растеризовать глиф и положить его покрытие в атлас */
+static int glyph_rasterize(uint32_t cp, Glyph* g){
+    g->cp = cp; g->used = 1; g->w = g->h = 0; g->ax = g->ay = 0;
+    g->adv = (int16_t)glyph_advance(cp);
+    SDL_Surface* s = render_glyph(cp);
+    if (!s) return 1; /* нет растра — только сдвиг */
+    if (s->format->format != SDL_PIXELFORMAT_ARGB8888){
+        SDL_Surface* conv = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(s);
+        if (!conv) return 1;
+        s = conv;
+    }
+    int ox = 0, oy = 0;
+    if (s->w > 0 && s->h > 0 && !atlas_alloc(s->w, s->h, &ox, &oy)){ SDL_FreeSurface(s); return 0; }
+    if (SDL_MUSTLOCK(s)) SDL_LockSurface(s);
+    for (int y=0; y<s->h; y++){
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)s->pixels + y*s->pitch);
+        uint8_t* dst = g_atlas + (size_t)(oy + y)*TEXT_ATLAS_W + ox;
+        for (int x=0; x<s->w; x++) dst[x] = (uint8_t)(row[x] >> 24);
+    }
+    if (SDL_MUSTLOCK(s)) SDL_UnlockSurface(s);
+    g->w = (int16_t)s->w; g->h = (int16_t)s->h;
+    g->ax = (uint16_t)ox; g->ay = (uint16_t)oy;
+    if (!g->adv) g->adv = (int16_t)s->w;
+    SDL_FreeSurface(s);
+    return 1;
+}
+
+static const Glyph* glyph_get(uint32_t cp){
+    unsigned m = TEXT_GLYPH_SLOTS - 1;
+    unsigned i = (cp * 2654435761u) & m;
+    while (g_glyphs[i].used){
+        if (g_glyphs[i].cp == cp) return &g_glyphs[i];
+        i = (i + 1) & m;
+    }
+    if (g_glyphs_n >= TEXT_GLYPH_SLOTS/2){ atlas_reset(); return glyph_get(cp); }
+    static int s_raster = -1;
+    uint64_t t0 = perf_now_ns();
+    int ok = glyph_rasterize(cp, &g_glyphs[i]);
+    if (!ok){
+        /* атлас полон — сбрасываем и пробуем ещё раз на пустом */
+        atlas_reset();
+        i = (cp * 2654435761u) & m;
+        ok = glyph_rasterize(cp, &g_glyphs[i]);
+        if (!ok) g_glyphs[i].used = 0;
+    }
+    perf_record_named(&s_raster, "text.raster", perf_now_ns() - t0);
+    if (!ok) return NULL;
+    g_glyphs_n++;
+    return &g_glyphs[i];
+}
+
+/* Следующий кодпоинт UTF-8; на битых байтах — U+FFFD и шаг на 1 байт */
+static uint32_t utf8_next(const unsigned char** ps){
+    const unsigned char* s = *ps;
+    uint32_t c = s[0];
+    int n = (c < 0x80) ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+    if (n < 0){ *ps = s + 1; return 0xFFFD; }
+    if (n == 0){ *ps = s + 1; return c; }
+    c &= (0x3Fu >> n);
+    for (int k=1; k<=n; k++){
+        if ((s[k] & 0xC0) != 0x80){ *ps = s + 1; return 0xFFFD; }
+        c = (c << 6) | (s[k] & 0x3F);
+    }
+    *ps = s + n + 1;
+    return c;
+}
+
 int text_init(const char *font_path, int px){
     if (TTF_Init()!=0) return -1;
     g_font = TTF_OpenFont(font_path, px);
     if(!g_font){ TTF_Quit(); return -2; }
     TTF_SetFontHinting(g_font, TTF_HINTING_LIGHT);
+    g_atlas = (uint8_t*)SDL_malloc((size_t)TEXT_ATLAS_W * TEXT_ATLAS_H);
+    if (!g_atlas){ TTF_CloseFont(g_font); g_font=NULL; TTF_Quit(); return -3; }
+    atlas_reset();
     return 0;
 }
 void text_shutdown(void){
     if (g_font){ TTF_CloseFont(g_font); g_font=NULL; }
+    SDL_free(g_atlas); g_atlas = NULL;
+    atlas_reset();
     TTF_Quit();
 }
 
+int text_draw_utf8(Surface* dst, int x, int y, const char* utf8, uint32_t argb){
+    if (!g_font || !g_atlas || !utf8 || !dst || !dst->s) return 0;
+    /* отсечение по clip_rect приёмника — как у surface_blit */
+    const SDL_Rect c = dst->s->clip_rect;
+    const int pitch_px = dst->s->pitch/4;
+    uint32_t* base = (uint32_t*)dst->s->pixels;
+    const unsigned char* p = (const unsigned char*)utf8;
+    int pen = x;
+    while (*p){
+        const Glyph* g = glyph_get(utf8_next(&p));
+        if (!g) continue;
+        if (g->w && g->h)
+            pixops_blend_mask(base, pitch_px, c.x, c.y, c.w, c.h,
+                              g_atlas + (size_t)g->ay*TEXT_ATLAS_W + g->ax, TEXT_ATLAS_W,
+                              pen, y, g->w, g->h, argb);
+        pen += g->adv;
+    }
+    return pen - x;
+}
+
 Surface* text_render_utf8(const char *utf8, uint32_t argb){
     if (!g_font || !utf8) return NULL;
     SDL_Color col = { (argb>>16)&0xFF, (argb>>8)&0xFF, argb&0xFF, (argb>>24)&0xFF };
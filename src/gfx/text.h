@@ -5,6 +5,12 @@
 int  text_init(const char *font_path, int px);
 void text_shutdown(void);
 
+/* Отрисовка строки прямо в dst (левый верхний угол ячейки — x,y) с альфа-смешиванием.
+   Глифы берутся из атласа покрытия; в установившемся режиме — без аллокаций.
+   Рисует только внутри clip_rect приёмника.
+   Возвращает ширину нарисованного (сумму сдвигов пера). */
+int text_draw_utf8(Surface* dst, int x, int y, const char* utf8, uint32_t argb);
+
 /* Рендер строки в ARGB Surface (caller: surface_free) */
 Surface* text_render_utf8(const char *utf8, uint32_t argb);
 
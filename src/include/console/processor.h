@@ -43,13 +43,17 @@ extern "C" {
        - apply_external: применить подтверждённую операцию;
        - snapshot: сериализовать текущее состояние → (schema, blob),
                    вернуть 0 при успехе; *out_blob* выделяет компонент (free() снаружи);
-       - init_from_blob: инициализация состояния из снапшота указанной версии schema. */
+       - init_from_blob: инициализация состояния из снапшота указанной версии schema;
+                   0 — принят, -1 — blob не годится (состояние не тронуто). */
     void con_processor_apply_external(ConsoleProcessor*, const struct ConOp* op);
     int  con_processor_snapshot(ConsoleProcessor* self,
                                 uint32_t* out_schema, void** out_blob, size_t* out_len);
-    void con_processor_init_from_blob(ConsoleProcessor*,
+    int  con_processor_init_from_blob(ConsoleProcessor*,
                                       uint32_t schema, const void* blob, size_t len);
 
+    /* Фабрика виджетов по ConOp.widget_kind (init — init_blob вставки или состояние из снапшота). */
+    ConsoleWidget* con_ext_make_widget(uint32_t kind, const void* init_blob, size_t init_size);
+
     /* Хук: расширенные команды. Возвращает 1, если команда обработана. */
     int  con_processor_ext_try_handle(ConsoleProcessor*, const char* line_utf8);
 
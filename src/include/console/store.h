@@ -38,7 +38,18 @@ extern "C" {
     typedef struct ConsoleStore ConsoleStore;
     typedef void (*ConsoleStoreListener)(void* user);
 
+    /* ===== Снапшот состояния (формат CSN1, раскладка — в console_store.c) =====
+       serialize: горячее окно записей (id, позиция, автор, текст/состояние виджета),
+       метаданные промптов и next_id. Возвращает 1 при успехе; *out_blob — malloc(), free() снаружи.
+       load: идемпотентно вливает записи, которых ещё нет (по ID). Тексты копируются одним
+       memcpy в общую арену, строки ссылаются прямо в неё. Виджеты создаёт фабрика по kind.
+       Возвращает 1 при успехе, 0 — формат/версия/размеры не сходятся (Store не тронут). */
+#ifndef CON_STORE_SNAPSHOT_VERSION
+#define CON_STORE_SNAPSHOT_VERSION 1u
+#endif
+    typedef ConsoleWidget* (*ConWidgetFactory)(uint32_t kind, const void* state, size_t size);
     int con_store_serialize(ConsoleStore* st, void** out_blob, size_t* out_len);
+    int con_store_load_snapshot(ConsoleStore* st, const void* blob, size_t len, ConWidgetFactory make_widget);
 
     /* Сравнение позиций: <0 если a<b, >0 если a>b, 0 если равны. */
     int  con_pos_cmp(const ConPosId* a, const ConPosId* b);
@@ -68,8 +79,12 @@ extern "C" {
 
     void con_store_notify_changed(ConsoleStore*); /* оповестить слушателей об изменениях состояния */
 
-    /* Доступ для отрисовки */
-    int         con_store_count(const ConsoleStore*);               /* кол-во строк в истории */
+    /* Доступ для отрисовки.
+       История двухъярусная: старые строки вытесняются из кольца CON_BUF_LINES в холодный
+       ярус (append-only файл, см. apps/console_cold.h) и идут в начале диапазона индексов.
+       Холодные строки — только TEXT, без CRDT-вставок между ними; указатель от get_line
+       для них валиден до следующего обращения к Store. */
+    int         con_store_count(const ConsoleStore*);               /* кол-во строк в истории (оба яруса) */
     const char* con_store_get_line(const ConsoleStore*, int index); /* index: 0..count-1 (0 — самая старая) */
     int         con_store_get_line_len(const ConsoleStore*, int index);
     ConsoleWidget*  con_store_get_widget(const ConsoleStore*, int index); /* NULL если не виджет */
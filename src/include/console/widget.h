@@ -26,6 +26,9 @@ extern "C" {
 
         /* Освобождение */
         void (*destroy)(ConsoleWidget* self);
+
+        /* Вид виджета (как ConOp.widget_kind) — для снапшотов; 0 — не сериализуется */
+        uint32_t kind;
     };
 
     /* Удобный helper — дерегирует на destroy, если есть */
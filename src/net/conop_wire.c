@@ -75,64 +75,274 @@ static int validate_lengths(uint32_t tag_len, uint32_t data_len, uint32_t init_l
     return (tag_len  <= COW1_MAX_TAG) && (data_len <= COW1_MAX_DATA) && (init_len <= COW1_MAX_INIT);
 }
 
-int conop_wire_encode(const ConOp* op, uint8_t** out_buf, size_t* out_len){
-    if (!op || !out_buf || !out_len) return -1;
-    const uint32_t tag_len  = (op->tag && *op->tag) ? (uint32_t)strlen(op->tag) : 0u;
-    const uint32_t data_len = (op->data && op->size) ? (uint32_t)op->size : 0u;
-    const uint32_t init_len = (op->init_blob && op->init_size) ? (uint32_t)op->init_size : 0u;
-    const size_t hdr = header_without_prefix_bytes();
-    if (!validate_lengths(tag_len, data_len, init_len)) return -1;
+/* Длины секций; 0 — лимиты превышены */
+static int section_lens(const ConOp* op, uint32_t* tag_len, uint32_t* data_len, uint32_t* init_len){
+    size_t t = (op->tag && *op->tag) ? strlen(op->tag) : 0u;
+    size_t d = (op->data && op->size) ? op->size : 0u;
+    size_t i = (op->init_blob && op->init_size) ? op->init_size : 0u;
+    if (t > COW1_MAX_TAG || d > COW1_MAX_DATA || i > COW1_MAX_INIT) return 0;
+    *tag_len = (uint32_t)t; *data_len = (uint32_t)d; *init_len = (uint32_t)i;
+    return validate_lengths(*tag_len, *data_len, *init_len);
+}
+
+/* ======== COW1 v2: битовая карта присутствия + LEB128 ========
+   u32 frame_len | "COW1" | u16 ver=2 | uv type | uv mask | поля по mask (по порядку бит) |
+   tag | data | init. Нулевые поля не передаются; pos — только depth компонент. */
+enum {
+    V2_TOPIC_TYPE = 1u<<0,  V2_TOPIC_INST = 1u<<1,  V2_SCHEMA    = 1u<<2,  V2_CONSOLE   = 1u<<3,
+    V2_OP_ID      = 1u<<4,  V2_ACTOR      = 1u<<5,  V2_HLC       = 1u<<6,  V2_USER      = 1u<<7,
+    V2_WIDGET_ID  = 1u<<8,  V2_WIDGET_KIND= 1u<<9,  V2_NEW_ITEM  = 1u<<10, V2_PARENT_L  = 1u<<11,
+    V2_PARENT_R   = 1u<<12, V2_POS        = 1u<<13, V2_INIT_HASH = 1u<<14, V2_EDITS     = 1u<<15,
+    V2_NONEMPTY   = 1u<<16, V2_TAG        = 1u<<17, V2_DATA      = 1u<<18, V2_INIT      = 1u<<19,
+    V2_ALL        = (1u<<20) - 1u
+};
+
+static inline size_t uv_len(uint64_t v){ size_t n = 1; while (v >= 0x80u){ v >>= 7; n++; } return n; }
+static inline void wr_uv(uint8_t** p, uint64_t v){
+    while (v >= 0x80u){ *(*p)++ = (uint8_t)(v | 0x80u); v >>= 7; }
+    *(*p)++ = (uint8_t)v;
+}
+/* 0 — обрыв кадра или слишком длинный varint */
+static inline int rd_uv(const uint8_t** p, const uint8_t* end, uint64_t* out){
+    uint64_t v = 0;
+    for (unsigned sh = 0; sh < 64; sh += 7){
+        if (*p >= end) return 0;
+        uint8_t b = *(*p)++;
+        v |= (uint64_t)(b & 0x7Fu) << sh;
+        if (!(b & 0x80u)){ *out = v; return 1; }
+    }
+    return 0;
+}
+static inline uint32_t zz32(int32_t v){ return ((uint32_t)v << 1) ^ (uint32_t)-(int32_t)((uint32_t)v >> 31); }
+static inline int32_t unzz32(uint32_t v){ return (int32_t)(v >> 1) ^ -(int32_t)(v & 1u); }
+
+/* Тело v2 после ver. d==NULL — только посчитать размер. */
+static size_t v2_body(const ConOp* op, TopicId topic,
+                      uint32_t tag_len, uint32_t data_len, uint32_t init_len, uint8_t* d)
+{
+    uint32_t m = 0;
+    if (topic.type_id)            m |= V2_TOPIC_TYPE;
+    /* inst_id == console_id декодер восстановит сам (как и в v1) */
+    if (topic.inst_id && !(topic.inst_id == op->console_id && topic.type_id)) m |= V2_TOPIC_INST;
+    if (op->schema)               m |= V2_SCHEMA;
+    if (op->console_id)           m |= V2_CONSOLE;
+    if (op->op_id)                m |= V2_OP_ID;
+    if (op->actor_id)             m |= V2_ACTOR;
+    if (op->hlc)                  m |= V2_HLC;
+    if (op->user_id)              m |= V2_USER;
+    if (op->widget_id)            m |= V2_WIDGET_ID;
+    if (op->widget_kind)          m |= V2_WIDGET_KIND;
+    if (op->new_item_id)          m |= V2_NEW_ITEM;
+    if (op->parent_left)          m |= V2_PARENT_L;
+    if (op->parent_right)         m |= V2_PARENT_R;
+    if (op->pos.depth)            m |= V2_POS;
+    if (op->init_hash)            m |= V2_INIT_HASH;
+    if (op->prompt_edits_inc)     m |= V2_EDITS;
+    if (op->prompt_nonempty)      m |= V2_NONEMPTY;
+    if (tag_len)                  m |= V2_TAG;
+    if (data_len)                 m |= V2_DATA;
+    if (init_len)                 m |= V2_INIT;
+
+    size_t n = 0;
+#define PUT_UV(x) do { uint64_t v_ = (uint64_t)(x); n += uv_len(v_); if (d) wr_uv(&d, v_); } while (0)
+    PUT_UV((uint16_t)op->type);
+    PUT_UV(m);
+    if (m & V2_TOPIC_TYPE)  PUT_UV(topic.type_id);
+    if (m & V2_TOPIC_INST)  PUT_UV(topic.inst_id);
+    if (m & V2_SCHEMA)      PUT_UV(op->schema);
+    if (m & V2_CONSOLE)     PUT_UV(op->console_id);
+    if (m & V2_OP_ID)       PUT_UV(op->op_id);
+    if (m & V2_ACTOR)       PUT_UV(op->actor_id);
+    if (m & V2_HLC)         PUT_UV(op->hlc);
+    if (m & V2_USER)        PUT_UV(zz32(op->user_id));
+    if (m & V2_WIDGET_ID)   PUT_UV(op->widget_id);
+    if (m & V2_WIDGET_KIND) PUT_UV(op->widget_kind);
+    if (m & V2_NEW_ITEM)    PUT_UV(op->new_item_id);
+    if (m & V2_PARENT_L)    PUT_UV(op->parent_left);
+    if (m & V2_PARENT_R)    PUT_UV(op->parent_right);
+    if (m & V2_POS){
+        uint8_t depth = op->pos.depth > CON_POS_MAX_DEPTH ? CON_POS_MAX_DEPTH : op->pos.depth;
+        n += 1; if (d) wr8(&d, depth);
+        for (int i=0;i<depth;i++){ PUT_UV(op->pos.comp[i].digit); PUT_UV(op->pos.comp[i].actor); }
+    }
+    /* хэш равномерен — varint его только раздует */
+    if (m & V2_INIT_HASH){ n += 8; if (d) wr64(&d, op->init_hash); }
+    if (m & V2_EDITS)       PUT_UV(zz32(op->prompt_edits_inc));
+    if (m & V2_NONEMPTY)    PUT_UV(zz32(op->prompt_nonempty));
+    if (m & V2_TAG)         PUT_UV(tag_len);
+    if (m & V2_DATA)        PUT_UV(data_len);
+    if (m & V2_INIT)        PUT_UV(init_len);
+#undef PUT_UV
+    return n;
+}
+
+/* Поля v2 после ver; *p на выходе — начало tag. Значение шире своего поля
+   (digit > u16 и т.п.) — кадр битый, молча не усекаем. */
+static int v2_parse(const uint8_t** p, const uint8_t* end, ConOp* op,
+                    uint32_t* tag_len, uint32_t* data_len, uint32_t* init_len)
+{
+    uint64_t v, m;
+#define GET_UV(dst) do { if (!rd_uv(p, end, &v)) return -1; (dst) = v; } while (0)
+#define GET_UVN(dst, max) do { if (!rd_uv(p, end, &v) || v > (max)) return -1; (dst) = v; } while (0)
+    GET_UVN(v, UINT16_MAX); op->type = (ConOpType)v;
+    if (!rd_uv(p, end, &m) || (m & ~(uint64_t)V2_ALL)) return -1;
+    if (m & V2_TOPIC_TYPE)  GET_UV(op->topic.type_id);
+    if (m & V2_TOPIC_INST)  GET_UV(op->topic.inst_id);
+    if (m & V2_SCHEMA)      GET_UVN(op->schema, UINT32_MAX);
+    if (m & V2_CONSOLE)     GET_UV(op->console_id);
+    if (m & V2_OP_ID)       GET_UV(op->op_id);
+    if (m & V2_ACTOR)       GET_UVN(op->actor_id, UINT32_MAX);
+    if (m & V2_HLC)         GET_UV(op->hlc);
+    if (m & V2_USER){       GET_UVN(v, UINT32_MAX); op->user_id = unzz32((uint32_t)v); }
+    if (m & V2_WIDGET_ID)   GET_UV(op->widget_id);
+    if (m & V2_WIDGET_KIND) GET_UVN(op->widget_kind, UINT32_MAX);
+    if (m & V2_NEW_ITEM)    GET_UV(op->new_item_id);
+    if (m & V2_PARENT_L)    GET_UV(op->parent_left);
+    if (m & V2_PARENT_R)    GET_UV(op->parent_right);
+    if (m & V2_POS){
+        if (*p >= end) return -1;
+        uint8_t depth = rd8(p);
+        if (depth > CON_POS_MAX_DEPTH) return -1;
+        op->pos.depth = depth;
+        for (int i=0;i<depth;i++){ GET_UVN(op->pos.comp[i].digit, UINT16_MAX); GET_UVN(op->pos.comp[i].actor, UINT32_MAX); }
+    }
+    if (m & V2_INIT_HASH){ if (end - *p < 8) return -1; op->init_hash = rd64(p); }
+    if (m & V2_EDITS){      GET_UVN(v, UINT32_MAX); op->prompt_edits_inc = unzz32((uint32_t)v); }
+    if (m & V2_NONEMPTY){   GET_UVN(v, UINT32_MAX); op->prompt_nonempty  = unzz32((uint32_t)v); }
+    *tag_len = *data_len = *init_len = 0;
+    if (m & V2_TAG)         GET_UVN(*tag_len,  UINT32_MAX);
+    if (m & V2_DATA)        GET_UVN(*data_len, UINT32_MAX);
+    if (m & V2_INIT)        GET_UVN(*init_len, UINT32_MAX);
+#undef GET_UVN
+#undef GET_UV
+    return 0;
+}
 
-    const uint32_t frame_payload_len = (uint32_t)(hdr + tag_len + data_len + init_len); /* после u32 длины */
-    const size_t total = 4u /* frame prefix */ + frame_payload_len;
+/* Поля v1 после ver (фиксированный размер) */
+static int v1_parse(const uint8_t** pp, const uint8_t* end, ConOp* op,
+                    uint32_t* tag_len, uint32_t* data_len, uint32_t* init_len)
+{
+    const uint8_t* p = *pp;
+    if ((size_t)(end - p) < header_without_prefix_bytes() - 6u /* magic+ver уже прочитаны */) return -1;
+    /* (ниже читаем поля; остатка точно достаточно) */
+    op->topic.type_id = (uint64_t)rd64(&p);
+    op->topic.inst_id = (uint64_t)rd64(&p);
+    op->schema        = (uint32_t)rd32(&p);
+    op->type        = (ConOpType)rd16(&p);
+    op->console_id  = (uint64_t)rd64(&p);
+    op->op_id       = (uint64_t)rd64(&p);
+    op->actor_id    = (uint32_t)rd32(&p);
+    op->hlc         = (uint64_t)rd64(&p);
+    op->user_id     = (int32_t)rd32(&p);
+    op->widget_id   = (uint64_t)rd64(&p);
+    op->widget_kind = (uint32_t)rd32(&p);
+    op->new_item_id = (uint64_t)rd64(&p);
+    op->parent_left = (uint64_t)rd64(&p);
+    op->parent_right= (uint64_t)rd64(&p);
+    rd_pos(&p, &op->pos);
+    op->init_hash   = (uint64_t)rd64(&p);
+    op->prompt_edits_inc = (int32_t)rd32(&p);
+    op->prompt_nonempty  = (int32_t)rd32(&p);
+    *tag_len  = rd32(&p);
+    *data_len = rd32(&p);
+    *init_len = rd32(&p);
+    *pp = p;
+    return 0;
+}
+
+static size_t encoded_size_lens(const ConOp* op, uint16_t ver, TopicId topic,
+                                uint32_t tag_len, uint32_t data_len, uint32_t init_len)
+{
+    size_t body = (ver == CONOP_WIRE_VERSION_2)
+        ? 4u + 2u + v2_body(op, topic, tag_len, data_len, init_len, NULL)
+        : header_without_prefix_bytes();
+    return 4u + body + (size_t)tag_len + data_len + init_len;
+}
 
-    /* Определяем topic для кодирования:
-       если не задан (оба поля == 0), трактуем как консоль по console_id */
+/* Определяем topic для кодирования:
+   если не задан (оба поля == 0), трактуем как консоль по console_id */
+static TopicId wire_topic(const ConOp* op){
     TopicId topic = op->topic;
     if (topic.type_id == 0 && topic.inst_id == 0){
         topic.type_id = 1u;               /* TYPE_CONSOLE */
         topic.inst_id = op->console_id;   /* совместимость */
     }
-    uint32_t schema = op->schema;
+    return topic;
+}
+
+size_t conop_wire_encoded_size_ver(const ConOp* op, uint16_t ver){
+    uint32_t tag_len, data_len, init_len;
+    if (!op || (ver != CONOP_WIRE_VERSION && ver != CONOP_WIRE_VERSION_2)) return 0;
+    if (!section_lens(op, &tag_len, &data_len, &init_len)) return 0;
+    return encoded_size_lens(op, ver, wire_topic(op), tag_len, data_len, init_len);
+}
 
+size_t conop_wire_encoded_size(const ConOp* op){
+    return conop_wire_encoded_size_ver(op, CONOP_WIRE_VERSION);
+}
+
+int conop_wire_encode(const ConOp* op, uint8_t** out_buf, size_t* out_len){
+    if (!op || !out_buf || !out_len) return -1;
+    size_t total = conop_wire_encoded_size(op);
+    if (!total) return -1;
     uint8_t* buf = (uint8_t*)malloc(total);
     if (!buf) return -1;
-    uint8_t* p = buf;
+    if (conop_wire_encode_into(op, buf, total) != total){ free(buf); return -1; }
+    *out_buf = buf;
+    *out_len = total;
+    return 0;
+}
+
+size_t conop_wire_encode_into(const ConOp* op, uint8_t* dst, size_t cap){
+    return conop_wire_encode_into_ver(op, CONOP_WIRE_VERSION, dst, cap);
+}
+
+size_t conop_wire_encode_into_ver(const ConOp* op, uint16_t ver, uint8_t* dst, size_t cap){
+    uint32_t tag_len, data_len, init_len;
+    if (!op || !dst || (ver != CONOP_WIRE_VERSION && ver != CONOP_WIRE_VERSION_2)) return 0;
+    if (!section_lens(op, &tag_len, &data_len, &init_len)) return 0;
+    TopicId topic = wire_topic(op);
+    const size_t total = encoded_size_lens(op, ver, topic, tag_len, data_len, init_len);
+    const uint32_t frame_payload_len = (uint32_t)(total - 4u); /* после u32 длины */
+    if (cap < total) return 0;
+
+    uint8_t* p = dst;
     /* frame length prefix (LE) */
     wr32(&p, frame_payload_len);
     /* magic + version */
     memcpy(p, CONOP_WIRE_MAGIC_STR, 4); p += 4;
-    wr16(&p, (uint16_t)CONOP_WIRE_VERSION);
-    /* header */
-    wr64(&p, (uint64_t)topic.type_id);
-    wr64(&p, (uint64_t)topic.inst_id);
-    wr32(&p, (uint32_t)schema);
-    wr16(&p, (uint16_t)op->type);
-    wr64(&p, (uint64_t)op->console_id);
-    wr64(&p, (uint64_t)op->op_id);
-    wr32(&p, (uint32_t)op->actor_id);
-    wr64(&p, (uint64_t)op->hlc);
-    wr32(&p, (uint32_t)(int32_t)op->user_id);
-    wr64(&p, (uint64_t)op->widget_id);
-    wr32(&p, (uint32_t)op->widget_kind);
-    wr64(&p, (uint64_t)op->new_item_id);
-    wr64(&p, (uint64_t)op->parent_left);
-    wr64(&p, (uint64_t)op->parent_right);
-    wr_pos(&p, &op->pos);
-    wr64(&p, (uint64_t)op->init_hash);
-    wr32(&p, (uint32_t)(int32_t)op->prompt_edits_inc);
-    wr32(&p, (uint32_t)(int32_t)op->prompt_nonempty);
-    wr32(&p, tag_len);
-    wr32(&p, data_len);
-    wr32(&p, init_len);
+    wr16(&p, ver);
+    if (ver == CONOP_WIRE_VERSION_2){
+        p += v2_body(op, topic, tag_len, data_len, init_len, p);
+    } else {
+        /* header */
+        wr64(&p, (uint64_t)topic.type_id);
+        wr64(&p, (uint64_t)topic.inst_id);
+        wr32(&p, (uint32_t)op->schema);
+        wr16(&p, (uint16_t)op->type);
+        wr64(&p, (uint64_t)op->console_id);
+        wr64(&p, (uint64_t)op->op_id);
+        wr32(&p, (uint32_t)op->actor_id);
+        wr64(&p, (uint64_t)op->hlc);
+        wr32(&p, (uint32_t)(int32_t)op->user_id);
+        wr64(&p, (uint64_t)op->widget_id);
+        wr32(&p, (uint32_t)op->widget_kind);
+        wr64(&p, (uint64_t)op->new_item_id);
+        wr64(&p, (uint64_t)op->parent_left);
+        wr64(&p, (uint64_t)op->parent_right);
+        wr_pos(&p, &op->pos);
+        wr64(&p, (uint64_t)op->init_hash);
+        wr32(&p, (uint32_t)(int32_t)op->prompt_edits_inc);
+        wr32(&p, (uint32_t)(int32_t)op->prompt_nonempty);
+        wr32(&p, tag_len);
+        wr32(&p, data_len);
+        wr32(&p, init_len);
+    }
     /* payload chunks */
     if (tag_len)  { memcpy(p, op->tag, tag_len);   p += tag_len; }
     if (data_len) { memcpy(p, op->data, data_len); p += data_len; }
     if (init_len) { memcpy(p, op->init_blob, init_len); p += init_len; }
-    /* done */
-    *out_buf = buf;
-    *out_len = total;
-    return 0;
+    return total;
 }
 
 int conop_wire_frame_ready(const uint8_t* buf, size_t len, size_t* out_frame_len){
@@ -144,11 +354,9 @@ int conop_wire_frame_ready(const uint8_t* buf, size_t len, size_t* out_frame_len
     return 1;
 }
 
-int conop_wire_decode(const uint8_t* buf, size_t len,
-                      ConOp* out_op,
-                      char** out_tag,
-                      void** out_data, size_t* out_data_len,
-                      void** out_init, size_t* out_init_len)
+/* Разбор и валидация заголовка кадра (v1 или v2). *out_p — начало tag. */
+static int decode_fixed(const uint8_t* buf, size_t len, ConOp* out_op, const uint8_t** out_p,
+                        uint32_t* out_tag_len, uint32_t* out_data_len, uint32_t* out_init_len)
 {
     if (!buf || len < 4 || !out_op) return -1;
     const uint8_t* p = buf;
@@ -156,45 +364,24 @@ int conop_wire_decode(const uint8_t* buf, size_t len,
     if (len < 4u + (size_t)frame_len) return -2; /* неполный кадр */
     const uint8_t* end = buf + 4u + (size_t)frame_len;
 
-    /* magic */
-    if ((size_t)(end - p) < 4) return -1;
+    /* magic + version */
+    if ((size_t)(end - p) < 6) return -1;
     if (memcmp(p, CONOP_WIRE_MAGIC_STR, 4) != 0) return -1;
     p += 4;
     uint16_t ver = rd16(&p);
-    if (ver != CONOP_WIRE_VERSION) return -1;
 
     ConOp op = {0};
-    if ((size_t)(end - p) < header_without_prefix_bytes()) return -1;
-    /* (ниже читаем поля; остатка точно достаточно) */
+    uint32_t tag_len = 0, data_len = 0, init_len = 0;
+    int rc;
+    if (ver == CONOP_WIRE_VERSION)        rc = v1_parse(&p, end, &op, &tag_len, &data_len, &init_len);
+    else if (ver == CONOP_WIRE_VERSION_2) rc = v2_parse(&p, end, &op, &tag_len, &data_len, &init_len);
+    else return -1;
+    if (rc != 0) return -1;
 
-    op.topic.type_id = (uint64_t)rd64(&p);
-    op.topic.inst_id = (uint64_t)rd64(&p);
-    op.schema        = (uint32_t)rd32(&p);
     /* Защитa: если по каким-то причинам topic пуст — совместимость с "консолью" */
-    if (op.topic.type_id == 0 && op.topic.inst_id == 0){
-        op.topic.type_id = 1u; /* console */
-        /* заполнится ниже из console_id, но инициализируем на всякий */
-    }
-    op.type        = (ConOpType)rd16(&p);
-    op.console_id  = (uint64_t)rd64(&p);
+    if (op.topic.type_id == 0 && op.topic.inst_id == 0) op.topic.type_id = 1u; /* console */
     /* Синхронизируем inst_id с console_id, если inst_id не задан */
     if (op.topic.inst_id == 0) op.topic.inst_id = op.console_id;
-    op.op_id       = (uint64_t)rd64(&p);
-    op.actor_id    = (uint32_t)rd32(&p);
-    op.hlc         = (uint64_t)rd64(&p);
-    op.user_id     = (int32_t)rd32(&p);
-    op.widget_id   = (uint64_t)rd64(&p);
-    op.widget_kind = (uint32_t)rd32(&p);
-    op.new_item_id = (uint64_t)rd64(&p);
-    op.parent_left = (uint64_t)rd64(&p);
-    op.parent_right= (uint64_t)rd64(&p);
-    rd_pos(&p, &op.pos);
-    op.init_hash   = (uint64_t)rd64(&p);
-    op.prompt_edits_inc = (int32_t)rd32(&p);
-    op.prompt_nonempty  = (int32_t)rd32(&p);
-    uint32_t tag_len  = rd32(&p);
-    uint32_t data_len = rd32(&p);
-    uint32_t init_len = rd32(&p);
 
     /* базовая валидация длин и границ */
     if (!validate_lengths(tag_len, data_len, init_len)) return -1;
@@ -210,6 +397,23 @@ int conop_wire_decode(const uint8_t* buf, size_t len,
     }
     if (op.pos.depth > CON_POS_MAX_DEPTH) return -1;
 
+    *out_op = op;
+    *out_p = p;
+    *out_tag_len = tag_len; *out_data_len = data_len; *out_init_len = init_len;
+    return 0;
+}
+
+int conop_wire_decode(const uint8_t* buf, size_t len,
+                      ConOp* out_op,
+                      char** out_tag,
+                      void** out_data, size_t* out_data_len,
+                      void** out_init, size_t* out_init_len)
+{
+    ConOp op; const uint8_t* p = NULL;
+    uint32_t tag_len = 0, data_len = 0, init_len = 0;
+    int rc = decode_fixed(buf, len, &op, &p, &tag_len, &data_len, &init_len);
+    if (rc != 0) return rc;
+
     char* tag = NULL;
     void* data = NULL;
     void* init = NULL;
@@ -244,6 +448,27 @@ int conop_wire_decode(const uint8_t* buf, size_t len,
     return 0;
 }
 
+int conop_wire_decode_view(uint8_t* buf, size_t len, ConOp* out_op){
+    ConOp op; const uint8_t* p = NULL;
+    uint32_t tag_len = 0, data_len = 0, init_len = 0;
+    int rc = decode_fixed(buf, len, &op, &p, &tag_len, &data_len, &init_len);
+    if (rc != 0) return rc;
+    uint8_t* q = buf + (p - buf);
+    op.tag = NULL;
+    if (tag_len){
+        /* tag в кадре без '\0': сдвигаем его на байт назад, на место уже
+           прочитанного init_len, и терминируем на освободившемся байте */
+        memmove(q - 1, q, tag_len);
+        q[tag_len - 1] = 0;
+        op.tag = (const char*)(q - 1);
+        q += tag_len;
+    }
+    if (data_len){ op.data = q; op.size = data_len; q += data_len; }
+    if (init_len){ op.init_blob = q; op.init_size = init_len; }
+    *out_op = op;
+    return 0;
+}
+
 void conop_wire_free_decoded(char* tag, void* data, void* init_blob){
     free(tag);
     free(data);
@@ -255,12 +480,12 @@ void conop_wire_free_decoded(char* tag, void* data, void* init_blob){
 
 void cow1_decoder_init(Cow1Decoder* d){
     if (!d) return;
-    d->buf = NULL; d->len = d->cap = 0; d->want_frame_total = 0;
+    d->buf = NULL; d->len = d->cap = d->off = 0; d->want_frame_total = 0;
 }
 
 void cow1_decoder_reset(Cow1Decoder* d){
     if (!d) return;
-    free(d->buf); d->buf = NULL; d->len = d->cap = 0; d->want_frame_total = 0;
+    free(d->buf); d->buf = NULL; d->len = d->cap = d->off = 0; d->want_frame_total = 0;
 }
 
 static int ensure_cap(Cow1Decoder* d, size_t need){
@@ -272,14 +497,38 @@ static int ensure_cap(Cow1Decoder* d, size_t need){
     d->buf = (uint8_t*)nb; d->cap = ncap; return 1;
 }
 
+/* Уплотнение: разобранный префикс [0, off) выбрасываем не после каждого кадра,
+   а только когда новым данным не хватает хвоста буфера (или всё разобрано). */
+static void compact(Cow1Decoder* d, size_t incoming){
+    if (d->off == 0) return;
+    if (d->off == d->len){ d->off = d->len = 0; return; }
+    if (d->cap - d->len >= incoming) return;
+    memmove(d->buf, d->buf + d->off, d->len - d->off);
+    d->len -= d->off;
+    d->off = 0;
+}
+
 size_t cow1_decoder_consume(Cow1Decoder* d, const uint8_t* data, size_t len){
     if (!d || !data || !len) return 0;
+    compact(d, len);
     if (!ensure_cap(d, d->len + len)) return 0;
     memcpy(d->buf + d->len, data, len);
     d->len += len;
     return len;
 }
 
+uint8_t* cow1_decoder_reserve(Cow1Decoder* d, size_t want, size_t* out_avail){
+    if (!d || !want) return NULL;
+    compact(d, want);
+    if (!ensure_cap(d, d->len + want)) return NULL;
+    if (out_avail) *out_avail = d->cap - d->len;
+    return d->buf + d->len;
+}
+
+void cow1_decoder_commit(Cow1Decoder* d, size_t n){
+    if (d && n <= d->cap - d->len) d->len += n;
+}
+
 static int peek_total_len(const uint8_t* buf, size_t len, size_t* out_total){
     if (len < 4) return 0;
     const uint8_t* p = buf;
@@ -290,40 +539,50 @@ static int peek_total_len(const uint8_t* buf, size_t len, size_t* out_total){
     return 1;
 }
 
-/* сдвиг буфера на n байт влево */
-static void drop_prefix(Cow1Decoder* d, size_t n){
-    if (!d || n==0) return;
-    if (n >= d->len){ d->len = 0; d->want_frame_total = 0; return; }
-    memmove(d->buf, d->buf + n, d->len - n);
-    d->len -= n;
-    d->want_frame_total = 0;
-}
-
-int cow1_decoder_take_next(Cow1Decoder* d,
-                           ConOp* out_op,
-                           char** out_tag,
-                           void** out_data, size_t* out_data_len,
-                           void** out_init, size_t* out_init_len)
-{
-    if (!d || !out_op) return -1;
-    if (d->len < 4){
+/* Есть ли полный кадр с позиции off: 1 — да (длина в want_frame_total), 0 — ещё нет */
+static int frame_available(Cow1Decoder* d){
+    size_t avail = d->len - d->off;
+    if (avail < 4){
         d->want_frame_total = 0;
         return 0;
     }
     if (d->want_frame_total == 0){
         size_t total = 0;
-        if (!peek_total_len(d->buf, d->len, &total)) return 0;
+        if (!peek_total_len(d->buf + d->off, avail, &total)) return 0;
         d->want_frame_total = total;
     }
-    if (d->len < d->want_frame_total) return 0;
-    /* у нас есть полный кадр */
-    int rc = conop_wire_decode(d->buf, d->want_frame_total, out_op, out_tag, out_data, out_data_len, out_init, out_init_len);
+    return avail >= d->want_frame_total;
+}
+
+/* Кадр разобран (или отвергнут): продвинуть off, не двигая байты */
+static int finish_frame(Cow1Decoder* d, int rc){
     if (rc != 0){
         /* невалидный кадр — сбрасываем накопленное */
-        d->len = 0;
+        d->len = d->off = 0;
         d->want_frame_total = 0;
         return -2;
     }
-    drop_prefix(d, d->want_frame_total);
+    d->off += d->want_frame_total;
+    d->want_frame_total = 0;
+    if (d->off == d->len) d->off = d->len = 0;
     return 1;
 }
+
+int cow1_decoder_take_next(Cow1Decoder* d,
+                           ConOp* out_op,
+                           char** out_tag,
+                           void** out_data, size_t* out_data_len,
+                           void** out_init, size_t* out_init_len)
+{
+    if (!d || !out_op) return -1;
+    if (!frame_available(d)) return 0;
+    int rc = conop_wire_decode(d->buf + d->off, d->want_frame_total, out_op, out_tag, out_data, out_data_len, out_init, out_init_len);
+    return finish_frame(d, rc);
+}
+
+int cow1_decoder_take_view(Cow1Decoder* d, ConOp* out_op){
+    if (!d || !out_op) return -1;
+    if (!frame_available(d)) return 0;
+    int rc = conop_wire_decode_view(d->buf + d->off, d->want_frame_total, out_op);
+    return finish_frame(d, rc);
+}
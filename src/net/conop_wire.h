@@ -11,6 +11,10 @@ extern "C" {
     /* Магия/версия wire-формата */
 #define CONOP_WIRE_MAGIC_STR "COW1"
 #define CONOP_WIRE_VERSION   1u
+    /* v2: битовая карта присутствия + LEB128-varint'ы, pos — только depth компонент.
+       Включается по договорённости в HELO/WLCM; декодер принимает обе версии. */
+#define CONOP_WIRE_VERSION_2 2u
+#define CONOP_WIRE_VERSION_MAX CONOP_WIRE_VERSION_2
 
     /* Жёсткие лимиты секций (можно переопределить при сборке) */
     #ifndef COW1_MAX_TAG
@@ -59,6 +63,25 @@ extern "C" {
        через free() вызывающей стороной. out_len включает и префикс длины. */
     int conop_wire_encode(const ConOp* op, uint8_t** out_buf, size_t* out_len);
 
+    /* Размер кадра (с префиксом длины), который даст encode; 0 — op невалиден (лимиты). */
+    size_t conop_wire_encoded_size(const ConOp* op);
+    /* Закодировать кадр прямо в dst (без аллокаций). Возвращает число записанных байт
+       (== conop_wire_encoded_size), либо 0, если op невалиден или cap мал. */
+    size_t conop_wire_encode_into(const ConOp* op, uint8_t* dst, size_t cap);
+
+    /* То же для явно заданной версии кадра (CONOP_WIRE_VERSION или _2).
+       Формат v2 (после u32 длины, "COW1" и u16 ver=2):
+       uv type, uv mask, далее по порядку бит только присутствующие (ненулевые) поля:
+       0 topic.type_id, 1 topic.inst_id (опускается, если == console_id), 2 schema,
+       3 console_id, 4 op_id, 5 actor_id, 6 hlc, 7 user_id (zigzag), 8 widget_id,
+       9 widget_kind, 10 new_item_id, 11 parent_left, 12 parent_right,
+       13 pos: u8 depth + depth×(uv digit, uv actor), 14 init_hash (u64 LE),
+       15 prompt_edits_inc (zigzag), 16 prompt_nonempty (zigzag),
+       17 tag_len, 18 data_len, 19 init_len; затем tag, data, init как в v1.
+       uv — беззнаковый LEB128. */
+    size_t conop_wire_encoded_size_ver(const ConOp* op, uint16_t ver);
+    size_t conop_wire_encode_into_ver(const ConOp* op, uint16_t ver, uint8_t* dst, size_t cap);
+
     /* Декодирование одного ПОЛНОГО кадра из buf,len.
        Возвращает 0 при успехе и заполняет:
        - out_op: скалярные поля + указатели на выделенные копии ниже,
@@ -72,6 +95,11 @@ extern "C" {
                           void** out_data, size_t* out_data_len,
                           void** out_init, size_t* out_init_len);
 
+    /* То же без копий: указатели tag/data/init_blob в out_op смотрят внутрь buf.
+       buf должен быть изменяемым — tag терминируется '\0' на месте (кадр портится,
+       повторно его не декодировать). Возврат как у conop_wire_decode(). */
+    int conop_wire_decode_view(uint8_t* buf, size_t len, ConOp* out_op);
+
     /* Утилита для стриминга по TCP:
        - если в буфере <4 байт, вернёт 0 и out_frame_len не трогает;
        - если >=4, положит в *out_frame_len полную длину КАДРА С ПРЕФИКСОМ,
@@ -87,6 +115,7 @@ extern "C" {
         uint8_t* buf;   /* накопитель (с префиксами) */
         size_t   len;   /* фактически в буфере */
         size_t   cap;   /* вместимость */
+        size_t   off;   /* начало неразобранных данных; [0, off) уплотняется лениво */
         /* кэш известной длины кадра (включая префикс), 0 если неизвестна */
         size_t   want_frame_total;
     } Cow1Decoder;
@@ -99,6 +128,12 @@ extern "C" {
        Возвращает количество «съеденных» из input (всегда == len). */
     size_t cow1_decoder_consume(Cow1Decoder* d, const uint8_t* data, size_t len);
 
+    /* Приём без промежуточного буфера: reserve даёт хвост не меньше want байт
+       (в *out_avail — сколько реально свободно), туда читают recv/readv,
+       затем commit(n) фиксирует прочитанное. reserve инвалидирует view'ы, как consume. */
+    uint8_t* cow1_decoder_reserve(Cow1Decoder* d, size_t want, size_t* out_avail);
+    void     cow1_decoder_commit(Cow1Decoder* d, size_t n);
+
     /* Если полный кадр накоплен — разобрать и вернуть 1.
        На успехе выделяет копии tag/data/init (как conop_wire_decode()).
        Если кадра ещё нет — вернёт 0.
@@ -109,6 +144,9 @@ extern "C" {
                                   void** out_data, size_t* out_data_len,
                                   void** out_init, size_t* out_init_len);
 
+    /* Как take_next, но без аллокаций: out_op->tag/data/init_blob указывают во
+       внутренний буфер декодера и валидны до следующего take/consume/reset. */
+    int    cow1_decoder_take_view(Cow1Decoder* d, ConOp* out_op);
 
 #ifdef __cplusplus
 }
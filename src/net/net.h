@@ -33,6 +33,15 @@ extern "C" {
     /* Неблокирующий опрос; budget_ms — желаемый максимум времени (0 = сразу вернуть) */
     void net_poller_tick(NetPoller*, uint32_t now_ms, int budget_ms);
 
+    /* Одноразовые таймеры на часах tick'а: срабатывают в net_poller_tick(now_ms)
+       после раздачи событий, как только now_ms ≥ due_ms. Ключ — пара (cb, user):
+       повторный set переносит срок. */
+    typedef void (*NetTimerCb)(void* user, uint32_t now_ms);
+    void     net_poller_timer_set(NetPoller*, uint32_t due_ms, NetTimerCb cb, void* user);
+    void     net_poller_timer_cancel(NetPoller*, NetTimerCb cb, void* user);
+    /* now_ms последнего tick (0 — tick ещё не было) */
+    uint32_t net_poller_now(NetPoller*);
+
     /* Установить/снять неблокирующий режим на сокете */
     int  net_set_nonblocking(net_fd_t fd, int nonblocking);
 
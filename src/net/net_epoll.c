@@ -0,0 +1,175 @@
+// === file: src/net/net_epoll.c ===
+/* Linux-бэкенд NetPoller на epoll (сборка с -DNET_USE_EPOLL, см. Makefile).
+ * Регистрации живут в ядре: add/mod/del → EPOLL_CTL_*, tick раздаёт только
+ * готовые fd. Семантика отложенных операций как в net_posix.c: изменения,
+ * сделанные из колбэков внутри tick, применяются после раздачи событий.
+ * Сокетные хелперы (nonblocking/connect/…) по-прежнему в net_posix.c. */
+#if defined(NET_USE_EPOLL) && defined(__linux__)
+#include "net.h"
+#include "net_timer.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* Сколько событий забираем за один epoll_wait */
+#ifndef NET_EPOLL_BATCH
+#define NET_EPOLL_BATCH 256
+#endif
+
+typedef struct NetEntry {
+    int      mask;
+    NetFdCb  cb;
+    void*    user;
+    int      alive;
+} NetEntry;
+
+typedef enum { OP_ADD, OP_MOD, OP_DEL } OpKind;
+
+typedef struct PendingOp {
+    OpKind  kind;
+    net_fd_t fd;
+    int     mask;
+    NetFdCb cb;
+    void*   user;
+} PendingOp;
+
+struct NetPoller {
+    int        ep;
+    NetEntry*  by_fd;   size_t fd_cap;   /* индекс — номер дескриптора */
+    size_t     live;
+    PendingOp* ops;     size_t olen, ocap;
+    struct epoll_event evs[NET_EPOLL_BATCH];
+    int        in_tick;
+    NetTimers  tm;
+};
+
+static NetEntry* s_find(struct NetPoller* np, net_fd_t fd){
+    if (fd < 0 || (size_t)fd >= np->fd_cap) return NULL;
+    NetEntry* e = &np->by_fd[fd];
+    return e->alive ? e : NULL;
+}
+static int s_reserve(struct NetPoller* np, net_fd_t fd){
+    if ((size_t)fd < np->fd_cap) return 0;
+    size_t n = np->fd_cap ? np->fd_cap : 64;
+    while (n <= (size_t)fd) n *= 2;
+    NetEntry* ne = (NetEntry*)realloc(np->by_fd, n*sizeof(NetEntry));
+    if (!ne) return -1;
+    memset(ne + np->fd_cap, 0, (n - np->fd_cap)*sizeof(NetEntry));
+    np->by_fd = ne; np->fd_cap = n;
+    return 0;
+}
+static void s_push_op(struct NetPoller* np, PendingOp op){
+    if (np->olen==np->ocap){ size_t n=np->ocap?np->ocap*2:8; np->ops=(PendingOp*)realloc(np->ops,n*sizeof(PendingOp)); np->ocap=n; }
+    np->ops[np->olen++] = op;
+}
+
+static uint32_t to_epoll_events(int mask){
+    uint32_t ev = 0; /* EPOLLERR/EPOLLHUP ядро сообщает всегда */
+    if (mask & NET_RD) ev |= EPOLLIN | EPOLLPRI;
+    if (mask & NET_WR) ev |= EPOLLOUT;
+    return ev;
+}
+static int from_epoll_events(uint32_t rev){
+    int ev = 0;
+    if (rev & (EPOLLIN|EPOLLPRI)) ev |= NET_RD;
+    if (rev & EPOLLOUT) ev |= NET_WR;
+    if (rev & (EPOLLERR|EPOLLHUP)) ev |= NET_ERR;
+    return ev;
+}
+
+static void s_ctl(struct NetPoller* np, int op, net_fd_t fd, int mask){
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll_events(mask);
+    ev.data.fd = fd;
+    if (epoll_ctl(np->ep, op, fd, &ev) == 0) return;
+    /* fd мог быть закрыт и переиспользован без del, или mod пришёл на снятый — чиним */
+    if (op == EPOLL_CTL_ADD && errno == EEXIST) epoll_ctl(np->ep, EPOLL_CTL_MOD, fd, &ev);
+    else if (op == EPOLL_CTL_MOD && errno == ENOENT) epoll_ctl(np->ep, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void s_apply_ops(struct NetPoller* np){
+    for (size_t i=0;i<np->olen;i++){
+        PendingOp* op = &np->ops[i];
+        if (op->kind==OP_ADD){
+            if (op->fd < 0 || s_reserve(np, op->fd) != 0) continue;
+            NetEntry* e = &np->by_fd[op->fd];
+            if (!e->alive) np->live++;
+            e->mask=op->mask; e->cb=op->cb; e->user=op->user; e->alive=1;
+            s_ctl(np, EPOLL_CTL_ADD, op->fd, op->mask);
+        } else if (op->kind==OP_MOD){
+            NetEntry* e = s_find(np, op->fd);
+            if (e && e->mask != op->mask){ e->mask = op->mask; s_ctl(np, EPOLL_CTL_MOD, op->fd, op->mask); }
+        } else { /* OP_DEL */
+            NetEntry* e = s_find(np, op->fd);
+            if (e){
+                e->alive = 0; e->cb = NULL; e->user = NULL; np->live--;
+                /* fd уже может быть закрыт (ядро само сняло регистрацию) — ошибку игнорируем */
+                epoll_ctl(np->ep, EPOLL_CTL_DEL, op->fd, NULL);
+            }
+        }
+    }
+    np->olen = 0;
+}
+
+NetPoller* net_poller_create(void){
+    struct NetPoller* np = (struct NetPoller*)calloc(1,sizeof(*np));
+    if (!np) return NULL;
+    np->ep = epoll_create1(EPOLL_CLOEXEC);
+    if (np->ep < 0){ free(np); return NULL; }
+    return np;
+}
+void net_poller_destroy(NetPoller* np){
+    if (!np) return;
+    close(np->ep);
+    free(np->by_fd);
+    free(np->ops);
+    net_timers_free(&np->tm);
+    free(np);
+}
+
+int net_poller_add(NetPoller* np, net_fd_t fd, int mask, NetFdCb cb, void* user){
+    if (!np || !cb || fd < 0) return -1;
+    PendingOp op = (PendingOp){ OP_ADD, fd, mask, cb, user };
+    if (np->in_tick) s_push_op(np, op); else { s_push_op(np, op); s_apply_ops(np); }
+    return 0;
+}
+void net_poller_mod(NetPoller* np, net_fd_t fd, int new_mask){
+    if (!np) return;
+    PendingOp op = (PendingOp){ OP_MOD, fd, new_mask, 0, 0 };
+    if (np->in_tick) s_push_op(np, op); else { s_push_op(np, op); s_apply_ops(np); }
+}
+void net_poller_del(NetPoller* np, net_fd_t fd){
+    if (!np) return;
+    PendingOp op = (PendingOp){ OP_DEL, fd, 0, 0, 0 };
+    if (np->in_tick) s_push_op(np, op); else { s_push_op(np, op); s_apply_ops(np); }
+}
+
+void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){
+    if (!np) return;
+    if (np->olen) s_apply_ops(np);
+    if (np->live == 0){ net_timers_run(&np->tm, now_ms); return; }
+
+    int timeout = (budget_ms > 0) ? budget_ms : 0; /* неблокирующий по умолчанию */
+    np->in_tick = 1;
+    int rc = epoll_wait(np->ep, np->evs, NET_EPOLL_BATCH, timeout);
+    for (int i=0;i<rc;i++){
+        net_fd_t fd = np->evs[i].data.fd;
+        NetEntry* e = s_find(np, fd);
+        if (e && e->cb) e->cb(e->user, fd, from_epoll_events(np->evs[i].events));
+    }
+    np->in_tick = 0;
+    if (np->olen) s_apply_ops(np);
+    net_timers_run(&np->tm, now_ms);
+}
+
+void net_poller_timer_set(NetPoller* np, uint32_t due_ms, NetTimerCb cb, void* user){
+    if (np && cb) net_timers_set(&np->tm, due_ms, cb, user);
+}
+void net_poller_timer_cancel(NetPoller* np, NetTimerCb cb, void* user){
+    if (np) net_timers_cancel(&np->tm, cb, user);
+}
+uint32_t net_poller_now(NetPoller* np){ return np ? np->tm.now : 0; }
+
+#endif /* NET_USE_EPOLL && __linux__ */
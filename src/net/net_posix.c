@@ -1,5 +1,6 @@
 // === file: src/net/net_posix.c ===
 #include "net.h"
+#include "net_timer.h"
 #include "wire_tcp.h" /* header присутствует, но сам модуль используется опционально */
 #include <poll.h>
 #include <unistd.h>
@@ -15,6 +16,8 @@
 #include <arpa/inet.h>
 #include <errno.h>
 
+/* Поллер на poll(); на Linux по умолчанию заменяется epoll-бэкендом (net_epoll.c) */
+#if !(defined(NET_USE_EPOLL) && defined(__linux__))
 typedef struct NetEntry {
     net_fd_t fd;
     int      mask;
@@ -37,6 +40,7 @@ struct NetPoller {
     NetEntry*  entries; size_t len, cap;
     PendingOp* ops;     size_t olen, ocap;
     int        in_tick;
+    NetTimers  tm;
 };
 
 static NetEntry* s_find(struct NetPoller* np, net_fd_t fd){
@@ -80,6 +84,7 @@ void net_poller_destroy(NetPoller* np){
     if (!np) return;
     free(np->entries);
     free(np->ops);
+    net_timers_free(&np->tm);
     free(np);
 }
 
@@ -115,10 +120,9 @@ static int from_poll_revents(short rev){
 }
 
 void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){
-    (void)now_ms;
     if (!np) return;
     if (np->olen) s_apply_ops(np);
-    if (np->len == 0) return;
+    if (np->len == 0){ net_timers_run(&np->tm, now_ms); return; }
 
     struct pollfd* pfds = (struct pollfd*)alloca(np->len * sizeof(struct pollfd));
     for (size_t i=0;i<np->len;i++){
@@ -139,8 +143,18 @@ void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){
     }
     np->in_tick = 0;
     if (np->olen) s_apply_ops(np);
+    net_timers_run(&np->tm, now_ms);
 }
 
+void net_poller_timer_set(NetPoller* np, uint32_t due_ms, NetTimerCb cb, void* user){
+    if (np && cb) net_timers_set(&np->tm, due_ms, cb, user);
+}
+void net_poller_timer_cancel(NetPoller* np, NetTimerCb cb, void* user){
+    if (np) net_timers_cancel(&np->tm, cb, user);
+}
+uint32_t net_poller_now(NetPoller* np){ return np ? np->tm.now : 0; }
+#endif /* !NET_USE_EPOLL */
+
 int net_set_nonblocking(net_fd_t fd, int nonblocking){
     int flags = fcntl(fd, F_GETFL, 0);
     if (flags == -1) return -1;
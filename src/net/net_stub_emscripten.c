@@ -11,6 +11,9 @@ int  net_poller_add(NetPoller* np, net_fd_t fd, int mask, NetFdCb cb, void* user
 void net_poller_mod(NetPoller* np, net_fd_t fd, int new_mask){ (void)np;(void)fd;(void)new_mask; }
 void net_poller_del(NetPoller* np, net_fd_t fd){ (void)np;(void)fd; }
 void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){ (void)np;(void)now_ms;(void)budget_ms; }
+void net_poller_timer_set(NetPoller* np, uint32_t due_ms, NetTimerCb cb, void* user){ (void)np;(void)due_ms;(void)cb;(void)user; }
+void net_poller_timer_cancel(NetPoller* np, NetTimerCb cb, void* user){ (void)np;(void)cb;(void)user; }
+uint32_t net_poller_now(NetPoller* np){ (void)np; return 0; }
 int  net_set_nonblocking(net_fd_t fd, int nonblocking){ (void)fd;(void)nonblocking; return -1; }
 
 /* Эмулятор сокет-API для wasm: всё «не поддерживается». */
@@ -0,0 +1,53 @@
+// === file: src/net/net_timer.h ===
+/* Таймеры NetPoller — общая часть бэкендов (net_posix.c, net_epoll.c, net_win32.c).
+ * Время — now_ms из net_poller_tick, своих часов у поллера нет. Таймеров единицы,
+ * поэтому простой массив и линейный поиск. */
+#pragma once
+#include "net.h"
+#include <stdlib.h>
+
+typedef struct NetTimer {
+    uint32_t   due;
+    uint32_t   arm;  /* номер взвода — отличает взведённые во время run */
+    NetTimerCb cb;
+    void*      user;
+} NetTimer;
+
+typedef struct NetTimers {
+    NetTimer* t; size_t n, cap;
+    uint32_t  now;  /* now_ms последнего tick */
+    uint32_t  arm;  /* счётчик взводов */
+} NetTimers;
+
+/* a наступило не раньше b (с учётом переполнения u32) */
+static inline int net_time_reached(uint32_t a, uint32_t b){ return (int32_t)(a - b) >= 0; }
+
+static inline void net_timers_set(NetTimers* ts, uint32_t due, NetTimerCb cb, void* user){
+    for (size_t i=0;i<ts->n;i++) if (ts->t[i].cb==cb && ts->t[i].user==user){ ts->t[i].due = due; ts->t[i].arm = ++ts->arm; return; }
+    if (ts->n == ts->cap){
+        size_t n = ts->cap ? ts->cap*2 : 8;
+        NetTimer* nt = (NetTimer*)realloc(ts->t, n*sizeof(NetTimer));
+        if (!nt) return;
+        ts->t = nt; ts->cap = n;
+    }
+    ts->t[ts->n++] = (NetTimer){ due, ++ts->arm, cb, user };
+}
+static inline void net_timers_cancel(NetTimers* ts, NetTimerCb cb, void* user){
+    for (size_t i=0;i<ts->n;i++) if (ts->t[i].cb==cb && ts->t[i].user==user){ ts->t[i] = ts->t[--ts->n]; return; }
+}
+/* Раздать наступившие. Колбэк может ставить/снимать таймеры; срабатывают только
+   взведённые до начала run, так что взведённый заново на «уже наступило» сработает
+   не раньше следующего tick. */
+static inline void net_timers_run(NetTimers* ts, uint32_t now){
+    ts->now = now;
+    uint32_t arm = ts->arm;
+    for (;;){
+        size_t i = 0;
+        while (i < ts->n && !(net_time_reached(now, ts->t[i].due) && net_time_reached(arm, ts->t[i].arm))) i++;
+        if (i == ts->n) break;
+        NetTimer t = ts->t[i];
+        ts->t[i] = ts->t[--ts->n];
+        t.cb(t.user, now);
+    }
+}
+static inline void net_timers_free(NetTimers* ts){ free(ts->t); ts->t = NULL; ts->n = ts->cap = 0; }
@@ -1,4 +1,5 @@
 #include "net.h"
+#include "net_timer.h"
 #include "wire_tcp.h" /* header присутствует, но сам модуль используется опционально */
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -18,6 +19,7 @@ struct NetPoller {
     PendingOp* ops; size_t olen, ocap;
     int in_tick;
     int wsa_inited;
+    NetTimers tm;
 };
 
 /* Глобальный инициализатор WSA для функций вне поллера */
@@ -56,7 +58,7 @@ static void apply_ops(struct NetPoller* np){
 }
 
 NetPoller* net_poller_create(void){ struct NetPoller* np=(struct NetPoller*)calloc(1,sizeof(*np)); ensure_wsa(np); return np; }
-void net_poller_destroy(NetPoller* np){ if(!np) return; free(np->entries); free(np->ops); if(np->wsa_inited) WSACleanup(); free(np); }
+void net_poller_destroy(NetPoller* np){ if(!np) return; free(np->entries); free(np->ops); net_timers_free(&np->tm); if(np->wsa_inited) WSACleanup(); free(np); }
 
 int  net_poller_add(NetPoller* np, net_fd_t fd, int mask, NetFdCb cb, void* user){ if(!np||!cb) return -1; PendingOp op={OP_ADD,fd,mask,cb,user}; if(np->in_tick) push_op(np,op); else { push_op(np,op); apply_ops(np);} return 0; }
 void net_poller_mod(NetPoller* np, net_fd_t fd, int new_mask){ if(!np) return; PendingOp op={OP_MOD,fd,new_mask,0,0}; if(np->in_tick) push_op(np,op); else { push_op(np,op); apply_ops(np);} }
@@ -66,10 +68,9 @@ static short to_poll_events(int mask){ short ev=0; if (mask&NET_RD) ev|=POLLRDNO
 static int from_poll_revents(short rev){ int ev=0; if (rev&(POLLRDNORM|POLLPRI)) ev|=NET_RD; if (rev&POLLWRNORM) ev|=NET_WR; if (rev&(POLLERR|POLLHUP)) ev|=NET_ERR; return ev; }
 
 void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){
-    (void)now_ms;
     if(!np) return;
     if(np->olen) apply_ops(np);
-    if(np->len==0) return;
+    if(np->len==0){ net_timers_run(&np->tm, now_ms); return; }
     WSAPOLLFD* pfds=(WSAPOLLFD*)_alloca(np->len*sizeof(WSAPOLLFD));
     for(size_t i=0;i<np->len;i++){ pfds[i].fd=np->entries[i].fd; pfds[i].events=to_poll_events(np->entries[i].mask); pfds[i].revents=0; }
     int timeout = budget_ms>0 ? budget_ms : 0;
@@ -78,7 +79,11 @@ void net_poller_tick(NetPoller* np, uint32_t now_ms, int budget_ms){
     if(rc>0){ for(size_t i=0;i<np->len;i++){ if(!pfds[i].revents) continue; int ev=from_poll_revents(pfds[i].revents); NetEntry* e=&np->entries[i]; if(e->cb) e->cb(e->user, e->fd, ev); } }
     np->in_tick=0;
     if(np->olen) apply_ops(np);
+    net_timers_run(&np->tm, now_ms);
 }
+void net_poller_timer_set(NetPoller* np, uint32_t due_ms, NetTimerCb cb, void* user){ if(np&&cb) net_timers_set(&np->tm, due_ms, cb, user); }
+void net_poller_timer_cancel(NetPoller* np, NetTimerCb cb, void* user){ if(np) net_timers_cancel(&np->tm, cb, user); }
+uint32_t net_poller_now(NetPoller* np){ return np ? np->tm.now : 0; }
 
 int net_set_nonblocking(net_fd_t fd, int nonblocking){ u_long mode = nonblocking ? 1u : 0u; return ioctlsocket(fd, FIONBIO, &mode); }
 
@@ -4,117 +4,288 @@
 #include <string.h>
 #include <limits.h>
 
-typedef struct {
-    uint8_t* buf;
+/* Исходящая очередь — цепочка блоков. Кадры кодируются прямо в хвост последнего
+   блока; сброс одним writev/sendmsg (WSASend) по всей цепочке. Общий кадр
+   (cow1tcp_send_frame) встаёт в цепочку отдельным блоком-ссылкой без копии. */
+struct Cow1TcpFrame {
+    uint32_t refs;
+    uint16_t ver;
+    size_t   len;
+    uint8_t  data[];
+};
+
+typedef struct OutBlk {
+    struct OutBlk* next;
     size_t   len, cap;
-    size_t   off; /* продвинутая позиция для send() */
-    int      want_wr;
+    size_t   off;  /* сколько уже отправлено из этого блока */
+    Cow1TcpFrame* ref; /* не NULL — блок-ссылка: байты в ref->data, своих нет */
+    uint8_t* p;        /* data либо ref->data */
+    uint8_t  data[];
+} OutBlk;
+
+typedef struct {
+    OutBlk*  head;
+    OutBlk*  tail;
+    OutBlk*  spare; /* один блок держим про запас, чтобы не дёргать malloc каждый кадр */
+    size_t   bytes; /* неотправленных байт во всей цепочке */
 } OutQ;
 
 struct Cow1Tcp {
     NetPoller* np;
     net_fd_t   fd;
     Cow1TcpOnOp on_op;
+    Cow1TcpOnClose on_close;
+    Cow1TcpOnPressure on_pressure;
     void*      user;
     Cow1Decoder dec;
     OutQ        out;
+    uint16_t    wire_ver; /* версия исходящих кадров; входящие — любые */
+    int         wr_armed; /* NET_WR запрошен у поллера */
+    size_t      hi_wm, lo_wm;
+    int         over;     /* выше high: новые кадры не принимаем до low */
+    int         pending;  /* стоит в списке на сброс в конце кадра */
+    struct Cow1Tcp* next_pending;
 };
 
-static int ensure_cap(OutQ* q, size_t need){
-    if (q->cap >= need) return 1;
-    size_t n = q->cap ? q->cap*2 : 8192;
-    while (n < need) n *= 2;
-    void* nb = realloc(q->buf, n);
-    if (!nb) return 0;
-    q->buf = (uint8_t*)nb; q->cap = n; return 1;
+/* Соединения с накопленными кадрами; сбрасываются cow1tcp_flush_pending() */
+static Cow1Tcp* g_pending = NULL;
+static Cow1TcpStats g_stats;
+
+/* Пул заголовков блоков-ссылок: рассылка на N соединений — N таких блоков за кадр.
+   Живёт, пока есть соединения: последний cow1tcp_destroy его освобождает */
+#define REF_POOL_MAX 256
+static OutBlk* g_ref_pool = NULL;
+static int     g_ref_pooled = 0;
+static int     g_conns = 0;
+
+static OutBlk* blk_new(OutQ* q, size_t need){
+    OutBlk* b = NULL;
+    if (q->spare && q->spare->cap >= need){ b = q->spare; q->spare = NULL; }
+    else {
+        /* за блоком-ссылкой обычно снова ссылка — полный блок под мелочь не берём */
+        size_t want = q->tail && q->tail->ref ? COW1TCP_BLOCK / 16 : COW1TCP_BLOCK;
+        size_t cap = need > want ? need : want;
+        b = (OutBlk*)malloc(sizeof(OutBlk) + cap);
+        if (!b) return NULL;
+        b->cap = cap;
+    }
+    b->next = NULL; b->len = b->off = 0;
+    b->ref = NULL; b->p = b->data;
+    return b;
+}
+static OutBlk* blk_new_ref(Cow1TcpFrame* f){
+    OutBlk* b = g_ref_pool;
+    if (b){ g_ref_pool = b->next; g_ref_pooled--; }
+    else if (!(b = (OutBlk*)malloc(sizeof(OutBlk)))) return NULL;
+    b->next = NULL; b->off = 0;
+    b->len = b->cap = f->len; /* cap == len: дописать в такой блок нельзя */
+    b->ref = f; b->p = f->data;
+    f->refs++;
+    return b;
+}
+static void blk_release(OutQ* q, OutBlk* b){
+    if (b->ref){
+        cow1tcp_frame_unref(b->ref);
+        if (g_ref_pooled < REF_POOL_MAX){ b->next = g_ref_pool; g_ref_pool = b; g_ref_pooled++; }
+        else free(b);
+        return;
+    }
+    if (!q->spare && b->cap == COW1TCP_BLOCK) q->spare = b; else free(b);
+}
+static void ref_pool_drain(void){
+    while (g_ref_pool){ OutBlk* nx = g_ref_pool->next; free(g_ref_pool); g_ref_pool = nx; }
+    g_ref_pooled = 0;
+}
+static void outq_link(OutQ* q, OutBlk* b){
+    if (q->tail) q->tail->next = b; else q->head = b;
+    q->tail = b;
 }
 
-static int outq_push_frame(OutQ* q, const uint8_t* frame, size_t n){
-    if (!ensure_cap(q, q->len + n)) return 0;
-    memcpy(q->buf + q->len, frame, n);
-    q->len += n;
-    q->want_wr = 1;
-    return 1;
+/* Зарезервировать n байт в хвосте очереди (кадр кодируется прямо туда) */
+static uint8_t* outq_reserve(OutQ* q, size_t n){
+    if (!q->tail || q->tail->cap - q->tail->len < n){
+        OutBlk* b = blk_new(q, n);
+        if (!b) return NULL;
+        outq_link(q, b);
+    }
+    return q->tail->p + q->tail->len;
+}
+static void outq_commit(OutQ* q, size_t n){
+    q->tail->len += n;
+    q->bytes += n;
+}
+/* Поставить общий кадр ссылкой (мелкий — копией в хвост) */
+static int outq_push_frame(OutQ* q, Cow1TcpFrame* f){
+    if (f->len <= COW1TCP_FRAME_COPY_MAX){
+        uint8_t* dst = outq_reserve(q, f->len);
+        if (!dst) return -1;
+        memcpy(dst, f->data, f->len);
+        outq_commit(q, f->len);
+        return 0;
+    }
+    OutBlk* b = blk_new_ref(f);
+    if (!b) return -1;
+    outq_link(q, b);
+    q->bytes += f->len;
+    return 0;
+}
+/* Отметить n байт отправленными, освобождая пройденные блоки */
+static void outq_advance(OutQ* q, size_t n){
+    q->bytes -= n;
+    while (n && q->head){
+        OutBlk* b = q->head;
+        size_t left = b->len - b->off;
+        if (n < left){ b->off += n; return; }
+        n -= left;
+        q->head = b->next;
+        if (!q->head) q->tail = NULL;
+        blk_release(q, b);
+    }
+}
+static void outq_free(OutQ* q){
+    OutBlk* b = q->head;
+    while (b){ OutBlk* nx = b->next; if (b->ref) blk_release(q, b); else free(b); b = nx; }
+    free(q->spare);
+    memset(q, 0, sizeof(*q));
 }
 
 /* platform-neutral nb recv/send */
 #if defined(_WIN32)
 #  include <winsock2.h>
-static int s_recv(net_fd_t fd, void* b, int cap){ return recv(fd, (char*)b, cap, 0); }
-static int s_send(net_fd_t fd, const void* b, int n){ return send(fd, (const char*)b, n, 0); }
+static int s_would_block(void){
+    int err = WSAGetLastError();
+    return err==WSAEWOULDBLOCK || err==WSAEINPROGRESS || err==WSAEALREADY;
+}
+static int s_recv(net_fd_t fd, void* b, size_t cap, void* extra, size_t extra_cap){
+    (void)extra; (void)extra_cap;
+    return recv(fd, (char*)b, cap > (size_t)INT_MAX ? INT_MAX : (int)cap, 0);
+}
+/* Отправить до COW1TCP_IOV_MAX блоков одним WSASend; >=0 — отправлено байт, -1 — ошибка */
+static long s_sendv(net_fd_t fd, const OutQ* q){
+    WSABUF iov[COW1TCP_IOV_MAX]; DWORD n = 0, sent = 0;
+    for (const OutBlk* b = q->head; b && n < COW1TCP_IOV_MAX; b = b->next){
+        iov[n].buf = (char*)(b->p + b->off); iov[n].len = (ULONG)(b->len - b->off); n++;
+    }
+    if (WSASend(fd, iov, n, &sent, 0, NULL, NULL) != 0) return -1;
+    return (long)sent;
+}
 #else
 #  include <sys/types.h>
 #  include <sys/socket.h>
+#  include <sys/uio.h>
 #  include <errno.h>
-static int s_recv(net_fd_t fd, void* b, int cap){ return (int)recv(fd, b, (size_t)cap, 0); }
-static int s_send(net_fd_t fd, const void* b, int n){ return (int)send(fd, b, (size_t)n, 0); }
+#  ifndef MSG_NOSIGNAL
+#    define MSG_NOSIGNAL 0
+#  endif
+static int s_would_block(void){
+    return errno==EAGAIN || errno==EWOULDBLOCK || errno==EINPROGRESS;
+}
+/* Приём в хвост декодера + «перелив» на стеке: один readv забирает сколько есть */
+static int s_recv(net_fd_t fd, void* b, size_t cap, void* extra, size_t extra_cap){
+    struct iovec iov[2] = { { b, cap }, { extra, extra_cap } };
+    ssize_t rc;
+    do { rc = readv(fd, iov, 2); } while (rc < 0 && errno == EINTR);
+    return rc > INT_MAX ? INT_MAX : (int)rc;
+}
+static long s_sendv(net_fd_t fd, const OutQ* q){
+    struct iovec iov[COW1TCP_IOV_MAX]; int n = 0;
+    for (const OutBlk* b = q->head; b && n < COW1TCP_IOV_MAX; b = b->next){
+        iov[n].iov_base = (void*)(b->p + b->off); iov[n].iov_len = b->len - b->off; n++;
+    }
+    struct msghdr mh; memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov; mh.msg_iovlen = (size_t)n;
+    ssize_t rc;
+    do { rc = sendmsg(fd, &mh, MSG_NOSIGNAL); } while (rc < 0 && errno == EINTR);
+    return (long)rc;
+}
 #endif
 
+static void s_set_wr(Cow1Tcp* c, int want){
+    if (c->wr_armed == want) return;
+    c->wr_armed = want;
+    net_poller_mod(c->np, c->fd, NET_RD | NET_ERR | (want ? NET_WR : 0));
+}
+
+static void s_unlink_pending(Cow1Tcp* c){
+    if (!c->pending) return;
+    for (Cow1Tcp** pp = &g_pending; *pp; pp = &(*pp)->next_pending){
+        if (*pp == c){ *pp = c->next_pending; break; }
+    }
+    c->pending = 0; c->next_pending = NULL;
+}
+
+/* Вытолкнуть очередь: 0 — всё ушло или сокет занят (тогда ждём NET_WR), -1 — ошибка */
+static int s_flush(Cow1Tcp* c){
+    while (c->out.bytes){
+        long rc = s_sendv(c->fd, &c->out);
+        if (rc > 0){ outq_advance(&c->out, (size_t)rc); g_stats.tx_bytes += (uint64_t)rc; continue; }
+        if (rc < 0 && s_would_block()) break;
+        c->wr_armed = 0;
+        net_poller_mod(c->np, c->fd, NET_ERR);
+        return -1;
+    }
+    s_set_wr(c, c->out.bytes != 0);
+    if (c->over && c->out.bytes <= c->lo_wm){
+        c->over = 0;
+        if (c->on_pressure) c->on_pressure(c->user, 0);
+    }
+    return 0;
+}
+
+/* Соединению конец: сообщить владельцу (после колбэка c может уже не быть) */
+static void s_dead(Cow1Tcp* c){
+    c->wr_armed = 0;
+    if (c->on_close){ c->on_close(c->user); return; }
+    net_poller_mod(c->np, c->fd, NET_ERR); /* перестанем читать */
+}
+
 static void s_on_fd(void* user, net_fd_t fd, int ev){
     Cow1Tcp* c = (Cow1Tcp*)user; (void)fd;
     if (!c) return;
     if (ev & NET_ERR){
-        /* Сигнализируем владельцу вне этого слоя; здесь просто перестанем слушать WR */
+        if (c->on_close){ s_dead(c); return; }
+        /* владелец не слушает закрытие — просто перестанем слушать WR */
+        c->wr_armed = 0;
         net_poller_mod(c->np, c->fd, NET_RD|NET_ERR);
         return;
     }
     if (ev & NET_RD){
-        /* читаем порциями */
-        uint8_t tmp[4096];
+        /* читаем прямо в буфер декодера; что не влезло — в перелив на стеке */
+        uint8_t extra[COW1TCP_RD_CHUNK];
         for (;;){
-            int rc = s_recv(c->fd, tmp, (int)sizeof(tmp));
+            size_t avail = 0;
+            uint8_t* dst = cow1_decoder_reserve(&c->dec, COW1TCP_RD_CHUNK, &avail);
+            if (!dst){ net_poller_mod(c->np, c->fd, NET_ERR); return; }
+            int rc = s_recv(c->fd, dst, avail, extra, sizeof(extra));
             if (rc > 0){
-                cow1_decoder_consume(&c->dec, tmp, (size_t)rc);
+                size_t got = (size_t)rc;
+                g_stats.rx_bytes += got;
+                size_t in_place = got < avail ? got : avail;
+                cow1_decoder_commit(&c->dec, in_place);
+                if (got > in_place) cow1_decoder_consume(&c->dec, extra, got - in_place);
                 /* попытаться извлечь все накопленные кадры */
                 for (;;){
-                    ConOp op; char* tag=NULL; void* data=NULL; size_t dlen=0; void* init=NULL; size_t ilen=0;
-                    int k = cow1_decoder_take_next(&c->dec, &op, &tag, &data, &dlen, &init, &ilen);
+                    ConOp op;
+                    int k = cow1_decoder_take_view(&c->dec, &op);
                     if (k <= 0) break;
-                    if (c->on_op) c->on_op(c->user, &op, tag, data, dlen, init, ilen);
-                    conop_wire_free_decoded(tag, data, init);
+                    g_stats.rx_frames++;
+                    if (c->on_op) c->on_op(c->user, &op, op.tag, op.data, op.size, op.init_blob, op.init_size);
                 }
+                if (got < avail + sizeof(extra)) break; /* сокет вычерпан — не тратим лишний syscall на EAGAIN */
             } else if (rc == 0){
                 /* закрыто peer'ом */
-                net_poller_mod(c->np, c->fd, NET_ERR); /* перестанем читать */
-                break;
+                s_dead(c);
+                return;
             } else {
-#if defined(_WIN32)
-                int err = WSAGetLastError();
-                if (err==WSAEWOULDBLOCK || err==WSAEINPROGRESS || err==WSAEALREADY) break;
-#else
-                if (errno==EAGAIN || errno==EWOULDBLOCK || errno==EINPROGRESS) break;
-#endif
-                net_poller_mod(c->np, c->fd, NET_ERR);
-                break;
+                if (s_would_block()) break;
+                s_dead(c);
+                return;
             }
         }
     }
     if (ev & NET_WR){
-        while (c->out.want_wr && c->out.off < c->out.len){
-            size_t left = c->out.len - c->out.off;
-            int to_send = (left > (size_t)INT_MAX) ? INT_MAX : (int)left;
-            int rc = s_send(c->fd, c->out.buf + c->out.off, to_send);
-            if (rc > 0){
-                c->out.off += (size_t)rc;
-            } else {
-#if defined(_WIN32)
-                int err = WSAGetLastError();
-                if (err==WSAEWOULDBLOCK || err==WSAEINPROGRESS || err==WSAEALREADY) break;
-#else
-                if (errno==EAGAIN || errno==EWOULDBLOCK || errno==EINPROGRESS) break;
-#endif
-                net_poller_mod(c->np, c->fd, NET_ERR);
-                return;
-            }
-        }
-        if (c->out.off >= c->out.len){
-            c->out.off = c->out.len = 0;
-            c->out.want_wr = 0;
-        }
+        s_flush(c);
     }
-    /* обновим интересы по WR в зависимости от очереди */
-    int mask = NET_RD | NET_ERR | (c->out.want_wr ? NET_WR : 0);
-    net_poller_mod(c->np, c->fd, mask);
 }
 
 Cow1Tcp* cow1tcp_create(NetPoller* np, net_fd_t fd, Cow1TcpOnOp on_op, void* user){
@@ -122,29 +293,112 @@ Cow1Tcp* cow1tcp_create(NetPoller* np, net_fd_t fd, Cow1TcpOnOp on_op, void* use
     Cow1Tcp* c = (Cow1Tcp*)calloc(1, sizeof(Cow1Tcp));
     if (!c) return NULL;
     c->np = np; c->fd = fd; c->on_op = on_op; c->user = user;
+    c->wire_ver = CONOP_WIRE_VERSION;
+    c->hi_wm = COW1TCP_HIGH_WATER; c->lo_wm = COW1TCP_LOW_WATER;
     cow1_decoder_init(&c->dec);
-    c->out.buf = NULL; c->out.len = c->out.cap = c->out.off = 0; c->out.want_wr = 0;
     net_poller_add(np, fd, NET_RD | NET_ERR, s_on_fd, c);
+    g_conns++;
     return c;
 }
 
 void cow1tcp_destroy(Cow1Tcp* c){
     if (!c) return;
+    s_unlink_pending(c);
     net_poller_del(c->np, c->fd);
     cow1_decoder_reset(&c->dec);
-    free(c->out.buf);
+    outq_free(&c->out);
     free(c);
+    if (--g_conns == 0) ref_pool_drain();
+}
+
+/* Кадр в очереди: вытолкнуть/отложить сброс, проверить high watermark */
+static int s_enqueued(Cow1Tcp* c){
+    g_stats.tx_frames++;
+    /* Сам сброс — в конце кадра; очень длинную очередь выталкиваем сразу */
+    if (c->out.bytes >= COW1TCP_FLUSH_BYTES){
+        s_unlink_pending(c);
+        if (s_flush(c) != 0) return -1;
+    } else if (!c->pending && !c->wr_armed){
+        c->pending = 1;
+        c->next_pending = g_pending;
+        g_pending = c;
+    }
+    if (c->out.bytes >= c->hi_wm){
+        /* peer не успевает: дальше не копим, владелец догонит его журналом/снапшотом */
+        c->over = 1;
+        if (c->on_pressure) c->on_pressure(c->user, 1);
+    }
+    return 0;
 }
 
 int cow1tcp_send(Cow1Tcp* c, const ConOp* op){
     if (!c || !op) return -1;
-    uint8_t* buf = NULL; size_t len = 0;
-    if (conop_wire_encode(op, &buf, &len) != 0) return -1;
-    int ok = outq_push_frame(&c->out, buf, len);
-    free(buf);
-    if (!ok) return -1;
-    /* Попросим WR-интересы у поллера */
-    net_poller_mod(c->np, c->fd, NET_RD | NET_WR | NET_ERR);
+    if (c->over){ g_stats.tx_refused++; return 1; }
+    size_t len = conop_wire_encoded_size_ver(op, c->wire_ver);
+    if (!len) return -1;
+    uint8_t* dst = outq_reserve(&c->out, len);
+    if (!dst || conop_wire_encode_into_ver(op, c->wire_ver, dst, len) != len) return -1;
+    outq_commit(&c->out, len);
+    return s_enqueued(c);
+}
+
+Cow1TcpFrame* cow1tcp_frame_encode(const ConOp* op, uint16_t ver){
+    if (!op || ver < CONOP_WIRE_VERSION || ver > CONOP_WIRE_VERSION_MAX) return NULL;
+    size_t len = conop_wire_encoded_size_ver(op, ver);
+    if (!len) return NULL;
+    Cow1TcpFrame* f = (Cow1TcpFrame*)malloc(sizeof(Cow1TcpFrame) + len);
+    if (!f) return NULL;
+    if (conop_wire_encode_into_ver(op, ver, f->data, len) != len){ free(f); return NULL; }
+    f->refs = 1; f->ver = ver; f->len = len;
+    return f;
+}
+void cow1tcp_frame_unref(Cow1TcpFrame* f){
+    if (f && --f->refs == 0) free(f);
+}
+uint16_t cow1tcp_frame_version(const Cow1TcpFrame* f){ return f ? f->ver : 0; }
+
+int cow1tcp_send_frame(Cow1Tcp* c, Cow1TcpFrame* f){
+    if (!c || !f || f->ver != c->wire_ver) return -1;
+    if (c->over){ g_stats.tx_refused++; return 1; }
+    if (outq_push_frame(&c->out, f) != 0) return -1;
+    g_stats.tx_shared++;
+    return s_enqueued(c);
+}
+
+void cow1tcp_set_on_close(Cow1Tcp* c, Cow1TcpOnClose cb){
+    if (c) c->on_close = cb;
+}
+void cow1tcp_set_on_pressure(Cow1Tcp* c, Cow1TcpOnPressure cb){
+    if (c) c->on_pressure = cb;
+}
+void cow1tcp_set_watermarks(Cow1Tcp* c, size_t high, size_t low){
+    if (!c || !high) return;
+    c->hi_wm = high;
+    c->lo_wm = low < high ? low : high / 2;
+}
+size_t cow1tcp_queued(const Cow1Tcp* c){ return c ? c->out.bytes : 0; }
+
+int cow1tcp_set_wire_version(Cow1Tcp* c, uint16_t ver){
+    if (!c || ver < CONOP_WIRE_VERSION || ver > CONOP_WIRE_VERSION_MAX) return -1;
+    c->wire_ver = ver;
     return 0;
 }
+
+int cow1tcp_flush(Cow1Tcp* c){
+    if (!c) return -1;
+    s_unlink_pending(c);
+    return s_flush(c);
+}
+
+void cow1tcp_flush_pending(void){
+    while (g_pending){
+        Cow1Tcp* c = g_pending;
+        g_pending = c->next_pending;
+        c->pending = 0; c->next_pending = NULL;
+        s_flush(c);
+    }
+}
+void cow1tcp_stats(Cow1TcpStats* out){
+    if (out) *out = g_stats;
+}
 #endif /* !__EMSCRIPTEN__ */
@@ -10,6 +10,36 @@
 
 #ifndef __EMSCRIPTEN__
 
+    /* Размер блока исходящей очереди */
+#ifndef COW1TCP_BLOCK
+#define COW1TCP_BLOCK (64u * 1024u)
+#endif
+    /* Сколько блоков отдаём ядру за один writev/sendmsg */
+#ifndef COW1TCP_IOV_MAX
+#define COW1TCP_IOV_MAX 64
+#endif
+    /* Очередь такого размера выталкивается сразу, не дожидаясь конца кадра */
+#ifndef COW1TCP_FLUSH_BYTES
+#define COW1TCP_FLUSH_BYTES (256u * 1024u)
+#endif
+    /* Водяные знаки исходящей очереди (на соединение, по умолчанию). Выше high
+       cow1tcp_send кадры не принимает, пока очередь не стечёт до low. */
+#ifndef COW1TCP_HIGH_WATER
+#define COW1TCP_HIGH_WATER (4u * 1024u * 1024u)
+#endif
+#ifndef COW1TCP_LOW_WATER
+#define COW1TCP_LOW_WATER  (512u * 1024u)
+#endif
+    /* Минимальный хвост декодера под один readv (+ столько же перелива на стеке) */
+#ifndef COW1TCP_RD_CHUNK
+#define COW1TCP_RD_CHUNK (64u * 1024u)
+#endif
+    /* Общий кадр короче этого копируется в блок очереди, а не ставится ссылкой:
+       лишний слот iovec в sendmsg дороже memcpy пары сотен байт */
+#ifndef COW1TCP_FRAME_COPY_MAX
+#define COW1TCP_FRAME_COPY_MAX 256u
+#endif
+
     typedef struct Cow1Tcp Cow1Tcp;
 
     typedef void (*Cow1TcpOnOp)(void* user,
@@ -18,12 +48,70 @@
                                 const void* data, size_t data_len,
                                 const void* init, size_t init_len);
 
+    /* tag/data/init (и те же поля op) смотрят во входной буфер соединения
+       и валидны только на время колбэка — что нужно дольше, копируйте. */
     /* Обёртка над неблокирующим fd: читает/пишет COW1 кадры. */
     Cow1Tcp* cow1tcp_create(NetPoller* np, net_fd_t fd, Cow1TcpOnOp on_op, void* user);
     void     cow1tcp_destroy(Cow1Tcp*);
 
-    /* Очередь на отправку одного ConOp (внутри encode → send partial). Возврат 0 — ок. */
+    /* Соединение закрыто peer'ом или сломалось. Колбэк зовётся из обработчика поллера
+       с тем же user, что и on_op; владелец может тут же сделать cow1tcp_destroy.
+       Без колбэка соединение просто перестаёт читаться. */
+    typedef void (*Cow1TcpOnClose)(void* user);
+    void     cow1tcp_set_on_close(Cow1Tcp*, Cow1TcpOnClose cb);
+
+    /* Поставить ConOp в очередь (кодируется сразу в буфер соединения).
+       Возврат 0 — поставлен; 1 — не принят: очередь выше high watermark (медленный
+       peer, см. on_pressure); -1 — ошибка (op невалиден, нет памяти, сокет умер).
+       В сеть кадры уходят пачкой: в cow1tcp_flush_pending() в конце кадра,
+       либо сразу, если очередь переросла COW1TCP_FLUSH_BYTES. */
     int      cow1tcp_send(Cow1Tcp*, const ConOp* op);
+
+    /* Общий кадр для рассылки: кодируется один раз и ставится в очереди многих
+       соединений по ссылке (неизменяем, со счётчиком ссылок). Очередь держит
+       свою ссылку, пока кадр не уйдёт в сокет целиком. Всё — из главного потока. */
+    typedef struct Cow1TcpFrame Cow1TcpFrame;
+    /* Закодировать op в версии ver; NULL — op невалиден или нет памяти.
+       Вызывающий владеет одной ссылкой. */
+    Cow1TcpFrame* cow1tcp_frame_encode(const ConOp* op, uint16_t ver);
+    void          cow1tcp_frame_unref(Cow1TcpFrame*);
+    /* Версия кадра — должна совпадать с версией соединения */
+    uint16_t      cow1tcp_frame_version(const Cow1TcpFrame*);
+    /* Как cow1tcp_send, но без кодирования: 0/1/-1 те же; -1 и при чужой версии.
+       Ссылка вызывающего не забирается. */
+    int           cow1tcp_send_frame(Cow1Tcp*, Cow1TcpFrame* f);
+
+    /* Медленный потребитель: over=1 — очередь дошла до high (кадр, на котором это
+       случилось, ещё принят), дальше send отвечает 1; over=0 — стекла до low, можно
+       досылать пропущенное. Зовётся с тем же user, что и on_op; over=0 — только из
+       сброса (конец кадра или NET_WR), не изнутри cow1tcp_send. */
+    typedef void (*Cow1TcpOnPressure)(void* user, int over);
+    void     cow1tcp_set_on_pressure(Cow1Tcp*, Cow1TcpOnPressure cb);
+    /* Свои пороги соединения (байт); low ≥ high — low = high/2 */
+    void     cow1tcp_set_watermarks(Cow1Tcp*, size_t high, size_t low);
+    /* Неотправленных байт в очереди */
+    size_t   cow1tcp_queued(const Cow1Tcp*);
+
+    /* Версия COW1 для исходящих кадров (по умолчанию v1). Выставляется по итогам
+       HELO/WLCM; входящие кадры декодируются в любой версии. 0 — ок. */
+    int      cow1tcp_set_wire_version(Cow1Tcp*, uint16_t ver);
+
+    /* Немедленно вытолкнуть очередь одного соединения (остаток — по NET_WR). 0 — ок. */
+    int      cow1tcp_flush(Cow1Tcp*);
+
+    /* Сбросить все соединения, в которые что-то поставлено с прошлого вызова.
+       Вызывать раз в кадр, после net_poller_tick (см. main.c). */
+    void     cow1tcp_flush_pending(void);
+
+    /* Счётчики по всем соединениям процесса (байты — фактически ушедшие/пришедшие
+       через сокет). Для бенчмарков и диагностики. */
+    typedef struct {
+        uint64_t tx_bytes, rx_bytes;
+        uint64_t tx_frames, rx_frames;
+        uint64_t tx_refused;  /* кадров не принято выше high watermark */
+        uint64_t tx_shared;   /* из tx_frames — из общего кадра, без своего кодирования */
+    } Cow1TcpStats;
+    void     cow1tcp_stats(Cow1TcpStats* out);
 #endif /* __EMSCRIPTEN__ */
 
 #ifdef __cplusplus
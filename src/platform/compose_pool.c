@@ -0,0 +1,102 @@
+#include "compose_pool.h"
+#include <SDL.h>
+
+/* Больше потоков компоновке не помогает — упирается в память */
+#ifndef CPOOL_MAX_THREADS
+#define CPOOL_MAX_THREADS 16
+#endif
+
+struct ComposePool {
+    int          n;        /* рабочих потоков (без вызывающего) */
+    SDL_Thread*  th[CPOOL_MAX_THREADS];
+    SDL_mutex*   mu;
+    SDL_cond*    go;       /* новая партия или выход */
+    SDL_cond*    done;     /* последний рабочий закончил партию */
+    unsigned     gen;      /* номер партии */
+    int          quit;
+    int          busy;     /* рабочих, ещё не закончивших партию */
+    CPoolFn      fn;
+    void*        ctx;
+    int          jobs;
+    SDL_atomic_t next;     /* следующее невыданное задание */
+};
+
+static void s_run_jobs(ComposePool* p){
+    for (;;){
+        int j = SDL_AtomicAdd(&p->next, 1);
+        if (j >= p->jobs) break;
+        p->fn(p->ctx, j);
+    }
+}
+
+static int SDLCALL s_worker(void* arg){
+    ComposePool* p = (ComposePool*)arg;
+    unsigned seen = 0;
+    SDL_LockMutex(p->mu);
+    for (;;){
+        while (!p->quit && p->gen == seen) SDL_CondWait(p->go, p->mu);
+        if (p->quit) break;
+        seen = p->gen;
+        SDL_UnlockMutex(p->mu);
+        s_run_jobs(p);
+        SDL_LockMutex(p->mu);
+        if (--p->busy == 0) SDL_CondSignal(p->done);
+    }
+    SDL_UnlockMutex(p->mu);
+    return 0;
+}
+
+ComposePool* cpool_create(int threads){
+    if (threads < 0) threads = SDL_GetCPUCount();
+    if (threads > CPOOL_MAX_THREADS) threads = CPOOL_MAX_THREADS;
+    if (threads <= 1) return NULL;
+    ComposePool* p = (ComposePool*)SDL_calloc(1, sizeof(ComposePool));
+    if (!p) return NULL;
+    p->mu = SDL_CreateMutex(); p->go = SDL_CreateCond(); p->done = SDL_CreateCond();
+    if (!p->mu || !p->go || !p->done){ cpool_destroy(p); return NULL; }
+    for (int i = 0; i < threads - 1; i++){
+        SDL_Thread* t = SDL_CreateThread(s_worker, "compose", p);
+        if (!t) break; /* сколько создалось — с тем и работаем */
+        p->th[p->n++] = t;
+    }
+    if (p->n == 0){ cpool_destroy(p); return NULL; }
+    return p;
+}
+
+void cpool_destroy(ComposePool* p){
+    if (!p) return;
+    if (p->mu){
+        SDL_LockMutex(p->mu);
+        p->quit = 1;
+        if (p->go) SDL_CondBroadcast(p->go);
+        SDL_UnlockMutex(p->mu);
+    }
+    for (int i = 0; i < p->n; i++) SDL_WaitThread(p->th[i], NULL);
+    if (p->done) SDL_DestroyCond(p->done);
+    if (p->go)   SDL_DestroyCond(p->go);
+    if (p->mu)   SDL_DestroyMutex(p->mu);
+    SDL_free(p);
+}
+
+int cpool_threads(const ComposePool* p){ return p ? p->n + 1 : 1; }
+
+void cpool_run(ComposePool* p, int jobs, CPoolFn fn, void* ctx){
+    if (jobs <= 0 || !fn) return;
+    if (!p || jobs == 1){
+        for (int j = 0; j < jobs; j++) fn(ctx, j);
+        return;
+    }
+    SDL_LockMutex(p->mu);
+    p->fn = fn; p->ctx = ctx; p->jobs = jobs;
+    SDL_AtomicSet(&p->next, 0);
+    p->busy = p->n;
+    p->gen++;
+    SDL_CondBroadcast(p->go);
+    SDL_UnlockMutex(p->mu);
+
+    s_run_jobs(p); /* вызывающий поток тоже работает */
+
+    SDL_LockMutex(p->mu);
+    while (p->busy) SDL_CondWait(p->done, p->mu);
+    SDL_UnlockMutex(p->mu);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/* Пул рабочих потоков компоновщика (SDL-потоки). Одна операция — «параллельный
+ * for»: cpool_run раздаёт задания 0..jobs-1 рабочим и вызывающему потоку и
+ * возвращается, когда все выполнены. Задания должны писать в непересекающиеся
+ * области. Без потоков (threads ≤ 1, wasm, ошибка создания) всё выполняется
+ * последовательно в вызывающем потоке. */
+
+typedef struct ComposePool ComposePool;
+typedef void (*CPoolFn)(void* ctx, int job);
+
+/* threads — сколько всего потоков считать (включая вызывающий); < 0 — по числу ядер */
+ComposePool* cpool_create(int threads);
+void         cpool_destroy(ComposePool*);
+/* Число потоков, участвующих в cpool_run (≥ 1; для NULL — 1) */
+int          cpool_threads(const ComposePool*);
+void         cpool_run(ComposePool*, int jobs, CPoolFn fn, void* ctx);
@@ -0,0 +1,191 @@
+#include "compositor.h"
+#include "compose_pool.h"
+#include "../core/wm.h"
+#include "../core/drag.h"
+#include "../core/perf.h"
+#include <stdio.h>
+
+/* Нарезка damage на задания пула (см. compose_split) */
+#ifndef COMPOSE_MAX_JOBS
+#define COMPOSE_MAX_JOBS 256
+#endif
+#ifndef COMPOSE_JOBS_PER_THREAD
+#define COMPOSE_JOBS_PER_THREAD 4
+#endif
+/* Меньшие куски дешевле собрать на месте, чем будить потоки */
+#ifndef COMPOSE_MIN_JOB_PX
+#define COMPOSE_MIN_JOB_PX (64*1024)
+#endif
+
+struct Compositor {
+    ComposePool *pool;     /* NULL — однопоточно */
+    /* текущий кадр — для заданий пула */
+    WM          *wm;
+    Surface     *back;
+    SDL_Surface *screen;
+    Rect         jobs[COMPOSE_MAX_JOBS];
+};
+
+Compositor* compositor_create(void){
+    return (Compositor*)SDL_calloc(1, sizeof(Compositor));
+}
+void compositor_destroy(Compositor* c){
+    if (!c) return;
+    cpool_destroy(c->pool);
+    SDL_free(c);
+}
+void compositor_set_threads(Compositor* c, int threads){
+    if (!c) return;
+    cpool_destroy(c->pool);
+    c->pool = cpool_create(threads);
+}
+
+/* Заливка, обрезанная по clip: задание компоновки пишет только в свой кусок */
+static void fill_clipped(Surface* dst, Rect clip, int x,int y,int w,int h, uint32_t argb){
+    Rect r = rect_intersect(clip, rect_make(x,y,w,h));
+    if (!rect_is_empty(r)) surface_fill_rect(dst, r.x, r.y, r.w, r.h, argb);
+}
+
+/* Кусок backbuffer'а целиком: фон, окна снизу-вверх, drag overlay, копия в экран.
+   Пишет только внутри dr, так что куски можно собирать параллельно. */
+static void compose_rect(Compositor* c, Rect dr){
+    WM* wm = c->wm;
+    /* Окклюзия: фон и каждое окно рисуем только там, где их не закрывает
+       opaque-окно выше по z — перекрытое не заливается и не блитится */
+    Rect parts[WM_OCCLUDE_PARTS];
+    int np = wm_visible_parts(wm, -1, dr, parts);
+
+    // очистка фона в backbuffer
+    for (int pi=0; pi<np; ++pi)
+        surface_fill_rect(c->back, parts[pi].x, parts[pi].y, parts[pi].w, parts[pi].h, 0xFF000000);
+
+    // окна снизу-вверх (перерисованы заранее, в compose_prepare)
+    for (int wi=0; wi<wm->count; ++wi){
+        Window *w = wm->win[wi]; if (!w->visible) continue;
+        Rect inter = rect_intersect(dr, w->frame);
+        if (rect_is_empty(inter)) continue;
+        np = wm_visible_parts(wm, wi, inter, parts);
+
+        for (int pi=0; pi<np; ++pi){
+            Rect p = parts[pi];
+            // источник в локальных координатах окна
+            int sx = p.x - w->frame.x;
+            int sy = p.y - w->frame.y;
+            // blit: окно -> backbuffer (opaque — прямая копия строк, иначе source-over)
+            if (w->opaque) surface_copy(w->cache, sx, sy, p.w, p.h, c->back, p.x, p.y);
+            else           surface_blit(w->cache, sx, sy, p.w, p.h, c->back, p.x, p.y);
+        }
+    }
+
+    /* ----- поверх окон дорисовываем активные drag overlay для всех пользователей ----- */
+    for (int uid=0; uid<WM_MAX_USERS; ++uid){
+        WMDrag* d = wm_get_drag(wm, uid);
+        if (!d || !d->active || !d->preview) continue;
+        int ox = d->x - d->hot_x;
+        int oy = d->y - d->hot_y;
+        Rect ovr = rect_make(ox, oy, surface_w(d->preview), surface_h(d->preview));
+        Rect inter = rect_intersect(dr, ovr);
+        if (rect_is_empty(inter)) continue;
+        int sx = inter.x - ox;
+        int sy = inter.y - oy;
+        surface_blit(d->preview, sx,sy, inter.w, inter.h, c->back, inter.x, inter.y);
+
+        /* Бейдж запрета: если текущий hover выставил REJECT/ NONE */
+        if (d->effect==WM_DRAG_REJECT || d->effect==WM_DRAG_NONE){
+            /* рисуем простой «no» знак 16x16 в правом-нижнем углу превью */
+            int bw=16, bh=16;
+            int bx = ox + surface_w(d->preview) - bw;
+            int by = oy + surface_h(d->preview) - bh;
+            /* круг — грубо прямоугольник с «скруглением» не делаем, просто фон и диагональ */
+            fill_clipped(c->back, dr, bx, by, bw, bh, 0xCCAA0000);      /* красный фон с альфой */
+            fill_clipped(c->back, dr, bx+1, by+1, bw-2, bh-2, 0xFFFF0000); /* ярче внутри */
+            /* диагональная полоса */
+            for (int i=0;i<bh;i++){
+                int rx = bx + i/2; /* примитивная диагональ */
+                fill_clipped(c->back, dr, rx, by+i, 8, 1, 0xFFFFFFFF);
+            }
+        }
+    }
+
+    /* backbuffer целиком непрозрачен — в экран просто копируем */
+    if (c->screen) surface_blit_sdl(c->back, dr.x, dr.y, dr.w, dr.h, c->screen, dr.x, dr.y, true);
+}
+
+/* Последовательная часть: draw() окон, чьи видимые части попали в damage
+   (код приложений не потокобезопасен). Возвращает true, если все блиты кадра
+   идут мимо SDL_BlitSurface и куски можно собирать параллельно. */
+static bool compose_prepare(Compositor* c, WM* wm, const Rect* rs, int n){
+    bool direct = !c->screen || surface_blit_direct(c->back, c->screen, true);
+    Rect parts[WM_OCCLUDE_PARTS];
+    for (int wi=0; wi<wm->count; ++wi){
+        Window *w = wm->win[wi]; if (!w->visible) continue;
+        bool seen = false;
+        for (int i=0; i<n && !seen; ++i)
+            seen = wm_visible_parts(wm, wi, rect_intersect(rs[i], w->frame), parts) > 0;
+        if (!seen) continue; /* целиком под opaque-окнами: даже не перерисовываем */
+        // перерисовка окна при необходимости
+        if (w->invalid_all && w->vt && w->vt->draw){
+            uint64_t t0 = perf_now_ns();
+            w->vt->draw(w, &w->frame);
+            if (perf_enabled()){
+                if (w->perf_slot < 0){
+                    char nm[40]; snprintf(nm, sizeof(nm), "draw:%s", w->name);
+                    w->perf_slot = perf_slot(nm);
+                }
+                perf_record(w->perf_slot, perf_now_ns() - t0);
+            }
+        }
+        direct = direct && surface_blit_direct(w->cache, c->back->s, w->opaque);
+    }
+    for (int uid=0; uid<WM_MAX_USERS; ++uid){
+        WMDrag* d = wm_get_drag(wm, uid);
+        if (d && d->active && d->preview) direct = direct && surface_blit_direct(d->preview, c->back->s, false);
+    }
+    return direct;
+}
+
+/* Нарезать damage на горизонтальные полосы примерно равной площади: по
+   COMPOSE_JOBS_PER_THREAD на поток, но не мельче COMPOSE_MIN_JOB_PX */
+static int compose_split(const Rect* rs, int n, int threads, Rect* out, int cap){
+    long long total = 0;
+    for (int i=0; i<n; ++i) total += (long long)rs[i].w * rs[i].h;
+    long long target = total / ((long long)threads * COMPOSE_JOBS_PER_THREAD);
+    if (target < COMPOSE_MIN_JOB_PX) target = COMPOSE_MIN_JOB_PX;
+    int k = 0;
+    for (int i=0; i<n; ++i){
+        Rect r = rs[i];
+        long long area = (long long)r.w * r.h;
+        int bands = (int)((area + target - 1) / target);
+        int room  = cap - k - (n - i - 1); /* каждому следующему rect'у — хотя бы слот */
+        if (bands > room) bands = room;
+        if (bands > r.h)  bands = r.h;
+        if (bands < 1)    bands = 1;
+        int step = (r.h + bands - 1) / bands;
+        for (int y = r.y; y < r.y + r.h; y += step){
+            int h = r.y + r.h - y < step ? r.y + r.h - y : step;
+            out[k++] = rect_make(r.x, y, r.w, h);
+        }
+    }
+    return k;
+}
+
+static void compose_job(void* ctx, int i){
+    Compositor* c = (Compositor*)ctx;
+    compose_rect(c, c->jobs[i]);
+}
+
+void compositor_run(Compositor* c, WM* wm, Surface* back, SDL_Surface* screen, const Rect* rs, int n){
+    if (!c || !wm || !back || n <= 0) return;
+    c->wm = wm; c->back = back; c->screen = screen;
+    static int s_blit = -1;
+    bool par = compose_prepare(c, wm, rs, n) && c->pool;
+    uint64_t t0 = perf_now_ns();
+    if (par){
+        /* полосы не пересекаются ни в backbuffer, ни в экране */
+        int nj = compose_split(rs, n, cpool_threads(c->pool), c->jobs, COMPOSE_MAX_JOBS);
+        cpool_run(c->pool, nj, compose_job, c);
+    } else {
+        for (int i=0; i<n; ++i) compose_rect(c, rs[i]);
+    }
+    perf_record_named(&s_blit, "compose.blit", perf_now_ns() - t0);
+}
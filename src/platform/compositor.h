@@ -0,0 +1,20 @@
+#pragma once
+#include <SDL.h>
+#include "../core/window.h"
+#include "../gfx/surface.h"
+
+struct WM;
+
+/* Компоновщик кадра, общий для всех бэкендов платформы: по списку damage
+ * собирает backbuffer из кешей окон (окклюзия под opaque-окнами, drag
+ * overlay) и копирует готовые куски в экран. draw() окон вызывается в
+ * вызывающем потоке; заливка и блиты при наличии пула идут полосами
+ * параллельно (см. compose_pool.h). */
+typedef struct Compositor Compositor;
+
+Compositor* compositor_create(void);
+void        compositor_destroy(Compositor*);
+/* 0/1 — однопоточно, < 0 — по числу ядер */
+void        compositor_set_threads(Compositor*, int threads);
+/* rs — непересекающиеся rect'ы экрана; screen == NULL — только backbuffer */
+void        compositor_run(Compositor*, struct WM*, Surface* back, SDL_Surface* screen, const Rect* rs, int n);
@@ -0,0 +1,180 @@
+#include "platform_headless.h"
+#include <SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../core/wm.h"
+#include "../core/input.h"
+#include "../core/timing.h"
+#include "../gfx/surface.h"
+#include "../gfx/pixops.h"
+#include "compositor.h"
+
+enum { HL_INPUT = 1, HL_RESIZE, HL_QUIT };
+
+typedef struct {
+    int        kind;
+    InputEvent ie;    /* HL_INPUT */
+    int        w, h;  /* HL_RESIZE */
+} HlEvent;
+
+struct Platform {
+    Surface    *back;          /* offscreen ARGB backbuffer */
+    uint32_t    last_present_ms;
+    uint32_t    step_ms;       /* сдвиг часов на кадр */
+    uint64_t    frame_limit;   /* 0 — без предела */
+    uint64_t    polls;         /* кадров главной петли */
+    HlEvent    *q; size_t qhead, qlen, qcap;
+    Compositor *comp;
+    PlatHeadlessStats st;
+};
+
+/* Виртуальные часы — одни на процесс, как и SDL_GetTicks */
+static uint32_t g_now_ms = 1;
+
+uint32_t plat_now_ms(void){ return g_now_ms; }
+void plat_headless_advance(uint32_t ms){ g_now_ms += ms; }
+
+static uint64_t env_u64(const char* name, uint64_t def){
+    const char* s = getenv(name);
+    if (!s || !*s) return def;
+    char* end = NULL;
+    unsigned long long v = strtoull(s, &end, 0);
+    return end == s ? def : (uint64_t)v;
+}
+
+Platform* plat_create(const char *title, int w, int h){
+    (void)title;
+    if (w <= 0 || h <= 0) return NULL;
+    Platform *pf = (Platform*)calloc(1, sizeof(Platform));
+    if (!pf) return NULL;
+    pf->back = surface_create_argb(w, h);
+    if (!pf->back || !pf->back->s){ plat_destroy(pf); return NULL; }
+    surface_fill(pf->back, 0xFF000000);
+    pf->step_ms     = (uint32_t)env_u64("HEADLESS_STEP_MS", FRAME_MS);
+    pf->frame_limit = env_u64("HEADLESS_FRAMES", 0);
+    pixops_init();
+    pf->comp = compositor_create();
+    return pf;
+}
+
+void plat_destroy(Platform* pf){
+    if (!pf) return;
+    compositor_destroy(pf->comp);
+    if (pf->back) surface_free(pf->back);
+    free(pf->q);
+    free(pf);
+}
+
+void plat_get_output_size(Platform* pf, int *w, int *h){
+    if (w) *w = pf ? surface_w(pf->back) : 0;
+    if (h) *h = pf ? surface_h(pf->back) : 0;
+}
+
+void plat_set_compose_threads(Platform* pf, int threads){
+    if (pf) compositor_set_threads(pf->comp, threads);
+}
+
+void plat_headless_set_step(Platform* pf, uint32_t ms){ if (pf) pf->step_ms = ms; }
+Surface* plat_headless_backbuffer(Platform* pf){ return pf ? pf->back : NULL; }
+void plat_headless_stats(Platform* pf, PlatHeadlessStats* out){
+    if (!out) return;
+    if (pf) *out = pf->st; else memset(out, 0, sizeof(*out));
+}
+
+/* ===== Очередь синтетических событий ===== */
+static void q_push(Platform* pf, const HlEvent* ev){
+    if (!pf) return;
+    if (pf->qlen == pf->qcap){
+        size_t n = pf->qcap ? pf->qcap * 2 : 64;
+        HlEvent* nq = (HlEvent*)realloc(pf->q, n * sizeof(HlEvent));
+        if (!nq) return;
+        pf->q = nq; pf->qcap = n;
+    }
+    pf->q[pf->qlen++] = *ev;
+}
+
+void plat_headless_push_input(Platform* pf, const InputEvent* ie){
+    if (!ie) return;
+    HlEvent ev; memset(&ev, 0, sizeof(ev));
+    ev.kind = HL_INPUT; ev.ie = *ie;
+    q_push(pf, &ev);
+}
+void plat_headless_push_resize(Platform* pf, int w, int h){
+    HlEvent ev; memset(&ev, 0, sizeof(ev));
+    ev.kind = HL_RESIZE; ev.w = w; ev.h = h;
+    q_push(pf, &ev);
+}
+void plat_headless_push_quit(Platform* pf){
+    HlEvent ev; memset(&ev, 0, sizeof(ev));
+    ev.kind = HL_QUIT;
+    q_push(pf, &ev);
+}
+
+bool plat_poll_events_and_dispatch(Platform* pf, WM* wm){
+    if (!pf) return false;
+    g_now_ms += pf->step_ms;
+    if (pf->frame_limit && pf->polls >= pf->frame_limit) return false;
+    pf->polls++;
+
+    /* события, добавленные из обработчиков, ждут следующего кадра — как у SDL */
+    size_t end = pf->qlen;
+    while (pf->qhead < end){
+        HlEvent ev = pf->q[pf->qhead++];
+        switch (ev.kind){
+        case HL_QUIT:
+            return false;
+        case HL_RESIZE:
+            if (ev.w <= 0 || ev.h <= 0) break;
+            {
+                /* нет памяти под новый backbuffer — остаёмся в старом размере */
+                Surface* nb = surface_create_argb(ev.w, ev.h);
+                if (!nb || !nb->s){ surface_free(nb); break; }
+                if (pf->back) surface_free(pf->back);
+                pf->back = nb;
+            }
+            surface_fill(pf->back, 0xFF000000);
+            wm_resize(wm, ev.w, ev.h); /* damage на весь экран добавит сам */
+            break;
+        case HL_INPUT:
+            switch (ev.ie.type){
+            case 1: input_route_key(wm, &ev.ie);   break;
+            case 2: input_route_text(wm, &ev.ie);  break;
+            case 3: case 4: case 5: input_route_mouse(wm, &ev.ie); break;
+            default: break;
+            }
+            break;
+        }
+    }
+    if (pf->qhead == pf->qlen) pf->qhead = pf->qlen = 0;
+    return true;
+}
+
+void plat_compose_and_present(Platform* pf, WM* wm){
+    int n = wm_damage_count(wm);
+    bool anim = wm_any_animating(wm) || wm_any_drag_active(wm);
+
+    if (n==0 && !anim) return;
+
+    /* вместо SDL_Delay — просто переводим часы к следующему кадру */
+    if (anim && (g_now_ms - pf->last_present_ms) < FRAME_MS){
+        g_now_ms = pf->last_present_ms + FRAME_MS;
+    }
+
+    Rect rs[MAX_DAMAGE];
+    int nr = n ? n : 1;
+    if (n) for (int i=0;i<n;i++) rs[i] = wm_damage_get(wm, i);
+    else   rs[0] = rect_make(0,0, surface_w(pf->back), surface_h(pf->back));
+
+    /* время компоновки — настоящее: это и меряем */
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    compositor_run(pf->comp, wm, pf->back, NULL, rs, nr);
+    uint64_t us = (SDL_GetPerformanceCounter() - t0) * 1000000ull / SDL_GetPerformanceFrequency();
+
+    pf->st.frames++;
+    pf->st.compose_us_total += us;
+    pf->st.compose_us_last = (uint32_t)us;
+    if (pf->st.compose_us_last > pf->st.compose_us_max) pf->st.compose_us_max = pf->st.compose_us_last;
+
+    pf->last_present_ms = g_now_ms;
+    damage_clear(&wm->damage);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include "platform_sdl.h"
+#include "../core/window.h"
+
+/* Headless-бэкенд (make PLATFORM=headless): тот же plat_* API, но без окна и
+ * дисплея. Кадр собирается в offscreen ARGB backbuffer, события берутся из
+ * синтетической очереди, время — виртуальные часы: каждый
+ * plat_poll_events_and_dispatch сдвигает их на шаг (по умолчанию FRAME_MS),
+ * ожидание кадра анимации — тоже сдвиг часов, а не сон. Прогон с одним и тем же
+ * сценарием событий воспроизводим.
+ *
+ * Окружение (читается в plat_create):
+ *   HEADLESS_FRAMES  — после стольких опросов poll вернёт false (0 — без предела)
+ *   HEADLESS_STEP_MS — шаг часов на кадр */
+
+/* Синтетический ввод: маршрутизируется как в SDL-бэкенде по ie->type
+   (1 — key, 2 — text, 3/4/5 — мышь); user_id берётся из события как есть */
+void plat_headless_push_input(Platform*, const InputEvent* ie);
+/* Смена размера «экрана»: новый backbuffer, wm_resize, damage на весь экран */
+void plat_headless_push_resize(Platform*, int w, int h);
+/* poll вернёт false, дойдя до этого события */
+void plat_headless_push_quit(Platform*);
+
+/* Виртуальные часы */
+void plat_headless_advance(uint32_t ms);
+void plat_headless_set_step(Platform*, uint32_t ms_per_frame);
+
+/* Собранный кадр (для сверки пикселей в сценариях) */
+Surface* plat_headless_backbuffer(Platform*);
+
+/* Статистика: сколько кадров собрано (был damage/анимация) и реальное время компоновки, мкс */
+typedef struct {
+    uint64_t frames;
+    uint64_t compose_us_total;
+    uint32_t compose_us_last;
+    uint32_t compose_us_max;
+} PlatHeadlessStats;
+void plat_headless_stats(Platform*, PlatHeadlessStats* out);
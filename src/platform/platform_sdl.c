@@ -5,6 +5,8 @@
 #include "../core/timing.h"
 #include "../gfx/surface.h"
 #include "../core/drag.h"
+#include "../gfx/pixops.h"
+#include "compositor.h"
 
 struct Platform {
     SDL_Window  *win;
@@ -14,15 +16,11 @@ struct Platform {
     /* --- эмуляция multi-user для демо: активный uid выбираем кликом по половине экрана --- */
     int          active_uid;   /* 0 или 1 */
     int          last_mx, last_my;
+    Compositor  *comp;
 };
 
 uint32_t plat_now_ms(void){ return SDL_GetTicks(); }
 
-static void blit_rect_from_to(Surface *src, SDL_Surface *dst, int sx,int sy,int w,int h, int dx,int dy){
-    SDL_Rect s = { sx,sy,w,h }, d = { dx,dy,w,h };
-    SDL_BlitSurface(src->s, &s, dst, &d);
-}
-
 Platform* plat_create(const char *title, int w, int h){
     if (SDL_Init(SDL_INIT_VIDEO)!=0) return NULL;
     SDL_Window *win = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -37,12 +35,15 @@ Platform* plat_create(const char *title, int w, int h){
     pf->active_uid = 0;
     pf->last_mx = pf->last_my = 0;
     surface_fill(pf->back, 0xFF000000);
+    pixops_init(); /* выбор SIMD-ядер — до того, как их позовут из пула */
+    pf->comp = compositor_create();
     return pf;
 }
 
 void plat_destroy(Platform* pf){
     if (!pf) return;
     SDL_StopTextInput();
+    compositor_destroy(pf->comp);
     if (pf->back) surface_free(pf->back);
     if (pf->win) SDL_DestroyWindow(pf->win);
     SDL_Quit();
@@ -139,6 +140,9 @@ bool plat_poll_events_and_dispatch(Platform* pf, WM* wm){
     return true;
 }
 
+void plat_set_compose_threads(Platform* pf, int threads){
+    if (pf) compositor_set_threads(pf->comp, threads);
+}
 
 void plat_compose_and_present(Platform* pf, WM* wm){
     int n = wm_damage_count(wm);
@@ -152,75 +156,18 @@ void plat_compose_and_present(Platform* pf, WM* wm){
     }
 
     // Если damage нет, но нужна анимация — рисуем весь экран
-    Rect full = rect_make(0,0, pf->screen->w, pf->screen->h);
-
-    for (int di=0; di < (n? n:1); ++di){
-        Rect dr = n ? wm_damage_get(wm, di) : full;
-
-        // очистка фона в backbuffer
-        surface_fill_rect(pf->back, dr.x, dr.y, dr.w, dr.h, 0xFF000000);
-
-        // окна снизу-вверх
-        for (int wi=0; wi<wm->count; ++wi){
-            Window *w = wm->win[wi]; if (!w->visible) continue;
-            Rect inter = rect_intersect(dr, w->frame);
-            if (rect_is_empty(inter)) continue;
-
-            // перерисовка окна при необходимости
-            if (w->invalid_all && w->vt && w->vt->draw){
-                w->vt->draw(w, &w->frame);
-            }
-
-            // источник в локальных координатах окна
-            int sx = inter.x - w->frame.x;
-            int sy = inter.y - w->frame.y;
-            // blit: окно -> backbuffer
-            SDL_Rect s = { sx, sy, inter.w, inter.h };
-            SDL_Rect d = { inter.x, inter.y, inter.w, inter.h };
-            SDL_BlitSurface(w->cache->s, &s, pf->back->s, &d);
-        }
+    Rect rs[MAX_DAMAGE]; /* damage уже непересекающийся и не длиннее MAX_DAMAGE */
+    int nr = n ? n : 1;
+    if (n) for (int i=0;i<n;i++) rs[i] = wm_damage_get(wm, i);
+    else   rs[0] = rect_make(0,0, pf->screen->w, pf->screen->h);
 
-        // ВАЖНО: скопировать готовый регион из backbuffer в surface окна
-        SDL_Rect r = { dr.x, dr.y, dr.w, dr.h };
-
-        /* ----- поверх окон дорисовываем активные drag overlay для всех пользователей ----- */
-        for (int uid=0; uid<WM_MAX_USERS; ++uid){
-            WMDrag* d = wm_get_drag(wm, uid);
-            if (!d || !d->active || !d->preview) continue;
-            int ox = d->x - d->hot_x;
-            int oy = d->y - d->hot_y;
-            Rect ovr = rect_make(ox, oy, surface_w(d->preview), surface_h(d->preview));
-            Rect inter = rect_intersect(dr, ovr);
-            if (rect_is_empty(inter)) continue;
-            int sx = inter.x - ox;
-            int sy = inter.y - oy;
-            blit_rect_from_to(d->preview, pf->back->s, sx,sy, inter.w, inter.h, inter.x, inter.y);
-
-            /* Бейдж запрета: если текущий hover выставил REJECT/ NONE */
-            if (d->effect==WM_DRAG_REJECT || d->effect==WM_DRAG_NONE){
-                /* рисуем простой «no» знак 16x16 в правом-нижнем углу превью */
-                int bw=16, bh=16;
-                int bx = ox + surface_w(d->preview) - bw;
-                int by = oy + surface_h(d->preview) - bh;
-                /* круг — грубо прямоугольник с «скруглением» не делаем, просто фон и диагональ */
-                surface_fill_rect(pf->back, bx, by, bw, bh, 0xCCAA0000);      /* красный фон с альфой */
-                surface_fill_rect(pf->back, bx+1, by+1, bw-2, bh-2, 0xFFFF0000); /* ярче внутри */
-                /* диагональная полоса */
-                for (int i=0;i<bh;i++){
-                    int rx = bx + i/2; /* примитивная диагональ */
-                    surface_fill_rect(pf->back, rx, by+i, 8, 1, 0xFFFFFFFF);
-                }
-            }
-        }
-
-        SDL_BlitSurface(pf->back->s, &r, pf->screen, &r);
-    }
+    compositor_run(pf->comp, wm, pf->back, pf->screen, rs, nr);
 
     // Показать
     if (n){
-        SDL_Rect rs[64]; if (n>64) n=64;
-        for (int i=0;i<n;i++){ Rect r=wm_damage_get(wm,i); rs[i]=(SDL_Rect){r.x,r.y,r.w,r.h}; }
-        SDL_UpdateWindowSurfaceRects(pf->win, rs, n);
+        SDL_Rect sr[MAX_DAMAGE];
+        for (int i=0;i<n;i++) sr[i]=(SDL_Rect){rs[i].x,rs[i].y,rs[i].w,rs[i].h};
+        SDL_UpdateWindowSurfaceRects(pf->win, sr, n);
     } else {
         // полный экран при анимации
         SDL_UpdateWindowSurface(pf->win);
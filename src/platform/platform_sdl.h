@@ -12,5 +12,8 @@ void      plat_get_output_size(Platform*, int *w, int *h);
 
 bool      plat_poll_events_and_dispatch(Platform*, struct WM*);
 void      plat_compose_and_present(Platform*, struct WM*);
+/* Пул потоков для компоновки: 0/1 — однопоточно, < 0 — по числу ядер.
+   draw() окон всегда в вызывающем потоке; параллелятся заливка/блиты/оверлеи. */
+void      plat_set_compose_threads(Platform*, int threads);
 
 uint32_t  plat_now_ms(void);
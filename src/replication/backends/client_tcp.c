@@ -9,24 +9,48 @@
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <time.h>
 
 /* ===== HELO/WLCM (тот же формат, что в leader_tcp.c) ===== */
 #define HS_MAGIC_HELO 0x4F4C4548u /* 'HELO' LE */
 #define HS_MAGIC_WLCM 0x4D434C57u /* 'WLCM' LE */
 #define HS_VER        1u
+#define HS_VER_RESUME 2u      /* + u64 epoch, u64 seq */
+#define HS_VER_HEAD   3u      /* как 2; WLCM ещё + u64 head */
 typedef struct {
     uint32_t magic;   /* HELO */
-    uint16_t ver;     /* 1 */
-    uint16_t _rsv;
+    uint16_t ver;     /* 1, 2 или 3 */
+    uint16_t wire;    /* HELO: макс. версия COW1 клиента; WLCM: выбранная (0 — v1) */
     uint64_t console_id;
 } HelloPkt;                   /* 16 bytes */
 typedef HelloPkt WelcomePkt;  /* magic=WLCM */
+/* ver=2. HELO: эпоха лидера и последний полученный seq; WLCM: эпоха и seq, после которого идёт поток */
+typedef struct {
+    HelloPkt h;
+    uint64_t epoch;
+    uint64_t seq;
+} ResumePkt;                  /* 32 bytes */
+/* ver=3, только WLCM: head — seq последней op лидера на момент ответа */
+typedef struct {
+    ResumePkt r;
+    uint64_t  head;
+} ResumeHeadPkt;              /* 40 bytes */
+/* Снапшот-откат лидера: data — u64 seq, который он покрывает (см. leader_tcp.c) */
+#define LEADER_SNAP_TAG "snapshot.seq"
 
 #ifndef CLIENT_MAX_LISTENERS
 #  define CLIENT_MAX_LISTENERS 16
 #endif
-#ifndef CLIENT_MAX_BUFFERED
-#  define CLIENT_MAX_BUFFERED 128
+/* Outbox: копии op до эха лидера (и без связи — до WLCM); лимит — байты */
+#ifndef CLIENT_OUTBOX_BYTES
+#  define CLIENT_OUTBOX_BYTES (1u * 1024u * 1024u)
+#endif
+/* Автопереподключение: задержка удваивается от MIN до MAX, джиттер — [d/2, d] */
+#ifndef CLIENT_RECONNECT_MIN_MS
+#  define CLIENT_RECONNECT_MIN_MS 100u
+#endif
+#ifndef CLIENT_RECONNECT_MAX_MS
+#  define CLIENT_RECONNECT_MAX_MS 10000u
 #endif
 
 typedef struct Listener {
@@ -37,6 +61,12 @@ typedef struct Listener {
 
 enum CliState { ST_IDLE=0, ST_CONNECTING, ST_HELO_WR, ST_WLCM_RD, ST_STREAM };
 
+/* Запись outbox: своя копия op вместе с tag/data/init */
+typedef struct OutEnt {
+    ConOp  op;
+    size_t bytes;
+} OutEnt;
+
 typedef struct {
     NetPoller* np;
     uint64_t   console_id;
@@ -45,18 +75,38 @@ typedef struct {
     enum CliState st;
     net_fd_t   fd;
     size_t     out_off, out_len;
-    uint8_t    out_buf[sizeof(HelloPkt)];
+    uint8_t    out_buf[sizeof(ResumePkt)];
     size_t     in_got;
-    uint8_t    in_buf[sizeof(WelcomePkt)];
+    uint8_t    in_buf[sizeof(ResumeHeadPkt)];
     Cow1Tcp*   cow; /* в ST_STREAM */
 
+    /* позиция в потоке лидера — переживает переподключения */
+    uint64_t   epoch;   /* 0 — потока ещё не было */
+    uint64_t   seq;     /* последний полученный seq */
+    uint64_t   hold;    /* WLCM v3: outbox ждёт, пока seq дойдёт до head; 0 — не ждёт */
+
     /* локальные слушатели */
     Listener   ls[CLIENT_MAX_LISTENERS];
     int        ln;
 
-    /* небольшой буфер publish до установления STREAM (копии ConOp payload’ов) */
-    ConOp      q[CLIENT_MAX_BUFFERED];
-    int        qn;
+    /* outbox: все publish по порядку, пока лидер не вернёт их эхом — ob[obh..obh+obn).
+       Первые obsent уже сданы в текущее соединение, остальные ждут STREAM (или
+       пока очередь Cow1Tcp не стечёт ниже low watermark) */
+    OutEnt*    ob;
+    size_t     obh, obn, obcap, obbytes, obsent;
+    uint64_t   ob_dropped;  /* не влезли в CLIENT_OUTBOX_BYTES */
+
+    /* автопереподключение (таймер поллера) */
+    int        want;        /* связь нужна: был connect, не было disconnect */
+    uint32_t   backoff_ms;  /* следующая задержка (до джиттера); 0 — с минимума */
+    uint32_t   rng;
+    int        ever_up;
+    uint64_t   reconnects;  /* рукопожатий после первого */
+
+    /* подписчик на смену health (Hub) */
+    ReplicatorChangeCb on_change;
+    void*      change_user;
+    Replicator* self;
 } CliImpl;
 
 /* ===== локальная доставка подтверждений ===== */
@@ -69,51 +119,141 @@ static void fanout_local(CliImpl* r, const ConOp* op){
     }
 }
 
-/* ===== util ===== */
-static void free_op_payloads(ConOp* o){
-    if (!o) return;
-    /* мы буферизуем/копируем только data/init; tag — на стеке/константа */
-    if (o->data){ free((void*)o->data); o->data=NULL; o->size=0; }
-    if (o->init_blob){ free((void*)o->init_blob); o->init_blob=NULL; o->init_size=0; }
+/* ===== outbox ===== */
+static void out_ent_free(OutEnt* e){
+    free((void*)e->op.tag); free((void*)e->op.data); free((void*)e->op.init_blob);
+    memset(e, 0, sizeof(*e));
 }
 static void queue_op(CliImpl* c, const ConOp* op){
-    if (c->qn >= CLIENT_MAX_BUFFERED) return;
-    ConOp t = *op;
-    if (op->data && op->size){ void* d=malloc(op->size); if(d){ memcpy(d,op->data,op->size); t.data=d; t.size=op->size; } }
-    if (op->init_blob && op->init_size){
-        void* i=malloc(op->init_size);
-        if(i){ memcpy(i,op->init_blob,op->init_size); t.init_blob=i; t.init_size=op->init_size; }
+    size_t tlen = (op->tag && *op->tag) ? strlen(op->tag) + 1 : 0;
+    size_t bytes = sizeof(OutEnt) + tlen + op->size + op->init_size;
+    /* переполнение — отбрасываем новые: уже принятый префикс уйдёт целым и по порядку */
+    if (c->obbytes + bytes > CLIENT_OUTBOX_BYTES){ c->ob_dropped++; return; }
+    if (c->obh && c->obh + c->obn == c->obcap && c->obh * 2 >= c->obcap){
+        memmove(c->ob, c->ob + c->obh, c->obn * sizeof(OutEnt));
+        c->obh = 0;
     }
-    c->q[c->qn++] = t;
+    if (c->obh + c->obn == c->obcap){
+        size_t n = c->obcap ? c->obcap * 2 : 64;
+        OutEnt* nb = (OutEnt*)realloc(c->ob, n * sizeof(OutEnt));
+        if (!nb){ c->ob_dropped++; return; }
+        c->ob = nb; c->obcap = n;
+    }
+    OutEnt* e = &c->ob[c->obh + c->obn];
+    memset(e, 0, sizeof(*e));
+    e->op = *op;
+    e->op.tag = NULL; e->op.data = NULL; e->op.init_blob = NULL;
+    if ((tlen && !(e->op.tag = (char*)malloc(tlen))) ||
+        (op->data && op->size && !(e->op.data = malloc(op->size))) ||
+        (op->init_blob && op->init_size && !(e->op.init_blob = malloc(op->init_size))))
+    {
+        out_ent_free(e);
+        c->ob_dropped++;
+        return;
+    }
+    if (tlen) memcpy((char*)e->op.tag, op->tag, tlen);
+    if (e->op.data) memcpy((void*)e->op.data, op->data, op->size);
+    if (e->op.init_blob) memcpy((void*)e->op.init_blob, op->init_blob, op->init_size);
+    e->bytes = bytes;
+    c->obn++; c->obbytes += bytes;
 }
+/* Убрать i-ю запись outbox; голова уходит сдвигом obh, без memmove */
+static void ob_remove(CliImpl* c, size_t i){
+    OutEnt* ob = c->ob + c->obh;
+    c->obbytes -= ob[i].bytes;
+    out_ent_free(&ob[i]);
+    if (i == 0) c->obh++;
+    else memmove(ob + i, ob + i + 1, (c->obn - i - 1) * sizeof(OutEnt));
+    if (--c->obn == 0) c->obh = 0;
+    if (i < c->obsent) c->obsent--;
+}
+/* Сдать в Cow1Tcp ещё не отправленный хвост outbox; остановимся, если очередь
+   снова переполнится — остаток уйдёт по on_pressure(0). Отправленные op без
+   op_id эха не опознать — их не держим. До head из WLCM не шлём ничего: в дозакачке
+   может прийти эхо op, которые лидер получил ещё до обрыва. */
 static void flush_queue(CliImpl* c){
-    if (!c || !c->cow) return;
-    for (int i=0;i<c->qn;i++){
-        cow1tcp_send(c->cow, &c->q[i]);
-        free_op_payloads(&c->q[i]);
+    if (!c || !c->cow || c->hold) return;
+    while (c->obsent < c->obn){
+        const ConOp* op = &c->ob[c->obh + c->obsent].op;
+        if (cow1tcp_send(c->cow, op) == 1) break;
+        if (op->op_id) c->obsent++;
+        else ob_remove(c, c->obsent);
     }
-    c->qn = 0;
+}
+/* Лидер вернул op: если она наша — подтверждена, из outbox долой. Эхо идёт в
+   порядке отправки, так что совпадение почти всегда первое. */
+static void ob_confirm(CliImpl* c, uint64_t op_id){
+    if (!op_id) return;
+    for (size_t i=0;i<c->obn;i++) if (c->ob[c->obh + i].op.op_id == op_id){ ob_remove(c, i); return; }
+}
+
+/* Очередь к лидеру стекла до low — досылаем outbox */
+static void on_server_pressure(void* user, int over){
+    CliImpl* c = (CliImpl*)user;
+    if (c && !over) flush_queue(c);
 }
 
 /* ===== события net poller ===== */
 static void cli_to_idle(CliImpl* c){
     if (!c) return;
+    int was_up = c->st == ST_STREAM;
     if (c->cow){ cow1tcp_destroy(c->cow); c->cow=NULL; }
     if ((intptr_t)c->fd >= 0){ net_poller_del(c->np, c->fd); tcp_close((tcp_fd_t)c->fd); }
     c->fd = (net_fd_t)(intptr_t)-1;
     c->st = ST_IDLE;
     c->out_off = c->out_len = 0;
     c->in_got = 0;
+    c->obsent = 0; /* без эха — после WLCM уйдут заново */
+    c->hold = 0;
+    if (was_up && c->on_change) c->on_change(c->change_user, c->self);
 }
 
+static int  cli_start(CliImpl* c);
+static void on_retry(void* user, uint32_t now_ms);
+
+/* Следующая попытка через backoff с джиттером: после рестарта лидера клиенты не ломятся разом */
+static void cli_schedule(CliImpl* c){
+    if (!c->want) return;
+    uint32_t d = c->backoff_ms ? c->backoff_ms : CLIENT_RECONNECT_MIN_MS;
+    c->backoff_ms = (d >= CLIENT_RECONNECT_MAX_MS / 2) ? CLIENT_RECONNECT_MAX_MS : d * 2;
+    c->rng ^= c->rng << 13; c->rng ^= c->rng >> 17; c->rng ^= c->rng << 5; /* xorshift32 */
+    uint32_t delay = d / 2 + c->rng % (d / 2 + 1);
+    net_poller_timer_set(c->np, net_poller_now(c->np) + delay, on_retry, c);
+}
+/* Связь потеряна не по команде — в IDLE и переподключаться */
+static void cli_drop(CliImpl* c){
+    cli_to_idle(c);
+    cli_schedule(c);
+}
+static void on_retry(void* user, uint32_t now_ms){
+    (void)now_ms;
+    CliImpl* c = (CliImpl*)user; if (!c) return;
+    if (!c->want || c->st != ST_IDLE) return;
+    if (cli_start(c) != 0) cli_schedule(c);
+}
+static void on_server_close(void* user){ cli_drop((CliImpl*)user); }
+
 static void on_op_from_server(void* user,
                               const ConOp* inop,
                               const char* tag,
                               const void* data, size_t dlen,
                               const void* init, size_t ilen)
 {
-    (void)tag;
     CliImpl* c = (CliImpl*)user; if (!c || !inop) return;
+    int seq_only = 0;
+    if (inop->op_id == 0 && tag && strcmp(tag, LEADER_SNAP_TAG) == 0 && data && dlen == 8){
+        const uint8_t* s = (const uint8_t*)data;
+        uint64_t seq = 0;
+        for (int k = 7; k >= 0; k--) seq = (seq << 8) | s[k];
+        c->seq = seq;
+        seq_only = !init || !ilen;
+    } else {
+        c->seq++;
+        ob_confirm(c, inop->op_id);
+    }
+    /* дозакачка дошла до head: всё, что осталось в outbox, лидер не видел */
+    if (c->hold && c->seq >= c->hold){ c->hold = 0; flush_queue(c); }
+    if (seq_only) return; /* только перенос seq */
     /* скопировать payload’ы — dec освобождает свои */
     ConOp op = *inop;
     void* d=NULL; void* i=NULL;
@@ -123,30 +263,39 @@ static void on_op_from_server(void* user,
     free(d); free(i);
 }
 
+static void on_hs_cb(void* user, net_fd_t fd, int ev);
+
+/* HELO v2: с какого места продолжать поток */
+static void hs_prepare(CliImpl* c){
+    ResumePkt hp;
+    hp.h.magic=HS_MAGIC_HELO; hp.h.ver=HS_VER_HEAD; hp.h.wire=CONOP_WIRE_VERSION_MAX; hp.h.console_id=c->console_id;
+    hp.epoch = c->epoch; hp.seq = c->seq;
+    memcpy(c->out_buf, &hp, sizeof(hp));
+    c->out_off=0; c->out_len=sizeof(hp);
+    c->st = ST_HELO_WR;
+}
+
 static void on_connect_cb(void* user, net_fd_t fd, int ev){
     CliImpl* c = (CliImpl*)user; if (!c) return;
     if (!(ev & (NET_WR|NET_ERR))) return;
-    if (net_connect_finished(fd) != NET_OK){ cli_to_idle(c); return; }
+    if (net_connect_finished(fd) != NET_OK){ cli_drop(c); return; }
     /* готово — сформировать HELO и переход в HELO_WR */
-    uint8_t out[sizeof(HelloPkt)];
-    HelloPkt hp; hp.magic=HS_MAGIC_HELO; hp.ver=HS_VER; hp._rsv=0; hp.console_id=c->console_id;
-    memcpy(out, &hp, sizeof(hp));
-    memcpy(c->out_buf, out, sizeof(out));
-    c->out_off=0; c->out_len=sizeof(out);
-    c->st = ST_HELO_WR;
-    net_poller_mod(c->np, fd, NET_WR|NET_ERR);
+    hs_prepare(c);
+    /* дальше fd ведёт on_hs_cb */
+    net_poller_del(c->np, fd);
+    net_poller_add(c->np, fd, NET_WR|NET_ERR, on_hs_cb, c);
 }
 
 static void on_hs_cb(void* user, net_fd_t fd, int ev){
     CliImpl* c = (CliImpl*)user; if (!c) return;
-    if (ev & NET_ERR){ cli_to_idle(c); return; }
+    if (ev & NET_ERR){ cli_drop(c); return; }
     if (c->st == ST_HELO_WR && (ev & NET_WR)){
         size_t left = c->out_len - c->out_off;
         if (left){
             size_t wrote = 0;
             int rc = tcp_write_all((tcp_fd_t)fd, c->out_buf + c->out_off, left, &wrote);
             c->out_off += wrote;
-            if (rc < 0){ cli_to_idle(c); return; }
+            if (rc < 0){ cli_drop(c); return; }
         }
         if (c->out_off >= c->out_len){
             c->st = ST_WLCM_RD;
@@ -155,24 +304,48 @@ static void on_hs_cb(void* user, net_fd_t fd, int ev){
         }
     }
     if (c->st == ST_WLCM_RD && (ev & NET_RD)){
-        /* дочитать Welcome */
-        while (c->in_got < sizeof(WelcomePkt)){
-            tcp_iovec v = { c->in_buf + c->in_got, sizeof(WelcomePkt) - c->in_got };
+        /* дочитать Welcome (v2, v3 длиннее; длина известна после поля ver) */
+        size_t want = sizeof(WelcomePkt);
+        for (;;){
+            if (c->in_got >= sizeof(WelcomePkt)){
+                uint16_t v = ((const WelcomePkt*)c->in_buf)->ver;
+                if (v == HS_VER_RESUME) want = sizeof(ResumePkt);
+                else if (v == HS_VER_HEAD) want = sizeof(ResumeHeadPkt);
+            }
+            if (c->in_got >= want) break;
+            tcp_iovec v = { c->in_buf + c->in_got, want - c->in_got };
             long rc = tcp_readv((tcp_fd_t)fd, &v, 1);
             if (rc > 0){ c->in_got += (size_t)rc; }
-            else if (rc == 0){ cli_to_idle(c); return; }
-            else { int err = net_last_error(); if (!net_err_would_block(err)){ cli_to_idle(c); } break; }
+            else if (rc == 0){ cli_drop(c); return; }
+            else { int err = net_last_error(); if (!net_err_would_block(err)){ cli_drop(c); } break; }
         }
-        if (c->in_got >= sizeof(WelcomePkt)){
+        if (c->in_got >= want){
             const WelcomePkt* wp = (const WelcomePkt*)c->in_buf;
-            if (wp->magic != HS_MAGIC_WLCM || wp->ver != HS_VER || wp->console_id != c->console_id){
-                cli_to_idle(c); return;
+            if (wp->magic != HS_MAGIC_WLCM || wp->ver < HS_VER || wp->ver > HS_VER_HEAD || wp->console_id != c->console_id){
+                cli_drop(c); return;
+            }
+            if (wp->ver >= HS_VER_RESUME){
+                const ResumePkt* rp = (const ResumePkt*)c->in_buf;
+                c->epoch = rp->epoch; c->seq = rp->seq;
+            }
+            /* старый лидер head не шлёт — досылаем сразу, как раньше */
+            if (wp->ver == HS_VER_HEAD){
+                const ResumeHeadPkt* hp = (const ResumeHeadPkt*)c->in_buf;
+                if (hp->head > c->seq) c->hold = hp->head;
             }
             /* перейти в STREAM (Cow1) */
             c->st = ST_STREAM;
             c->cow = cow1tcp_create(c->np, fd, on_op_from_server, c);
-            /* flush буфер */
+            if (wp->wire > CONOP_WIRE_VERSION) cow1tcp_set_wire_version(c->cow, wp->wire);
+            cow1tcp_set_on_close(c->cow, on_server_close);
+            cow1tcp_set_on_pressure(c->cow, on_server_pressure);
+            c->backoff_ms = 0;
+            if (c->ever_up) c->reconnects++;
+            c->ever_up = 1;
+            /* неподтверждённый хвост outbox — заново, затем то, что копилось без связи
+               (при hold — когда дозакачка дойдёт до head) */
             flush_queue(c);
+            if (c->on_change) c->on_change(c->change_user, c->self);
         }
     }
 }
@@ -182,8 +355,11 @@ static void cli_destroy(Replicator* rr){
     if (!rr) return;
     CliImpl* c = (CliImpl*)rr->impl;
     if (c){
+        net_poller_timer_cancel(c->np, on_retry, c);
+        c->on_change = NULL;
         cli_to_idle(c);
-        for (int i=0;i<c->qn;i++) free_op_payloads(&c->q[i]);
+        for (size_t i=0;i<c->obn;i++) out_ent_free(&c->ob[c->obh + i]);
+        free(c->ob);
         free(c);
     }
     free(rr);
@@ -192,11 +368,12 @@ static void cli_destroy(Replicator* rr){
 static void cli_publish(Replicator* rr, const ConOp* op){
     if (!rr || !op) return;
     CliImpl* c = (CliImpl*)rr->impl;
-    if (c->st == ST_STREAM && c->cow){
-        cow1tcp_send(c->cow, op);
-    } else {
-        queue_op(c, op);
-    }
+    /* op, которую не закодировать, лидеру не уйдёт и эха не получит */
+    if (!conop_wire_encoded_size(op)) return;
+    /* копия живёт в outbox до эха: при обрыве op уйдёт снова после WLCM */
+    size_t n = c->obn;
+    queue_op(c, op);
+    if (c->obn != n && c->st == ST_STREAM) flush_queue(c);
 }
 
 static void cli_set_listener(Replicator* rr, TopicId topic, ReplicatorConfirmCb cb, void* user){
@@ -224,6 +401,12 @@ static int cli_health(Replicator* rr){
     return (c && c->st==ST_STREAM && c->cow) ? 0 : -1;
 }
 
+static void cli_set_on_change(Replicator* rr, ReplicatorChangeCb cb, void* user){
+    if (!rr) return;
+    CliImpl* c = (CliImpl*)rr->impl; if (!c) return;
+    c->on_change = cb; c->change_user = user;
+}
+
 static const ReplicatorVt CLI_VT = {
     .destroy      = cli_destroy,
     .publish      = cli_publish,
@@ -231,6 +414,7 @@ static const ReplicatorVt CLI_VT = {
     .unset_listener = cli_unset_listener,
     .capabilities = cli_caps,
     .health       = cli_health,
+    .set_on_change = cli_set_on_change,
 };
 
 /* ===== Публичные фабрики/API ===== */
@@ -243,37 +427,28 @@ Replicator* replicator_create_client_tcp(NetPoller* np, uint64_t console_id,
     impl->console_id = console_id;
     impl->st = ST_IDLE;
     impl->fd = (net_fd_t)(intptr_t)-1;
-    impl->ln = 0; impl->qn = 0;
+    impl->ln = 0;
+    impl->rng = (uint32_t)(((uintptr_t)impl >> 4) ^ (uintptr_t)time(NULL) ^ console_id) * 2654435761u | 1u;
     impl->host[0] = 0; impl->port = 0;
     if (host && *host){ strncpy(impl->host, host, sizeof(impl->host)-1); impl->port = port; }
 
     Replicator* r = (Replicator*)calloc(1, sizeof(*r));
     if (!r){ free(impl); return NULL; }
     r->v = &CLI_VT; r->impl = impl;
+    impl->self = r;
     /* если хост задан — сразу инициировать подключение */
     if (host && *host) repl_client_tcp_connect(r, host, port);
     return r;
 }
 
-int repl_client_tcp_connect(Replicator* rr, const char* host, uint16_t port){
-    if (!rr) return -1;
-    CliImpl* c = (CliImpl*)rr->impl; if (!c || !c->np) return -1;
-    if (!host || !*host || !port) return -1;
-    /* сбросить текущее состояние и стартовать новый connect */
-    cli_to_idle(c);
-    strncpy(c->host, host, sizeof(c->host)-1);
-    c->port = port;
+/* Новый connect к c->host:c->port из IDLE; -1 — не удалось даже начать */
+static int cli_start(CliImpl* c){
     tcp_fd_t sfd = (tcp_fd_t)TCP_INVALID_FD;
     int rc = tcp_connect(c->host, c->port, /*set_nb=*/1, &sfd);
     if (rc == NET_OK){
         /* сразу пишем HELO */
         c->fd = (net_fd_t)sfd;
-        uint8_t out[sizeof(HelloPkt)];
-        HelloPkt hp; hp.magic=HS_MAGIC_HELO; hp.ver=HS_VER; hp._rsv=0; hp.console_id=c->console_id;
-        memcpy(out, &hp, sizeof(hp));
-        memcpy(c->out_buf, out, sizeof(out));
-        c->out_off=0; c->out_len=sizeof(out);
-        c->st = ST_HELO_WR;
+        hs_prepare(c);
         net_poller_add(c->np, c->fd, NET_WR|NET_ERR, on_hs_cb, c);
         return 0;
     } else if (rc == NET_INPROGRESS){
@@ -281,18 +456,52 @@ int repl_client_tcp_connect(Replicator* rr, const char* host, uint16_t port){
         c->st = ST_CONNECTING;
         net_poller_add(c->np, c->fd, NET_WR|NET_ERR, on_connect_cb, c);
         return 0;
-    } else {
-        return -1;
     }
+    return -1;
+}
+
+int repl_client_tcp_connect(Replicator* rr, const char* host, uint16_t port){
+    if (!rr) return -1;
+    CliImpl* c = (CliImpl*)rr->impl; if (!c || !c->np) return -1;
+    if (!host || !*host || !port) return -1;
+    /* сбросить текущее состояние и стартовать новый connect */
+    cli_to_idle(c);
+    strncpy(c->host, host, sizeof(c->host)-1);
+    c->port = port;
+    c->want = 1;
+    c->backoff_ms = 0;
+    net_poller_timer_cancel(c->np, on_retry, c);
+    if (cli_start(c) == 0) return 0;
+    cli_schedule(c); /* адрес мог ещё не резолвиться — пробуем дальше */
+    return -1;
 }
 
 void repl_client_tcp_disconnect(Replicator* rr){
     if (!rr) return;
     CliImpl* c = (CliImpl*)rr->impl;
     if (!c) return;
+    c->want = 0;
+    net_poller_timer_cancel(c->np, on_retry, c);
     cli_to_idle(c);
 }
 
+uint64_t repl_client_tcp_last_seq(Replicator* rr){
+    if (!rr) return 0;
+    CliImpl* c = (CliImpl*)rr->impl;
+    return c ? c->seq : 0;
+}
+
+int repl_client_tcp_stat(Replicator* rr, int* out_outbox_ops, size_t* out_outbox_bytes,
+                         uint64_t* out_dropped, uint64_t* out_reconnects){
+    if (!rr) return -1;
+    CliImpl* c = (CliImpl*)rr->impl; if (!c) return -1;
+    if (out_outbox_ops)   *out_outbox_ops   = (int)c->obn;
+    if (out_outbox_bytes) *out_outbox_bytes = c->obbytes;
+    if (out_dropped)      *out_dropped      = c->ob_dropped;
+    if (out_reconnects)   *out_reconnects   = c->reconnects;
+    return 0;
+}
+
 int repl_client_tcp_is_connected(Replicator* rr){
     if (!rr) return 0;
     CliImpl* c = (CliImpl*)rr->impl;
@@ -14,7 +14,17 @@ extern "C" {
      * - неблокирующий connect к host:port, HELO/WLCM (протокол как у leader_tcp);
      * - после рукопожатия — поток COW1 (ConOp);
      * - локальная доставка confirm’ов слушателям;
-     * - небольшой буфер publish до установления соединения.
+     * - outbox: каждый publish копируется (до CLIENT_OUTBOX_BYTES) и живёт там,
+     *   пока лидер не вернёт его эхом (сверка по op_id); WLCM v3 сообщает head
+     *   лидера, и неподтверждённый хвост уходит заново по порядку, лишь когда
+     *   дозакачка дошла до head: эхо op, полученных лидером до обрыва, к этому
+     *   моменту уже сняло их из outbox. Если вместо журнала пришёл снапшот, эха
+     *   по отдельности нет — покрытые им op лидер получит ещё раз;
+     * - после connect держит связь сам: обрыв → переподключение с экспоненциальной
+     *   задержкой и джиттером по часам поллера, пока не будет disconnect;
+     * - помнит эпоху лидера и последний полученный seq: при повторном connect
+     *   лидер досылает пропущенное (или снапшот, если разрыв ему уже не покрыть).
+     *   HELO v2/v3 понимает только лидер с журналом (leader_tcp.c).
      *
      * capabilities(): REPL_ORDERED | REPL_RELIABLE
      * health(): 0 если подключён, иначе !=0
@@ -27,12 +37,23 @@ extern "C" {
     { (void)r; (void)host; (void)port; return -1; }
     static inline void repl_client_tcp_disconnect(Replicator* r){ (void)r; }
     static inline int  repl_client_tcp_is_connected(Replicator* r){ (void)r; return 0; }
+    static inline uint64_t repl_client_tcp_last_seq(Replicator* r){ (void)r; return 0; }
+    static inline int  repl_client_tcp_stat(Replicator* r, int* out_outbox_ops, size_t* out_outbox_bytes,
+                                            uint64_t* out_dropped, uint64_t* out_reconnects){
+        (void)r; if(out_outbox_ops)*out_outbox_ops=0; if(out_outbox_bytes)*out_outbox_bytes=0;
+        if(out_dropped)*out_dropped=0; if(out_reconnects)*out_reconnects=0; return -1;
+    }
 #else
     Replicator* replicator_create_client_tcp(NetPoller* np, uint64_t console_id,
                                              const char* host /* может быть NULL */, uint16_t port);
     int  repl_client_tcp_connect(Replicator* r, const char* host, uint16_t port);
     void repl_client_tcp_disconnect(Replicator* r);
     int  repl_client_tcp_is_connected(Replicator* r);
+    /* seq последней полученной от лидера op (0 — ещё ничего) */
+    uint64_t repl_client_tcp_last_seq(Replicator* r);
+    /* outbox (op без эха, байт, отброшено по переполнению) и число переподключений */
+    int  repl_client_tcp_stat(Replicator* r, int* out_outbox_ops, size_t* out_outbox_bytes,
+                              uint64_t* out_dropped, uint64_t* out_reconnects);
 #endif
 
 #ifdef __cplusplus
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 #ifndef __EMSCRIPTEN__
 
@@ -22,8 +23,28 @@
 #ifndef CRDT_MAX_TOPICS
 #  define CRDT_MAX_TOPICS 64
 #endif
-#ifndef CRDT_DEDUP_CAP
-#  define CRDT_DEDUP_CAP 8192 /* пар (console_id,op_id) */
+/* Окно внеочередных op над непрерывной отметкой актора, бит (кратно 64) */
+#ifndef CRDT_VV_WINDOW
+#  define CRDT_VV_WINDOW 256
+#endif
+/* Начальная ёмкость таблицы акторов (степень двойки) */
+#ifndef CRDT_VV_INIT_CAP
+#  define CRDT_VV_INIT_CAP 64
+#endif
+/* Журнал последних op для anti-entropy: не больше стольких op и байт payload'ов */
+#ifndef CRDT_LOG_OPS
+#  define CRDT_LOG_OPS 4096
+#endif
+#ifndef CRDT_LOG_BYTES
+#  define CRDT_LOG_BYTES (4u * 1024u * 1024u)
+#endif
+/* Служебный кадр anti-entropy: op_id=0, data = вектор версий топика */
+#define CRDT_AE_TAG "ae.vv"
+/* Просьба прислать свои векторы версий: пир отставал (очередь к нему была выше
+   high watermark, op ему не слали) — по ответу дошлём журналом/снапшотом */
+#define CRDT_AE_REQ_TAG "ae.req"
+#ifndef CRDT_AE_MAX_ACTORS
+#  define CRDT_AE_MAX_ACTORS 4096
 #endif
 
 typedef struct Listener {
@@ -36,20 +57,38 @@ typedef struct Listener {
 typedef struct TopicRec {
     TopicId t;
     int have;
+    /* Откуда ведётся история топика: совпадает у узлов, которые уже обменялись
+       снапшотом. Разная база — журналам друг друга верить нельзя. */
+    uint64_t base;
 } TopicRec;
 
 
 typedef struct Peer {
     net_fd_t  fd;
     Cow1Tcp*  cow;
-    int       alive;
+    int       dead;     /* соединение закрыто: из списка уберёт mesh_reap вне колбэков Cow1Tcp */
+    int       lagging;  /* очередь выше high watermark: op не шлём, догоним по ae.req */
     struct CrdtMesh* owner;
 } Peer;
 
-typedef struct DedupEnt {
+/* Вектор версий: на каждого (console_id, actor_id) — непрерывная отметка hi
+   (все seq ≤ hi уже видели) и битовое окно над ней для пришедших не по порядку. */
+typedef struct VvEnt {
     uint64_t console_id;
-    uint64_t op_id;
-} DedupEnt;
+    uint32_t actor_id;
+    uint32_t used;
+    uint64_t hi;
+    uint64_t win[CRDT_VV_WINDOW / 64]; /* бит i — seq hi+1+i */
+    uint64_t evicted; /* seq ≤ evicted в журнале уже нет (вытеснены или пришли снапшотом) */
+    uint64_t asked;   /* hi+1 на момент последней просьбы дослать дыру (0 — не просили) */
+} VvEnt;
+
+/* Запись журнала: своя копия op вместе с tag/data/init */
+typedef struct LogEnt {
+    ConOp    op;
+    uint64_t seq;
+    size_t   bytes;
+} LogEnt;
 
 
 typedef struct CrdtMesh {
@@ -58,11 +97,21 @@ typedef struct CrdtMesh {
     uint16_t   port;      /* порт mesh (для seed add) */
     Listener  ls[CRDT_MAX_LISTENERS]; int ln;
     TopicRec  topics[CRDT_MAX_TOPICS]; int tn;
-    Peer      peers[CRDT_MAX_PEERS];   int pn;
-    /* Простая хеш-таблица для дедупликации операций. */
-    DedupEnt*  dedup;
-    size_t     dcap;
-    size_t     dcount;
+    Peer*     peers[CRDT_MAX_PEERS];   int pn;
+    /* Дедуп: вектор версий, память O(акторов) */
+    VvEnt*     vv;
+    size_t     vcap;      /* степень двойки */
+    size_t     vcount;
+    uint64_t   vv_far;    /* op пиров дальше окна: не доставлены, ждут дозакачки */
+    /* Журнал op (кольцо) для дозакачки пирам по их вектору версий */
+    LogEnt*    log;
+    size_t     lhead, llen, lbytes;
+    uint64_t   ae_delta_ops, ae_snapshots; /* сколько op дослали журналом / сколько снапшотов */
+    uint64_t   lagged;    /* сколько раз пир уходил в отставание */
+    /* подписчик на смену health (Hub) */
+    ReplicatorChangeCb on_change;
+    void*      change_user;
+    Replicator* self;
 } CrdtMesh;
 
 /* ============ малые утилиты ============ */
@@ -82,99 +131,369 @@ static int topic_have(CrdtMesh* r, TopicId t){
     return 0;
 }
 
-/* ===== Дедуп по (console_id, op_id) — открытая адресация ===== */
+/* ===== Дедуп: вектор версий по (console_id, actor_id) ===== */
 static uint64_t mix64(uint64_t x){ /* xorshift* */
     x ^= x>>30; x *= 0xbf58476d1ce4e5b9ULL;
     x ^= x>>27; x *= 0x94d049bb133111ebULL;
     x ^= x>>31; return x;
 }
-static size_t d_hash(uint64_t a, uint64_t b, size_t cap){
-    return (size_t)(mix64(a*0x9E3779B185EBCA87ULL ^ b) % (uint64_t)cap);
+static size_t vv_hash(uint64_t console_id, uint32_t actor_id, size_t mask){
+    return (size_t)(mix64(console_id*0x9E3779B185EBCA87ULL ^ actor_id) & (uint64_t)mask);
+}
+/* Номер операции у актора: console_sink кладёт в op_id (actor<<32 | счётчик) */
+static uint64_t vv_seq(const ConOp* op){
+    return ((op->op_id >> 32) == op->actor_id) ? (op->op_id & 0xFFFFFFFFull) : op->op_id;
 }
-static int d_probe_find(CrdtMesh* r, uint64_t console_id, uint64_t op_id, size_t* out_idx){
-    if (!r->dedup || r->dcap==0){ if(out_idx)*out_idx=0; return 0; }
-    size_t i = d_hash(console_id, op_id, r->dcap);
-    for (size_t step=0; step<r->dcap; ++step){
-        size_t k = (i + step) % r->dcap;
-        DedupEnt* e = &r->dedup[k];
-        if (e->console_id==0 && e->op_id==0){ if(out_idx)*out_idx=k; return 0; } /* empty */
-        if (e->console_id==console_id && e->op_id==op_id){ if(out_idx)*out_idx=k; return 1; } /* found */
+static VvEnt* vv_slot(VvEnt* tab, size_t cap, uint64_t console_id, uint32_t actor_id){
+    size_t m = cap - 1;
+    for (size_t i = vv_hash(console_id, actor_id, m);; i = (i + 1) & m){
+        VvEnt* e = &tab[i];
+        if (!e->used || (e->console_id==console_id && e->actor_id==actor_id)) return e;
     }
-    if (out_idx)*out_idx=0;
-    return 0;
 }
-static int d_grow(CrdtMesh* r, size_t ncap){
-    DedupEnt* nb = (DedupEnt*)calloc(ncap, sizeof(DedupEnt));
-    if (!nb) return 0;
-    DedupEnt* ob = r->dedup; size_t oc = r->dcap;
-    r->dedup = nb; r->dcap = ncap; r->dcount = 0;
-    if (ob){
-        for (size_t i=0;i<oc;i++){
-            if (ob[i].console_id||ob[i].op_id){
-                size_t idx=0; /* никогда не занят */
-                /* reinsert */
-                size_t h = d_hash(ob[i].console_id, ob[i].op_id, r->dcap);
-                for (size_t st=0;st<r->dcap;st++){
-                    size_t k=(h+st)%r->dcap;
-                    if (r->dedup[k].console_id==0 && r->dedup[k].op_id==0){ idx=k; break; }
-                }
-                r->dedup[idx] = ob[i];
-                r->dcount++;
-            }
-        }
-        free(ob);
+static int vv_grow(CrdtMesh* r){
+    size_t ncap = r->vcap ? r->vcap*2 : CRDT_VV_INIT_CAP;
+    VvEnt* nt = (VvEnt*)calloc(ncap, sizeof(VvEnt));
+    if (!nt) return 0;
+    for (size_t i=0;i<r->vcap;i++){
+        if (r->vv[i].used) *vv_slot(nt, ncap, r->vv[i].console_id, r->vv[i].actor_id) = r->vv[i];
     }
+    free(r->vv);
+    r->vv = nt; r->vcap = ncap;
     return 1;
 }
-static int d_insert(CrdtMesh* r, uint64_t console_id, uint64_t op_id){
-    if (!r->dedup){ if(!d_grow(r, CRDT_DEDUP_CAP)) return 0; }
-    if (r->dcount*2 >= r->dcap){ if(!d_grow(r, r->dcap ? r->dcap*2 : CRDT_DEDUP_CAP)) return 0; }
-    size_t idx=0;
-    if (d_probe_find(r, console_id, op_id, &idx)) return 1; /* уже есть */
-    r->dedup[idx].console_id = console_id;
-    r->dedup[idx].op_id      = op_id;
-    r->dcount++;
-    return 1;
+/* Сдвинуть окно на n seq вверх (hi += n). Вызывающий отвечает за то, что все
+   seq до нового hi действительно есть: увидены или покрыты снапшотом. */
+static void vv_shift(VvEnt* e, uint64_t n){
+    enum { W = CRDT_VV_WINDOW / 64 };
+    if (n >= CRDT_VV_WINDOW){
+        memset(e->win, 0, sizeof(e->win));
+    } else {
+        int ws = (int)(n / 64), bs = (int)(n % 64);
+        for (int i=0;i<W;i++){
+            uint64_t lo = (i+ws   < W) ? e->win[i+ws]   : 0;
+            uint64_t hi = (i+ws+1 < W) ? e->win[i+ws+1] : 0;
+            e->win[i] = bs ? (lo >> bs) | (hi << (64-bs)) : lo;
+        }
+    }
+    e->hi += n;
+}
+static VvEnt* vv_get(CrdtMesh* r, uint64_t console_id, uint32_t actor_id, int create){
+    if (!create && !r->vcap) return NULL;
+    if (create && (r->vcount + 1)*2 > r->vcap && !vv_grow(r)) return NULL;
+    VvEnt* e = vv_slot(r->vv, r->vcap, console_id, actor_id);
+    if (e->used) return e;
+    if (!create) return NULL;
+    memset(e, 0, sizeof(*e));
+    e->used = 1; e->console_id = console_id; e->actor_id = actor_id;
+    r->vcount++;
+    return e;
+}
+enum { VV_NEW = 0, VV_SEEN = 1, VV_FAR = 2 };
+/* VV_SEEN — операцию уже видели; VV_NEW — отмечена. O(1): один актор, одно окно.
+   Op пира дальше окна не отмечается (VV_FAR): hi нельзя двигать через seq, которых
+   не видели, — дыры потом не дослал бы никто. Свою op (local) принимаем всегда: её
+   предшественники ушли мимо mesh (другой бэкенд хаба), в журнале их нет — evicted
+   отправит пиров за снапшотом. */
+static int vv_test_and_mark(CrdtMesh* r, const ConOp* op, int local){
+    uint64_t seq = vv_seq(op);
+    if (seq == 0) return VV_NEW; /* без номера — не дедуплицируем */
+    VvEnt* e = vv_get(r, op->console_id, op->actor_id, 1);
+    if (!e) return VV_NEW;
+    if (seq <= e->hi) return VV_SEEN;
+    uint64_t d = seq - e->hi - 1;
+    if (d >= CRDT_VV_WINDOW){
+        if (!local){ r->vv_far++; return VV_FAR; }
+        vv_shift(e, d - CRDT_VV_WINDOW + 1);
+        if (e->hi > e->evicted) e->evicted = e->hi;
+        d = CRDT_VV_WINDOW - 1;
+    }
+    uint64_t bit = 1ull << (d % 64);
+    if (e->win[d/64] & bit) return VV_SEEN;
+    e->win[d/64] |= bit;
+    /* подтянуть непрерывную отметку */
+    while (e->win[0] & 1u){
+        uint64_t run = (~e->win[0]) ? 0 : 64;
+        if (!run) while ((e->win[0] >> run) & 1u) run++;
+        vv_shift(e, run);
+    }
+    return VV_NEW;
+}
+
+/* ===== Журнал op ===== */
+static void log_ent_free(LogEnt* e){
+    free((void*)e->op.tag); free((void*)e->op.data); free((void*)e->op.init_blob);
+    memset(e, 0, sizeof(*e));
+}
+static void log_evict(CrdtMesh* r){
+    LogEnt* e = &r->log[r->lhead];
+    VvEnt* v = vv_get(r, e->op.console_id, e->op.actor_id, 0);
+    if (v && e->seq > v->evicted) v->evicted = e->seq;
+    r->lbytes -= e->bytes;
+    log_ent_free(e);
+    r->lhead = (r->lhead + 1) % CRDT_LOG_OPS;
+    r->llen--;
+}
+static void log_append(CrdtMesh* r, const ConOp* op){
+    uint64_t seq = vv_seq(op);
+    if (!seq) return;
+    size_t tlen = op->tag ? strlen(op->tag) + 1 : 0;
+    size_t bytes = sizeof(LogEnt) + tlen + op->size + op->init_size;
+    if (bytes > CRDT_LOG_BYTES){
+        /* не влезает вовсе — дослать такую op сможет только снапшот */
+        VvEnt* v = vv_get(r, op->console_id, op->actor_id, 1);
+        if (v && seq > v->evicted) v->evicted = seq;
+        return;
+    }
+    if (!r->log && !(r->log = (LogEnt*)calloc(CRDT_LOG_OPS, sizeof(LogEnt)))) return;
+    while (r->llen && (r->llen == CRDT_LOG_OPS || r->lbytes + bytes > CRDT_LOG_BYTES)) log_evict(r);
+    LogEnt* e = &r->log[(r->lhead + r->llen) % CRDT_LOG_OPS];
+    e->op = *op;
+    e->op.tag = NULL; e->op.data = NULL; e->op.init_blob = NULL;
+    if (tlen && (e->op.tag = (char*)malloc(tlen)) != NULL) memcpy((char*)e->op.tag, op->tag, tlen);
+    if (op->data && op->size && (e->op.data = malloc(op->size)) != NULL) memcpy((void*)e->op.data, op->data, op->size);
+    if (op->init_blob && op->init_size && (e->op.init_blob = malloc(op->init_size)) != NULL) memcpy((void*)e->op.init_blob, op->init_blob, op->init_size);
+    e->seq = seq;
+    e->bytes = bytes;
+    r->llen++; r->lbytes += bytes;
+}
+
+/* ===== Anti-entropy: вектор версий топика =====
+   payload: u64 base | u32 n | n × (u32 actor, u64 hi), LE */
+static inline void wr32(uint8_t** p, uint32_t v){ (*p)[0]=(uint8_t)(v); (*p)[1]=(uint8_t)(v>>8); (*p)[2]=(uint8_t)(v>>16); (*p)[3]=(uint8_t)(v>>24); *p+=4; }
+static inline void wr64(uint8_t** p, uint64_t v){ wr32(p,(uint32_t)(v&0xFFFFFFFFull)); wr32(p,(uint32_t)(v>>32)); }
+static inline uint32_t rd32(const uint8_t** p){ const uint8_t* s=*p; *p+=4; return (uint32_t)s[0]|((uint32_t)s[1]<<8)|((uint32_t)s[2]<<16)|((uint32_t)s[3]<<24); }
+static inline uint64_t rd64(const uint8_t** p){ uint64_t lo=rd32(p), hi=rd32(p); return lo|(hi<<32); }
+
+typedef struct { uint32_t actor; uint64_t hi; } AeEnt;
+
+static TopicRec* topic_find(CrdtMesh* r, TopicId t){
+    for (int i=0;i<r->tn;i++) if (r->topics[i].have && topic_eq(r->topics[i].t, t)) return &r->topics[i];
+    return NULL;
+}
+
+/* Закодировать вектор версий топика (malloc; NULL — нет памяти) */
+static uint8_t* ae_encode(CrdtMesh* r, const TopicRec* tr, size_t* out_len){
+    size_t n = 0;
+    for (size_t i=0;i<r->vcap;i++) if (r->vv[i].used && r->vv[i].console_id==tr->t.inst_id) n++;
+    if (n > CRDT_AE_MAX_ACTORS) n = CRDT_AE_MAX_ACTORS;
+    uint8_t* buf = (uint8_t*)malloc(12 + n*12);
+    if (!buf) return NULL;
+    uint8_t* p = buf;
+    wr64(&p, tr->base); wr32(&p, (uint32_t)n);
+    size_t k = 0;
+    for (size_t i=0;i<r->vcap && k<n;i++){
+        const VvEnt* v = &r->vv[i];
+        if (!v->used || v->console_id!=tr->t.inst_id) continue;
+        wr32(&p, v->actor_id); wr64(&p, v->hi); k++;
+    }
+    *out_len = (size_t)(p - buf);
+    return buf;
 }
-static int d_seen(CrdtMesh* r, uint64_t console_id, uint64_t op_id){
-    size_t idx=0;
-    return d_probe_find(r, console_id, op_id, &idx);
+/* Разобрать payload; возвращает число акторов (≤ cap) или -1 */
+static int ae_decode(const void* data, size_t len, uint64_t* base, AeEnt* out, int cap){
+    if (!data || len < 12) return -1;
+    const uint8_t* p = (const uint8_t*)data;
+    *base = rd64(&p);
+    uint32_t n = rd32(&p);
+    if (n > (uint32_t)cap || len < 12 + (size_t)n*12) return -1;
+    for (uint32_t i=0;i<n;i++){ out[i].actor = rd32(&p); out[i].hi = rd64(&p); }
+    return (int)n;
+}
+static uint64_t ae_peer_hi(const AeEnt* pv, int n, uint32_t actor){
+    for (int i=0;i<n;i++) if (pv[i].actor == actor) return pv[i].hi;
+    return 0;
 }
 
-/* ===== Отправка снапшота всем пирами ===== */
-static void send_snapshot_to_peer(CrdtMesh* r, Peer* p, TopicId t){
+static void send_vv_to_peer(CrdtMesh* r, Peer* p, const TopicRec* tr){
+    if (!p || !p->cow) return;
+    size_t len = 0;
+    uint8_t* vv = ae_encode(r, tr, &len);
+    if (!vv) return;
+    ConOp op = (ConOp){0};
+    op.topic = tr->t;
+    op.console_id = tr->t.inst_id;
+    op.tag = CRDT_AE_TAG;
+    op.data = vv; op.size = len;
+    (void)cow1tcp_send(p->cow, &op);
+    free(vv);
+}
+
+/* Снапшот топика; в data едет вектор версий, который он покрывает */
+static void send_snapshot_to_peer(CrdtMesh* r, Peer* p, const TopicRec* tr){
     if (!r || !p || !p->cow) return;
     void* user=NULL;
-    const TypeVt* vt = type_registry_get_default(t.type_id, &user);
+    const TypeVt* vt = type_registry_get_default(tr->t.type_id, &user);
     if (!vt || !vt->snapshot) return;
     void* blob=NULL; size_t blen=0; uint32_t schema=0;
     if (vt->snapshot(user, &schema, &blob, &blen) == 0 && blob && blen>0){
+        size_t vlen = 0;
+        uint8_t* vv = ae_encode(r, tr, &vlen);
         ConOp sop = (ConOp){0};
-        sop.topic = t;
-        sop.console_id = t.inst_id;
+        sop.topic = tr->t;
+        sop.console_id = tr->t.inst_id;
         sop.schema = schema;        // <--- теперь несём версию
         sop.tag = "snapshot";
         sop.init_blob = blob; sop.init_size = blen;
+        if (vv){ sop.data = vv; sop.size = vlen; }
         (void)cow1tcp_send(p->cow, &sop);
+        r->ae_snapshots++;
+        free(vv);
         free(blob);
     }
 }
 
-static void send_snapshots_to_peer(CrdtMesh* r, Peer* p){
+/* Дослать пиру из журнала op топика, которых нет в его векторе версий */
+static void send_log_delta(CrdtMesh* r, Peer* p, const TopicRec* tr, const AeEnt* pv, int pn){
+    for (size_t k=0;k<r->llen;k++){
+        const LogEnt* e = &r->log[(r->lhead + k) % CRDT_LOG_OPS];
+        if (e->op.console_id != tr->t.inst_id) continue;
+        if (e->seq <= ae_peer_hi(pv, pn, e->op.actor_id)) continue;
+        if (cow1tcp_send(p->cow, &e->op) != 0) break; /* снова переполнен — остаток после ae.req */
+        r->ae_delta_ops++;
+    }
+}
+
+/* Пир прислал свой вектор версий: решаем, чем его догонять */
+static void ae_on_vv(CrdtMesh* r, Peer* from, const ConOp* op){
+    TopicRec* tr = topic_find(r, op->topic);
+    if (!tr || !from->cow) return;
+    static AeEnt pv[CRDT_AE_MAX_ACTORS];
+    uint64_t pbase = 0;
+    int pn = ae_decode(op->data, op->size, &pbase, pv, CRDT_AE_MAX_ACTORS);
+    if (pn < 0) return;
+
+    if (pbase == tr->base){
+        /* общая история: хватает журнала, если он не обрезан ниже того, что знает пир */
+        int ok = 1;
+        for (size_t i=0;i<r->vcap && ok;i++){
+            const VvEnt* v = &r->vv[i];
+            if (!v->used || v->console_id != tr->t.inst_id) continue;
+            uint64_t ph = ae_peer_hi(pv, pn, v->actor_id);
+            int ahead = v->hi > ph;
+            for (int w=0; w<CRDT_VV_WINDOW/64 && !ahead; w++) ahead = v->win[w] != 0;
+            if (ahead && ph < v->evicted) ok = 0;
+        }
+        if (ok) send_log_delta(r, from, tr, pv, pn);
+        else    send_snapshot_to_peer(r, from, tr);
+        return;
+    }
+    /* истории разные: снапшот шлёт тот, у кого больше op (при равенстве — меньшая база),
+       второй досылает журналом то, чего нет у первого, и примет его снапшот */
+    uint64_t mine = 0, theirs = 0;
+    for (size_t i=0;i<r->vcap;i++) if (r->vv[i].used && r->vv[i].console_id==tr->t.inst_id) mine += r->vv[i].hi;
+    for (int i=0;i<pn;i++) theirs += pv[i].hi;
+    if (mine > theirs || (mine == theirs && tr->base < pbase)) send_snapshot_to_peer(r, from, tr);
+    else send_log_delta(r, from, tr, pv, pn);
+}
+
+/* Применён снапшот от пира: принять его базу и вектор версий. Снапшот
+   вливается в состояние (уже применённые op остаются), так что свой журнал
+   заново не доставляем — иначе неидемпотентные op применились бы дважды. */
+static void ae_on_snapshot(CrdtMesh* r, const ConOp* op){
+    TopicRec* tr = topic_find(r, op->topic);
+    if (!tr) return;
+    static AeEnt sv[CRDT_AE_MAX_ACTORS];
+    uint64_t sbase = 0;
+    int sn = ae_decode(op->data, op->size, &sbase, sv, CRDT_AE_MAX_ACTORS);
+    if (sn < 0) return;
+    tr->base = sbase;
+    for (int i=0;i<sn;i++){
+        VvEnt* v = vv_get(r, tr->t.inst_id, sv[i].actor, 1);
+        if (!v) continue;
+        if (sv[i].hi > v->hi) vv_shift(v, sv[i].hi - v->hi);
+        if (sv[i].hi > v->evicted) v->evicted = sv[i].hi;
+    }
+}
+
+/* Новое соединение: вместо снапшотов — векторы версий всех топиков */
+static void send_vvs_to_peer(CrdtMesh* r, Peer* p){
     for (int i=0;i<r->tn;i++){
-        if (r->topics[i].have) send_snapshot_to_peer(r, p, r->topics[i].t);
+        if (r->topics[i].have) send_vv_to_peer(r, p, &r->topics[i]);
     }
 }
 
+/* Op пира дальше окна: отдать ему свой вектор версий — в ответ он дошлёт журналом
+   (или снапшотом) всё выше нашего hi. Повторно просим, только если hi с тех пор
+   сдвинулся, иначе пачка таких op превратилась бы в пачку дозакачек. */
+static void ae_ask_gap(CrdtMesh* r, Peer* from, const ConOp* op){
+    VvEnt* v = vv_get(r, op->console_id, op->actor_id, 0);
+    const TopicRec* tr = topic_find(r, op->topic);
+    if (!v || !tr || v->asked == v->hi + 1) return;
+    v->asked = v->hi + 1;
+    send_vv_to_peer(r, from, tr);
+}
+
+/* Очередь к пиру перевалила за high (over=1) или стекла до low (over=0) */
+static void on_peer_pressure(void* user, int over){
+    Peer* p = (Peer*)user;
+    CrdtMesh* r = p ? p->owner : NULL;
+    if (!r || !p->cow || p->dead) return;
+    if (over){
+        if (!p->lagging) r->lagged++;
+        p->lagging = 1;
+        return;
+    }
+    p->lagging = 0;
+    /* что он пропустил, узнаем из его векторов версий */
+    ConOp op = (ConOp){0};
+    op.tag = CRDT_AE_REQ_TAG;
+    (void)cow1tcp_send(p->cow, &op);
+}
+
 /* ===== Управление пирами ===== */
+/* health без слушателя зависит от числа пиров: 0 ↔ 1 — сообщить подписчику */
+static void peers_changed(CrdtMesh* r){
+    if (r->on_change && (intptr_t)r->listen_fd < 0 && r->pn <= 1) r->on_change(r->change_user, r->self);
+}
 static void peer_destroy(CrdtMesh* r, int idx){
     if (!r || idx<0 || idx>=r->pn) return;
-    Peer* p = &r->peers[idx];
+    Peer* p = r->peers[idx];
     if (p->cow){ cow1tcp_destroy(p->cow); p->cow=NULL; }
     if ((intptr_t)p->fd >= 0){ net_poller_del(r->np, p->fd); tcp_close((tcp_fd_t)p->fd); }
+    free(p);
     /* compact */
     for (int j=idx+1;j<r->pn;j++) r->peers[j-1] = r->peers[j];
     r->pn--;
+    peers_changed(r);
+}
+
+/* Закрыть пира прямо из колбэков его Cow1Tcp (или посреди обхода peers[]) нельзя —
+   помечаем, а убирает таймер поллера уже после раздачи событий */
+static void mesh_reap(void* user, uint32_t now_ms){
+    (void)now_ms;
+    CrdtMesh* r = (CrdtMesh*)user;
+    for (int i=r->pn-1;i>=0;i--) if (r->peers[i]->dead) peer_destroy(r, i);
+}
+static void peer_kill(CrdtMesh* r, Peer* p){
+    p->dead = 1;
+    net_poller_timer_set(r->np, net_poller_now(r->np), mesh_reap, r);
+}
+static void on_peer_close(void* user){
+    Peer* p = (Peer*)user;
+    if (p && p->owner) peer_kill(p->owner, p);
+}
+/* Отправить op пиру; сломанное соединение — в утиль */
+static void peer_send(CrdtMesh* r, Peer* p, const ConOp* op){
+    if (cow1tcp_send(p->cow, op) < 0) peer_kill(r, p);
+}
+
+static void on_peer_op(void* user, const ConOp* inop, const char* tag,
+                       const void* data, size_t dlen, const void* init, size_t ilen);
+/* Соединение установлено — завести пира и отдать ему векторы версий;
+   NULL — мест нет, fd закрыт */
+static Peer* peer_add(CrdtMesh* r, net_fd_t fd){
+    Peer* p = r->pn < CRDT_MAX_PEERS ? (Peer*)calloc(1, sizeof(*p)) : NULL;
+    if (!p){ net_close_fd(fd); return NULL; }
+    p->fd = fd; p->owner = r;
+    p->cow = cow1tcp_create(r->np, p->fd, on_peer_op, p);
+    if (!p->cow){ net_close_fd(fd); free(p); return NULL; }
+    cow1tcp_set_on_pressure(p->cow, on_peer_pressure);
+    cow1tcp_set_on_close(p->cow, on_peer_close);
+    r->peers[r->pn++] = p;
+    send_vvs_to_peer(r, p);
+    peers_changed(r);
+    return p;
 }
 
 /* on_op callback из Cow1: получен ConOp от пира */
@@ -187,12 +506,24 @@ static void on_peer_op(void* user,
     (void)tag;
     Peer* from = (Peer*)user;
     CrdtMesh* r = from ? from->owner : NULL;
-    if (!r) return;
+    if (!r || from->dead) return;
 
+    /* Вектор версий пира — только нам, дальше не идёт */
+    if (inop->op_id==0 && !inop->init_blob && tag && strcmp(tag, CRDT_AE_TAG)==0){
+        ae_on_vv(r, from, inop);
+        return;
+    }
+    if (inop->op_id==0 && !inop->init_blob && tag && strcmp(tag, CRDT_AE_REQ_TAG)==0){
+        send_vvs_to_peer(r, from);
+        return;
+    }
     /* Дедупликация только для «обычных» операций; снапшоты (init_blob && op_id==0)
        пропускаем как есть. */
-    if (!(inop->init_blob && inop->op_id==0)){
-        if (d_seen(r, inop->console_id, inop->op_id)) return; /* уже видели */
+    int snap = inop->init_blob && inop->op_id==0;
+    if (!snap){
+        int k = vv_test_and_mark(r, inop, 0);
+        if (k == VV_FAR) ae_ask_gap(r, from, inop);
+        if (k != VV_NEW) return; /* уже видели или пока рано */
     }
 
     /* Копируем payload'ы, т.к. wire освободит свои после колбэка. */
@@ -201,16 +532,15 @@ static void on_peer_op(void* user,
     if (data && dlen){ copy_data=malloc(dlen); if(copy_data){ memcpy(copy_data,data,dlen); op.data=copy_data; op.size=dlen; } }
     if (init && ilen){ copy_init=malloc(ilen); if(copy_init){ memcpy(copy_init,init,ilen); op.init_blob=copy_init; op.init_size=ilen; } }
 
-    /* Отметить как увиденное (для не-snapshot). */
-    if (!(op.init_blob && op.op_id==0)) d_insert(r, op.console_id, op.op_id);
-
-    /* 1) локальная доставка */
+    /* 1) локальная доставка (и в журнал — для anti-entropy) */
     fanout_local(r, &op);
+    if (snap) ae_on_snapshot(r, &op);
+    else      log_append(r, &op);
     /* 2) ретрансмит всем остальным пирам */
     for (int i=0;i<r->pn;i++){
-        Peer* p = &r->peers[i];
-        if (!p->cow || p==from) continue;
-        cow1tcp_send(p->cow, &op);
+        Peer* p = r->peers[i];
+        if (!p->cow || p==from || p->lagging || p->dead) continue;
+        peer_send(r, p, &op);
     }
     free(copy_data);
     free(copy_init);
@@ -225,13 +555,7 @@ static void on_listen(void* user, net_fd_t fd, int ev){
         int rc = tcp_accept((tcp_fd_t)fd, /*nb=*/1, &cfd, NULL, NULL);
         if (rc == 1) break;
         if (rc < 0) break;
-        if (r->pn >= CRDT_MAX_PEERS){ tcp_close(cfd); continue; }
-        Peer* p = &r->peers[r->pn++];
-        memset(p,0,sizeof(*p));
-        p->fd = (net_fd_t)cfd; p->owner = r; p->alive=1;
-        p->cow = cow1tcp_create(r->np, p->fd, on_peer_op, p);
-        /* Сразу отправим снапшоты известных топиков */
-        send_snapshots_to_peer(r, p);
+        (void)peer_add(r, (net_fd_t)cfd);
     }
 }
 
@@ -255,36 +579,41 @@ static void on_connect(void* user, net_fd_t fd, int ev){
     }
     /* Успех — превращаем в Peer */
     net_poller_del(r->np, fd);
-    if (r->pn >= CRDT_MAX_PEERS){ net_close_fd(fd); free(pc); return; }
-    Peer* p = &r->peers[r->pn++];
-    memset(p,0,sizeof(*p));
-    p->fd = fd; p->owner=r; p->alive=1;
-    p->cow = cow1tcp_create(r->np, p->fd, on_peer_op, p);
-    /* Отправим снапшоты */
-    send_snapshots_to_peer(r, p);
+    (void)peer_add(r, fd);
     free(pc);
 }
 
-static void dial_seed(CrdtMesh* r, const char* host, uint16_t port){
-    if (!r || !host || !*host) return;
+/* -1 — адрес не разобран; ошибку самого connect не сообщаем */
+static int dial_seed(CrdtMesh* r, const char* host, uint16_t port){
+    if (!r || !host || !*host) return -1;
+    /* "host:port" — свой порт у seed (несколько узлов на одной машине).
+       tcp_connect резолвит только IPv4, так что IPv6-литералы (несколько ':')
+       не принимаем вовсе, а не режем по последнему двоеточию. */
+    char hbuf[256];
+    const char* colon = strchr(host, ':');
+    if (colon){
+        if (strchr(colon + 1, ':') || colon == host || (size_t)(colon - host) >= sizeof(hbuf)) return -1;
+        char* end = NULL;
+        unsigned long pv = strtoul(colon + 1, &end, 10);
+        if (end == colon + 1 || *end || pv == 0 || pv > 65535) return -1;
+        memcpy(hbuf, host, (size_t)(colon - host)); hbuf[colon - host] = 0;
+        port = (uint16_t)pv;
+        host = hbuf;
+    }
     tcp_fd_t sfd = (tcp_fd_t)TCP_INVALID_FD;
     int rc = tcp_connect(host, port, /*set_nb=*/1, &sfd);
     if (rc == NET_OK){
         /* Сразу оформим peer */
-        if (r->pn >= CRDT_MAX_PEERS){ tcp_close(sfd); return; }
-        Peer* p = &r->peers[r->pn++];
-        memset(p,0,sizeof(*p));
-        p->fd = (net_fd_t)sfd; p->owner=r; p->alive=1;
-        p->cow = cow1tcp_create(r->np, p->fd, on_peer_op, p);
-        send_snapshots_to_peer(r, p);
+        (void)peer_add(r, (net_fd_t)sfd);
     } else if (rc == NET_INPROGRESS){
         PendingConn* pc = (PendingConn*)calloc(1,sizeof(*pc));
-        if (!pc){ tcp_close(sfd); return; }
+        if (!pc){ tcp_close(sfd); return 0; }
         pc->fd = (net_fd_t)sfd; pc->owner = r;
         net_poller_add(r->np, pc->fd, NET_WR|NET_ERR, on_connect, pc);
     } else {
         /* ошибка — ничего */
     }
+    return 0;
 }
 
 /* ===== VTable реализация ===== */
@@ -292,19 +621,17 @@ static void cm_destroy(Replicator* rr){
     if (!rr) return;
     CrdtMesh* r = (CrdtMesh*)rr->impl;
     if (r){
-        for (int i=0;i<r->pn;i++){
-            if (r->peers[i].cow){ cow1tcp_destroy(r->peers[i].cow); r->peers[i].cow=NULL; }
-            if ((intptr_t)r->peers[i].fd >= 0){
-                net_poller_del(r->np, r->peers[i].fd);
-                tcp_close((tcp_fd_t)r->peers[i].fd);
-            }
-        }
+        net_poller_timer_cancel(r->np, mesh_reap, r);
+        r->on_change = NULL;
+        while (r->pn) peer_destroy(r, r->pn - 1);
         if ((intptr_t)r->listen_fd >= 0){
             net_poller_del(r->np, (net_fd_t)r->listen_fd);
             tcp_close(r->listen_fd);
             r->listen_fd = (tcp_fd_t)TCP_INVALID_FD;
         }
-        free(r->dedup);
+        while (r->llen) log_evict(r);
+        free(r->log);
+        free(r->vv);
         free(r);
     }
     free(rr);
@@ -320,13 +647,17 @@ static void cm_publish(Replicator* rr, const ConOp* op){
     if (op->init_blob && op->init_size){ copy_init=malloc(op->init_size); if(copy_init){ memcpy(copy_init,op->init_blob,op->init_size); tmp.init_blob=copy_init; tmp.init_size=op->init_size; } }
 
     /* Отметить как увиденное — чтобы не зациклить самих себя. Снапшот не учитываем. */
-    if (!(tmp.init_blob && tmp.op_id==0)) d_insert(r, tmp.console_id, tmp.op_id);
+    if (!(tmp.init_blob && tmp.op_id==0)){
+        (void)vv_test_and_mark(r, &tmp, 1);
+        log_append(r, &tmp);
+    }
 
     /* 1) локально подтвердить */
     fanout_local(r, &tmp);
     /* 2) отправить всем пирами */
     for (int i=0;i<r->pn;i++){
-        if (r->peers[i].cow) cow1tcp_send(r->peers[i].cow, &tmp);
+        Peer* p = r->peers[i];
+        if (p->cow && !p->lagging && !p->dead) peer_send(r, p, &tmp);
     }
     free(copy_data);
     free(copy_init);
@@ -341,8 +672,11 @@ static void cm_set_listener(Replicator* rr, TopicId topic, ReplicatorConfirmCb c
         if (r->topics[i].have && r->topics[i].t.type_id==topic.type_id && r->topics[i].t.inst_id==topic.inst_id){ have=1; break; }
     }
     if (!have && r->tn < CRDT_MAX_TOPICS){
+        static uint64_t s_nonce = 0;
         r->topics[r->tn].t = topic;
         r->topics[r->tn].have = 1;
+        /* своя база: пока не обменялись снапшотом, журналы чужих узлов не в счёт */
+        r->topics[r->tn].base = mix64((uint64_t)(uintptr_t)r ^ ((uint64_t)time(NULL) << 20) ^ (++s_nonce * 0x9E3779B97F4A7C15ULL) ^ topic.inst_id);
         r->tn++;
     }
     /* зарегистрируем listener (с фильтром по inst_id~console_id для совместимости) */
@@ -380,6 +714,12 @@ static int cm_health(Replicator* rr){
     return -1;
 }
 
+static void cm_set_on_change(Replicator* rr, ReplicatorChangeCb cb, void* user){
+    if (!rr) return;
+    CrdtMesh* r = (CrdtMesh*)rr->impl; if (!r) return;
+    r->on_change = cb; r->change_user = user;
+}
+
 static const ReplicatorVt CM_VT = {
     .destroy      = cm_destroy,
     .publish      = cm_publish,
@@ -387,6 +727,7 @@ static const ReplicatorVt CM_VT = {
     .unset_listener = cm_unset_listener,
     .capabilities = cm_capabilities,
     .health       = cm_health,
+    .set_on_change = cm_set_on_change,
 };
 
 /* ===== Фабрики ===== */
@@ -398,7 +739,7 @@ Replicator* replicator_create_crdt_mesh(NetPoller* np, uint16_t listen_port,
     impl->np = np;
     impl->listen_fd = (tcp_fd_t)TCP_INVALID_FD;
     impl->port = listen_port;
-    impl->dedup = NULL; impl->dcap = 0; impl->dcount = 0;
+    impl->vv = NULL; impl->vcap = 0; impl->vcount = 0;
     impl->ln = impl->tn = impl->pn = 0;
 
     if (np && listen_port){
@@ -425,6 +766,7 @@ Replicator* replicator_create_crdt_mesh(NetPoller* np, uint16_t listen_port,
     }
     r->v = &CM_VT;
     r->impl = impl;
+    impl->self = r;
     return r;
 }
 
@@ -436,13 +778,14 @@ Replicator* replicator_create_crdt(void){
     impl->np = NULL;
     impl->listen_fd = (tcp_fd_t)TCP_INVALID_FD;
     impl->port = 0;
-    impl->dedup = NULL; impl->dcap = 0; impl->dcount = 0;
+    impl->vv = NULL; impl->vcap = 0; impl->vcount = 0;
     impl->ln = impl->tn = impl->pn = 0;
 
     Replicator* r = (Replicator*)calloc(1, sizeof(*r));
     if (!r){ free(impl); return NULL; }
     r->v = &CM_VT;
     r->impl = impl;
+    impl->self = r;
     return r;
 }
 
@@ -450,8 +793,7 @@ int repl_crdt_mesh_seed_add(Replicator* rr, const char* host){
     if (!rr || !host || !*host) return -1;
     CrdtMesh* r = (CrdtMesh*)rr->impl; if (!r) return -1;
     /* используем текущий mesh-порт */
-    dial_seed(r, host, r->port ? r->port : 0);
-    return 0;
+    return dial_seed(r, host, r->port ? r->port : 0);
 }
 
 int repl_crdt_mesh_stat(Replicator* rr, int* out_peers, int* out_listen, int* out_topics){
@@ -462,4 +804,31 @@ int repl_crdt_mesh_stat(Replicator* rr, int* out_peers, int* out_listen, int* ou
     if (out_topics) *out_topics = r->tn;
     return 0;
 }
+
+int repl_crdt_mesh_ae_stat(Replicator* rr, int* out_log_ops, uint64_t* out_delta_ops, uint64_t* out_snapshots){
+    if (!rr) return -1;
+    CrdtMesh* r = (CrdtMesh*)rr->impl; if (!r) return -1;
+    if (out_log_ops)   *out_log_ops   = (int)r->llen;
+    if (out_delta_ops) *out_delta_ops = r->ae_delta_ops;
+    if (out_snapshots) *out_snapshots = r->ae_snapshots;
+    return 0;
+}
+
+int repl_crdt_mesh_lag_stat(Replicator* rr, int* out_lagging, uint64_t* out_lagged){
+    if (!rr) return -1;
+    CrdtMesh* r = (CrdtMesh*)rr->impl; if (!r) return -1;
+    int n = 0;
+    for (int i=0;i<r->pn;i++) if (r->peers[i]->lagging) n++;
+    if (out_lagging) *out_lagging = n;
+    if (out_lagged)  *out_lagged  = r->lagged;
+    return 0;
+}
+
+int repl_crdt_mesh_dedup_stat(Replicator* rr, int* out_actors, uint64_t* out_far){
+    if (!rr) return -1;
+    CrdtMesh* r = (CrdtMesh*)rr->impl; if (!r) return -1;
+    if (out_actors)  *out_actors  = (int)r->vcount;
+    if (out_far) *out_far = r->vv_far;
+    return 0;
+}
 #endif /* !__EMSCRIPTEN__ */
@@ -11,17 +11,30 @@ extern "C" {
 
     /**
      * CRDT mesh backend (TCP mesh):
-     * - каждый узел может слушать порт (listen_port>0) и/или подключаться к seed-узлам;
-     * - операции доставляются всем пирами, дедуплицируются по (console_id,op_id);
-     * - при установлении соединения отправляется снапшот для всех подписанных топиков (через TypeRegistry).
+     * - каждый узел может слушать порт (listen_port>0) и/или подключаться к seed-узлам
+     *   ("host" — на тот же порт, что слушаем сами, или "host:port"; только IPv4-адрес
+     *   или имя хоста — IPv6-литералы не поддерживаются, seed_add вернёт -1);
+     * - операции доставляются всем пирами, дедуплицируются вектором версий: на
+     *   (console_id, actor_id) — непрерывная отметка seq и окно CRDT_VV_WINDOW над ней
+     *   (seq — младшие 32 бита op_id, если старшие равны actor_id, иначе весь op_id);
+     *   память — O(акторов), проверка — O(1). Операция пира, ушедшая дальше окна,
+     *   не доставляется: узел отдаёт пиру свой вектор версий и получает пропущенное
+     *   anti-entropy (ниже), после чего примет и её;
+     * - при установлении соединения пиры обмениваются векторами версий топиков
+     *   (anti-entropy) и досылают друг другу только недостающие op из журнала
+     *   последних op (CRDT_LOG_OPS / CRDT_LOG_BYTES). Снапшот через TypeRegistry —
+     *   если журнал уже обрезан ниже того, что знает пир, или истории узлов ещё не
+     *   сведены (тогда его шлёт узел с большим числом op, второй досылает свои).
+     *   Тем же путём догоняется медленный пир: пока очередь к нему выше high
+     *   watermark Cow1Tcp, op ему не шлём, а когда стечёт — просим его векторы версий;
      *
      * capabilities(): REPL_CRDT | REPL_BROADCAST
      * health(): 0, если есть listen_fd или хотя бы одно активное подключение.
      *
      * Замечания:
      *  - порядок не гарантируется (это CRDT-канал);
-     *  - надёжность «на лучшем усилии»: при потере связи новые пиры получат актуальное
-     *    состояние через снапшот при переподключении.
+     *  - надёжность «на лучшем усилии»: цена переподключения — расхождение узлов,
+     *    а не размер состояния (пока хватает журнала).
      */
 #if defined(__EMSCRIPTEN__)
     static inline Replicator* replicator_create_crdt_mesh(NetPoller* np, uint16_t listen_port,
@@ -33,6 +46,15 @@ extern "C" {
     static inline int  repl_crdt_mesh_stat(Replicator* r, int* out_peers, int* out_listen, int* out_topics){
         (void)r; if(out_peers)*out_peers=0; if(out_listen)*out_listen=0; if(out_topics)*out_topics=0; return -1;
     }
+    static inline int  repl_crdt_mesh_dedup_stat(Replicator* r, int* out_actors, uint64_t* out_far){
+        (void)r; if(out_actors)*out_actors=0; if(out_far)*out_far=0; return -1;
+    }
+    static inline int  repl_crdt_mesh_ae_stat(Replicator* r, int* out_log_ops, uint64_t* out_delta_ops, uint64_t* out_snapshots){
+        (void)r; if(out_log_ops)*out_log_ops=0; if(out_delta_ops)*out_delta_ops=0; if(out_snapshots)*out_snapshots=0; return -1;
+    }
+    static inline int  repl_crdt_mesh_lag_stat(Replicator* r, int* out_lagging, uint64_t* out_lagged){
+        (void)r; if(out_lagging)*out_lagging=0; if(out_lagged)*out_lagged=0; return -1;
+    }
 #else
     Replicator* replicator_create_crdt_mesh(NetPoller* np, uint16_t listen_port,
                                             const char** seeds, int nseeds);
@@ -41,6 +63,13 @@ extern "C" {
     /* Runtime добавление seed и статистика (для консольных команд/диагностики). */
     int  repl_crdt_mesh_seed_add(Replicator* r, const char* host);
     int  repl_crdt_mesh_stat(Replicator* r, int* out_peers, int* out_listen, int* out_topics);
+    /* Дедуп: сколько акторов в векторе версий и сколько op пиров пришло дальше окна
+       (не доставлены сразу, дозакачаны anti-entropy) */
+    int  repl_crdt_mesh_dedup_stat(Replicator* r, int* out_actors, uint64_t* out_far);
+    /* Anti-entropy: op в журнале, сколько op дослано журналом и сколько снапшотов отправлено */
+    int  repl_crdt_mesh_ae_stat(Replicator* r, int* out_log_ops, uint64_t* out_delta_ops, uint64_t* out_snapshots);
+    /* Медленные пиры: сколько сейчас отстаёт и сколько раз пиры уходили в отставание */
+    int  repl_crdt_mesh_lag_stat(Replicator* r, int* out_lagging, uint64_t* out_lagged);
 #endif
 
 #ifdef __cplusplus
@@ -1,9 +1,19 @@
 /* Репликатор-лидер по TCP: слушает, делает HELO/WLCM, ретранслирует ConOp всем клиентам.
  * Реализация бэкенда под общий интерфейс ReplicatorVt.
+ *
+ * Каждая op потока получает порядковый номер (seq) и ложится в журнал-кольцо.
+ * Клиент, переподключаясь, присылает в HELO v2 эпоху лидера и последний
+ * полученный seq — лидер дошлёт ему разрыв из журнала, а если журнал уже
+ * не покрывает разрыв (или эпоха чужая) — снапшоты топиков.
+ *
+ * Тем же путём догоняется медленный клиент: когда его исходящая очередь
+ * переваливает за high watermark Cow1Tcp, поток ему больше не копится
+ * (клиент «отстал»); стекла до low — досылаем с последнего поставленного seq.
  */
 #include "replication/backends/leader_tcp.h"
 #include "replication/repl_iface.h"
 #include "replication/repl_types.h"
+#include "replication/type_registry.h"
 #include "net/net.h"
 #include "net/tcp.h"
 #include "net/wire_tcp.h"
@@ -11,6 +21,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <time.h>
 
 #ifndef REPL_SRV_MAX_CLIENTS
 #  define REPL_SRV_MAX_CLIENTS 32
@@ -21,6 +32,17 @@
 #ifndef REPL_MAX_LISTENERS
 #  define REPL_MAX_LISTENERS 16
 #endif
+/* Журнал op для дозакачки переподключившимся клиентам */
+#ifndef LEADER_LOG_OPS
+#  define LEADER_LOG_OPS 4096
+#endif
+#ifndef LEADER_LOG_BYTES
+#  define LEADER_LOG_BYTES (4u * 1024u * 1024u)
+#endif
+/* Топики, для которых при откате на снапшот спрашиваем type_registry */
+#ifndef LEADER_MAX_TOPICS
+#  define LEADER_MAX_TOPICS 16
+#endif
 
 /* ===== Little-endian helpers ===== */
 static inline void wr16(uint8_t** p, uint16_t v){ (*p)[0]=(uint8_t)(v); (*p)[1]=(uint8_t)(v>>8); *p+=2; }
@@ -30,17 +52,42 @@ static inline uint32_t rd32(const uint8_t** p){ const uint8_t* s=*p; *p+=4; retu
 static inline uint16_t rd16(const uint8_t** p){ const uint8_t* s=*p; *p+=2; return (uint16_t)(s[0]|((uint16_t)s[1]<<8)); }
 static inline uint64_t rd64(const uint8_t** p){ uint64_t lo=rd32(p), hi=rd32(p); return lo|(hi<<32); }
 
+static uint64_t mix64(uint64_t x){ /* xorshift* */
+    x ^= x>>30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x>>27; x *= 0x94d049bb133111ebULL;
+    x ^= x>>31; return x;
+}
+
 /* ===== HELO/WLCM ===== */
 #define HS_MAGIC_HELO 0x4F4C4548u /* 'HELO' LE */
 #define HS_MAGIC_WLCM 0x4D434C57u /* 'WLCM' LE */
 #define HS_VER        1u
+#define HS_VER_RESUME 2u      /* + u64 epoch, u64 seq */
+#define HS_VER_HEAD   3u      /* как 2; WLCM ещё + u64 head */
 typedef struct {
     uint32_t magic;   /* HELO */
-    uint16_t ver;     /* 1 */
-    uint16_t _rsv;
+    uint16_t ver;     /* 1, 2 или 3 */
+    uint16_t wire;    /* HELO: макс. версия COW1 клиента (0 — только v1); WLCM: выбранная */
     uint64_t console_id;
 } HelloPkt;                   /* 16 bytes */
 typedef HelloPkt WelcomePkt;  /* те же поля, magic=WLCM */
+/* ver=2. HELO: epoch — эпоха лидера, от которого клиент получал поток (0 — не было),
+   seq — последний полученный seq. WLCM: эпоха лидера и seq, после которого пойдёт поток. */
+typedef struct {
+    HelloPkt h;
+    uint64_t epoch;
+    uint64_t seq;
+} ResumePkt;                  /* 32 bytes */
+/* ver=3, только WLCM: head — seq последней op лидера на момент ответа. Клиент досылает
+   свои неподтверждённые op, лишь дочитав поток до head: эхо тех, что лидер уже
+   получил до обрыва, придёт в этой дозакачке. HELO v3 — тот же ResumePkt. */
+typedef struct {
+    ResumePkt r;
+    uint64_t  head;
+} ResumeHeadPkt;              /* 40 bytes */
+/* Снапшот при откате: op_id=0, init_blob — состояние, data — u64 seq, который он покрывает.
+   Без init_blob — только перенос seq (снапшота для топика нет). */
+#define LEADER_SNAP_TAG "snapshot.seq"
 
 typedef struct Listener {
     ReplicatorConfirmCb cb;
@@ -50,13 +97,26 @@ typedef struct Listener {
 
 struct LeaderRepl; /* fwd */
 
+/* Запись журнала: своя копия op вместе с tag/data/init */
+typedef struct LogEnt {
+    ConOp    op;
+    uint64_t seq;
+    size_t   bytes;
+} LogEnt;
+
 typedef struct Client {
     net_fd_t fd;
     int      state;   /* 0=ожидаем HELO; 1=пишем WLCM; 2=stream(COW1) */
     size_t   hs_got;
-    uint8_t  hs_buf[sizeof(HelloPkt)];
+    uint8_t  hs_buf[sizeof(ResumePkt)];
     size_t   out_off, out_len;
-    uint8_t  out_buf[sizeof(WelcomePkt)];
+    uint8_t  out_buf[sizeof(ResumeHeadPkt)];
+    uint16_t wire;    /* согласованная версия COW1 */
+    uint64_t from;    /* клиенту уже известны op с seq ≤ from */
+    int      snap;    /* дослать снапшоты вместо журнала */
+    uint64_t sent;    /* seq последней op, поставленной в очередь клиенту */
+    int      lagging; /* очередь выше high watermark: поток ему не шлём */
+    int      dead;    /* соединение не годится: закроет leader_reap вне колбэков Cow1Tcp */
     Cow1Tcp* cow;     /* живёт в состоянии 2 */
     struct LeaderRepl* owner;
 } Client;
@@ -67,8 +127,17 @@ typedef struct LeaderRepl {
     uint64_t   console_id;
     Listener   ls[REPL_MAX_LISTENERS];
     int        ln;
-    Client     cl[REPL_SRV_MAX_CLIENTS];
+    Client*    cl[REPL_SRV_MAX_CLIENTS]; /* указатели: Cow1Tcp держит Client* как user */
     int        cn;      /* занятых клиентов */
+    /* Журнал (кольцо) op потока с их seq */
+    uint64_t   epoch;   /* случайная метка экземпляра: seq другого лидера не годятся */
+    uint64_t   seq;     /* seq последней op */
+    uint64_t   evicted; /* op с seq ≤ evicted в журнале уже нет */
+    LogEnt*    log;
+    size_t     lhead, llen, lbytes;
+    TopicId    topics[LEADER_MAX_TOPICS]; int tn;
+    uint64_t   replayed, snapshots; /* сколько op дослано журналом / сколько раз откатились на снапшот */
+    uint64_t   lagged;  /* сколько раз клиент уходил в отставание */
 } LeaderRepl;
 
 /* ===== локальная доставка подтверждений ===== */
@@ -81,16 +150,190 @@ static void fanout_local(LeaderRepl* r, const ConOp* op){
     }
 }
 
+static int topic_eq(TopicId a, TopicId b){ return a.type_id==b.type_id && a.inst_id==b.inst_id; }
+static void topic_note(LeaderRepl* r, TopicId t){
+    if (!t.type_id) return;
+    for (int i=0;i<r->tn;i++) if (topic_eq(r->topics[i], t)) return;
+    if (r->tn < LEADER_MAX_TOPICS) r->topics[r->tn++] = t;
+}
+
+static void client_kill(LeaderRepl* r, Client* c);
+
+/* ===== Журнал op ===== */
+static void log_evict(LeaderRepl* r){
+    LogEnt* e = &r->log[r->lhead];
+    /* evicted мог уйти вперёд на op, не попавшей в журнал, — назад не двигаем */
+    if (e->seq > r->evicted) r->evicted = e->seq;
+    r->lbytes -= e->bytes;
+    free((void*)e->op.tag); free((void*)e->op.data); free((void*)e->op.init_blob);
+    memset(e, 0, sizeof(*e));
+    r->lhead = (r->lhead + 1) % LEADER_LOG_OPS;
+    r->llen--;
+}
+/* Выдать op следующий seq и положить копию в журнал; NULL — op в журнал не попала
+   (слишком велика или нет памяти) и дослать её сможет только снапшот */
+static const LogEnt* log_append(LeaderRepl* r, const ConOp* op){
+    uint64_t seq = ++r->seq;
+    topic_note(r, op->topic);
+    size_t tlen = (op->tag && *op->tag) ? strlen(op->tag) + 1 : 0;
+    size_t bytes = sizeof(LogEnt) + tlen + op->size + op->init_size;
+    if (bytes > LEADER_LOG_BYTES || (!r->log && !(r->log = (LogEnt*)calloc(LEADER_LOG_OPS, sizeof(LogEnt))))){
+        r->evicted = seq;
+        return NULL;
+    }
+    while (r->llen && (r->llen == LEADER_LOG_OPS || r->lbytes + bytes > LEADER_LOG_BYTES)) log_evict(r);
+    LogEnt* e = &r->log[(r->lhead + r->llen) % LEADER_LOG_OPS];
+    e->op = *op;
+    e->op.tag = NULL; e->op.data = NULL; e->op.init_blob = NULL;
+    if ((tlen && !(e->op.tag = (char*)malloc(tlen))) ||
+        (op->data && op->size && !(e->op.data = malloc(op->size))) ||
+        (op->init_blob && op->init_size && !(e->op.init_blob = malloc(op->init_size))))
+    {
+        free((void*)e->op.tag); free((void*)e->op.data); free((void*)e->op.init_blob);
+        memset(e, 0, sizeof(*e));
+        r->evicted = seq;
+        return NULL;
+    }
+    if (tlen) memcpy((char*)e->op.tag, op->tag, tlen);
+    if (e->op.data) memcpy((void*)e->op.data, op->data, op->size);
+    if (e->op.init_blob) memcpy((void*)e->op.init_blob, op->init_blob, op->init_size);
+    e->seq = seq;
+    e->bytes = bytes;
+    r->llen++; r->lbytes += bytes;
+    return e;
+}
+
+/* Новая op потока: seq, журнал, рассылка всем клиентам (включая автора), затем
+   локальное подтверждение. Клиентам — строго в порядке seq: локальные слушатели
+   могут тут же опубликовать свои op. */
+static void leader_relay(LeaderRepl* r, const ConOp* op){
+    /* op, которую нельзя закодировать, клиентам не уйдёт — seq ей не положен,
+       иначе счёт op у клиентов разойдётся с нашим */
+    if (!conop_wire_encoded_size(op)){ fanout_local(r, op); return; }
+    const LogEnt* e = log_append(r, op);
+    const ConOp* out = e ? &e->op : op;
+    /* кодируем один раз на версию провода и раздаём кадр по ссылке */
+    Cow1TcpFrame* fr[CONOP_WIRE_VERSION_MAX - CONOP_WIRE_VERSION + 1] = {0};
+    for (int i=0;i<r->cn;i++){
+        Client* c = r->cl[i];
+        if (!c->cow || c->lagging || c->dead) continue;
+        Cow1TcpFrame** f = &fr[c->wire - CONOP_WIRE_VERSION];
+        /* кадр не собрать или не поставить — клиент пропустил бы seq; пусть
+           переподключится и дочитает журналом */
+        if (!*f && !(*f = cow1tcp_frame_encode(out, c->wire))){ client_kill(r, c); continue; }
+        int rc = cow1tcp_send_frame(c->cow, *f);
+        if (rc == 0) c->sent = r->seq;
+        else if (rc < 0) client_kill(r, c);
+    }
+    for (size_t v=0;v<sizeof(fr)/sizeof(fr[0]);v++) cow1tcp_frame_unref(fr[v]);
+    fanout_local(r, op);
+}
+
+/* Откат на снапшоты: по одному на известный топик, у которого есть snapshot().
+   1 — очередь клиента переполнилась раньше, чем ушли все (повторим целиком,
+   когда стечёт); -1 — соединение не годится (кадр не поставить) */
+static int send_snapshots(LeaderRepl* r, Client* c){
+    uint8_t sq[8], *p = sq;
+    wr64(&p, r->seq);
+    int sent = 0, rc = 0;
+    for (int i=0;i<r->tn && rc==0;i++){
+        void* user=NULL;
+        const TypeVt* vt = type_registry_get_default(r->topics[i].type_id, &user);
+        if (!vt || !vt->snapshot) continue;
+        void* blob=NULL; size_t blen=0; uint32_t schema=0;
+        if (vt->snapshot(user, &schema, &blob, &blen) == 0 && blob && blen>0){
+            ConOp sop = (ConOp){0};
+            sop.topic = r->topics[i];
+            sop.console_id = r->topics[i].inst_id;
+            sop.schema = schema;
+            sop.tag = LEADER_SNAP_TAG;
+            sop.data = sq; sop.size = sizeof(sq);
+            sop.init_blob = blob; sop.init_size = blen;
+            rc = cow1tcp_send(c->cow, &sop);
+            sent++;
+        }
+        free(blob);
+    }
+    if (!sent){
+        /* состояние передать нечем — хотя бы синхронизировать seq */
+        ConOp sop = (ConOp){0};
+        sop.console_id = r->console_id;
+        sop.tag = LEADER_SNAP_TAG;
+        sop.data = sq; sop.size = sizeof(sq);
+        rc = cow1tcp_send(c->cow, &sop);
+    }
+    r->snapshots++;
+    return rc;
+}
+
+/* Клиент вошёл в поток (или снова успевает): дослать всё, что после c->from
+   (в т.ч. op, пришедшие за время рукопожатия). Если очередь снова переполнится —
+   остановимся, остаток дошлёт следующий вызов с c->sent (по on_pressure(0)). */
+static void client_catch_up(LeaderRepl* r, Client* c){
+    if (c->dead) return;
+    if (c->snap || c->from < r->evicted){
+        c->snap = 1;
+        int rc = send_snapshots(r, c);
+        if (rc == 0){ c->snap = 0; c->sent = r->seq; }
+        else if (rc < 0) client_kill(r, c);
+        return;
+    }
+    c->sent = c->from;
+    for (size_t k=0;k<r->llen && !c->lagging;k++){
+        const LogEnt* e = &r->log[(r->lhead + k) % LEADER_LOG_OPS];
+        if (e->seq <= c->from) continue;
+        int rc = cow1tcp_send(c->cow, &e->op);
+        if (rc < 0){ client_kill(r, c); return; }
+        if (rc) break;
+        c->sent = e->seq;
+        r->replayed++;
+    }
+}
+
 static void client_close(LeaderRepl* r, int idx){
     if (!r || idx<0 || idx>=r->cn) return;
-    Client* c = &r->cl[idx];
+    Client* c = r->cl[idx];
     if (c->cow){ cow1tcp_destroy(c->cow); c->cow=NULL; }
     if ((intptr_t)c->fd >= 0){ net_poller_del(r->np, c->fd); tcp_close((tcp_fd_t)c->fd); }
+    free(c);
     /* compact */
     for (int j=idx+1;j<r->cn;j++) r->cl[j-1] = r->cl[j];
     r->cn--;
 }
 
+/* Закрыть клиента прямо из колбэков его Cow1Tcp (или посреди обхода cl[]) нельзя —
+   помечаем, а закрывает таймер поллера уже после раздачи событий */
+static void leader_reap(void* user, uint32_t now_ms){
+    (void)now_ms;
+    LeaderRepl* r = (LeaderRepl*)user;
+    for (int i=r->cn-1;i>=0;i--) if (r->cl[i]->dead) client_close(r, i);
+}
+static void client_kill(LeaderRepl* r, Client* c){
+    c->dead = 1;
+    net_poller_timer_set(r->np, net_poller_now(r->np), leader_reap, r);
+}
+
+/* Клиент отвалился в потоке — освободить место (переподключится новым HELO) */
+static void srv_on_client_close(void* user){
+    Client* c = (Client*)user; if (!c || !c->owner) return;
+    LeaderRepl* r = c->owner;
+    for (int i=0;i<r->cn;i++) if (r->cl[i] == c){ client_close(r, i); return; }
+}
+
+/* Очередь клиента перевалила за high (over=1) или стекла до low (over=0) */
+static void srv_on_client_pressure(void* user, int over){
+    Client* c = (Client*)user; if (!c || !c->owner || !c->cow || c->dead) return;
+    LeaderRepl* r = c->owner;
+    if (over){
+        if (!c->lagging) r->lagged++;
+        c->lagging = 1;
+        return;
+    }
+    c->lagging = 0;
+    c->from = c->sent;
+    client_catch_up(r, c);
+}
+
 /* ===== колбэк из COW1 — пришёл ConOp от клиента ===== */
 static void srv_on_client_op(void* user,
                              const ConOp* inop,
@@ -98,24 +341,13 @@ static void srv_on_client_op(void* user,
                              const void* data, size_t dlen,
                              const void* init, size_t ilen)
 {
-    (void)tag;
     Client* c = (Client*)user; if (!c || !c->owner || !inop) return;
-    LeaderRepl* r = c->owner;
-
-    /* Скопировать payload'ы — cow1tcp освободит свои буферы после колбэка */
+    /* буферы cow1tcp живы до конца колбэка; копию делает журнал */
     ConOp op = *inop;
-    void* copy_data = NULL; void* copy_init = NULL;
-    if (data && dlen){ copy_data = malloc(dlen); if (copy_data){ memcpy(copy_data, data, dlen); op.data = copy_data; op.size = dlen; } }
-    if (init && ilen){ copy_init = malloc(ilen); if (copy_init){ memcpy(copy_init, init, ilen); op.init_blob = copy_init; op.init_size = ilen; } }
-
-    /* 1) локально подтвердить */
-    fanout_local(r, &op);
-    /* 2) ретрансмит всем, включая отправителя */
-    for (int i=0;i<r->cn;i++){
-        if (r->cl[i].cow){ cow1tcp_send(r->cl[i].cow, &op); }
-    }
-    free(copy_data);
-    free(copy_init);
+    op.tag = tag;
+    op.data = dlen ? data : NULL; op.size = dlen;
+    op.init_blob = ilen ? init : NULL; op.init_size = ilen;
+    leader_relay(c->owner, &op);
 }
 
 /* ===== Handshake HELO/WLCM и переход в COW1 ===== */
@@ -123,35 +355,50 @@ static void on_client_hs(void* user, net_fd_t fd, int ev){
     LeaderRepl* r = (LeaderRepl*)user; if (!r) return;
     /* найти клиента по fd */
     int idx = -1;
-    for (int i=0;i<r->cn;i++){ if (r->cl[i].fd == fd){ idx = i; break; } }
+    for (int i=0;i<r->cn;i++){ if (r->cl[i]->fd == fd){ idx = i; break; } }
     if (idx < 0) return;
-    Client* c = &r->cl[idx];
+    Client* c = r->cl[idx];
     if (ev & NET_ERR){ client_close(r, idx); return; }
     if (c->state == 0 && (ev & NET_RD)){
-        /* дочитываем HELO */
-        size_t need = sizeof(HelloPkt) - c->hs_got;
-        if (need){
-            tcp_iovec v = { c->hs_buf + c->hs_got, need };
+        /* дочитываем HELO; длина известна после поля ver */
+        for (;;){
+            size_t want = sizeof(HelloPkt);
+            if (c->hs_got >= 6 && (c->hs_buf[4] == HS_VER_RESUME || c->hs_buf[4] == HS_VER_HEAD) && c->hs_buf[5] == 0) want = sizeof(ResumePkt);
+            if (c->hs_got >= want) break;
+            tcp_iovec v = { c->hs_buf + c->hs_got, want - c->hs_got };
             long rc = tcp_readv((tcp_fd_t)c->fd, &v, 1);
             if (rc > 0){ c->hs_got += (size_t)rc; }
             else if (rc == 0){ client_close(r, idx); return; }
             else { /* rc<0 */ int err = net_last_error(); if (!net_err_would_block(err)){ client_close(r, idx); } return; }
         }
-        if (c->hs_got >= sizeof(HelloPkt)){
+        {
             /* проверить и подготовить WLCM */
             const uint8_t* p = c->hs_buf;
             uint32_t magic = rd32(&p);
-            uint16_t ver   = rd16(&p); (void)rd16(&p);
+            uint16_t ver   = rd16(&p);
+            uint16_t wire  = rd16(&p);
             uint64_t cid   = rd64(&p);
-            if (magic != HS_MAGIC_HELO || ver != HS_VER || cid != r->console_id){
+            if (magic != HS_MAGIC_HELO || ver < HS_VER || ver > HS_VER_HEAD || cid != r->console_id){
                 client_close(r, idx); return;
             }
+            /* старый клиент шлёт 0 — остаёмся на v1 */
+            c->wire = (uint16_t)CONOP_WIRE_VERSION;
+            if (wire > c->wire) c->wire = wire < CONOP_WIRE_VERSION_MAX ? wire : (uint16_t)CONOP_WIRE_VERSION_MAX;
+            /* новый клиент (и клиент v1) получает поток с текущего места */
+            c->from = r->seq; c->snap = 0;
+            if (ver >= HS_VER_RESUME){
+                uint64_t epoch = rd64(&p), seq = rd64(&p);
+                if (epoch == r->epoch && seq <= r->seq) c->from = seq;  /* окончательно решит client_catch_up */
+                else if (epoch) c->snap = 1;                           /* поток другого лидера */
+            }
             /* сформировать WLCM для записи */
-            uint8_t out[sizeof(WelcomePkt)];
+            uint8_t out[sizeof(ResumeHeadPkt)];
             uint8_t* q = out;
-            wr32(&q, HS_MAGIC_WLCM); wr16(&q, HS_VER); wr16(&q, 0); wr64(&q, r->console_id);
-            memcpy(c->out_buf, out, sizeof(out));
-            c->out_off = 0; c->out_len = sizeof(out);
+            wr32(&q, HS_MAGIC_WLCM); wr16(&q, ver); wr16(&q, c->wire); wr64(&q, r->console_id);
+            if (ver >= HS_VER_RESUME){ wr64(&q, r->epoch); wr64(&q, c->from); }
+            if (ver == HS_VER_HEAD) wr64(&q, r->seq);
+            memcpy(c->out_buf, out, (size_t)(q - out));
+            c->out_off = 0; c->out_len = (size_t)(q - out);
             c->state = 1;
             net_poller_mod(r->np, c->fd, NET_RD|NET_WR|NET_ERR);
         }
@@ -172,7 +419,11 @@ static void on_client_hs(void* user, net_fd_t fd, int ev){
             c->out_off = c->out_len = 0;
             /* заменить обработчик на Cow1Tcp */
             c->cow = cow1tcp_create(r->np, c->fd, srv_on_client_op, c);
+            cow1tcp_set_wire_version(c->cow, c->wire);
+            cow1tcp_set_on_close(c->cow, srv_on_client_close);
+            cow1tcp_set_on_pressure(c->cow, srv_on_client_pressure);
             /* cow1tcp сам модифицирует интересы fd в поллере */
+            if (c->cow) client_catch_up(r, c);
         }
     }
 }
@@ -187,8 +438,9 @@ static void on_listen(void* user, net_fd_t fd, int ev){
         if (rc == 1) break;      /* очередь пуста */
         if (rc < 0) break;       /* ошибка */
         if (r->cn >= REPL_SRV_MAX_CLIENTS){ tcp_close(cfd); continue; }
-        Client* c = &r->cl[r->cn++];
-        memset(c, 0, sizeof(*c));
+        Client* c = (Client*)calloc(1, sizeof(Client));
+        if (!c){ tcp_close(cfd); continue; }
+        r->cl[r->cn++] = c;
         c->owner = r;
         c->fd = (net_fd_t)cfd;
         c->state = 0; c->hs_got = 0;
@@ -202,15 +454,20 @@ static void leader_destroy(Replicator* rr){
     if (!rr) return;
     LeaderRepl* r = (LeaderRepl*)rr->impl;
     if (r){
+        net_poller_timer_cancel(r->np, leader_reap, r);
         /* клиенты */
         for (int i=0;i<r->cn;i++){
-            if (r->cl[i].cow){ cow1tcp_destroy(r->cl[i].cow); r->cl[i].cow=NULL; }
-            if ((intptr_t)r->cl[i].fd >= 0){
-                net_poller_del(r->np, r->cl[i].fd);
-                tcp_close((tcp_fd_t)r->cl[i].fd);
+            Client* c = r->cl[i];
+            if (c->cow){ cow1tcp_destroy(c->cow); c->cow=NULL; }
+            if ((intptr_t)c->fd >= 0){
+                net_poller_del(r->np, c->fd);
+                tcp_close((tcp_fd_t)c->fd);
             }
+            free(c);
         }
         r->cn = 0;
+        while (r->llen) log_evict(r);
+        free(r->log);
         /* слушатель */
         if ((intptr_t)r->listen_fd >= 0){
             net_poller_del(r->np, (net_fd_t)r->listen_fd);
@@ -224,20 +481,7 @@ static void leader_destroy(Replicator* rr){
 
 static void leader_publish(Replicator* rr, const ConOp* op){
     if (!rr || !op) return;
-    LeaderRepl* r = (LeaderRepl*)rr->impl;
-    /* скопировать payload'ы, чтобы можно было асинхронно вещать */
-    ConOp tmp = *op;
-    void* copy_data = NULL; void* copy_init = NULL;
-    if (op->data && op->size){ copy_data = malloc(op->size); if (copy_data){ memcpy(copy_data, op->data, op->size); tmp.data = copy_data; tmp.size = op->size; } }
-    if (op->init_blob && op->init_size){ copy_init = malloc(op->init_size); if (copy_init){ memcpy(copy_init, op->init_blob, op->init_size); tmp.init_blob = copy_init; tmp.init_size = op->init_size; } }
-    /* 1) локальное подтверждение сразу */
-    fanout_local(r, &tmp);
-    /* 2) рассылка всем клиентам */
-    for (int i=0;i<r->cn;i++){
-        if (r->cl[i].cow){ cow1tcp_send(r->cl[i].cow, &tmp); }
-    }
-    free(copy_data);
-    free(copy_init);
+    leader_relay((LeaderRepl*)rr->impl, op);
 }
 
 static void leader_set_listener(Replicator* rr, TopicId topic, ReplicatorConfirmCb cb, void* user){
@@ -275,6 +519,27 @@ static int leader_health(Replicator* rr){
     return ((intptr_t)r->listen_fd >= 0) ? 0 : -1;
 }
 
+int repl_leader_tcp_lag_stat(Replicator* rr, int* out_lagging, uint64_t* out_lagged){
+    if (!rr) return -1;
+    LeaderRepl* r = (LeaderRepl*)rr->impl; if (!r) return -1;
+    int n = 0;
+    for (int i=0;i<r->cn;i++) if (r->cl[i]->lagging || r->cl[i]->snap) n++;
+    if (out_lagging) *out_lagging = n;
+    if (out_lagged)  *out_lagged  = r->lagged;
+    return 0;
+}
+
+int repl_leader_tcp_stat(Replicator* rr, uint64_t* out_seq, int* out_log_ops,
+                         uint64_t* out_replayed, uint64_t* out_snapshots){
+    if (!rr) return -1;
+    LeaderRepl* r = (LeaderRepl*)rr->impl; if (!r) return -1;
+    if (out_seq)       *out_seq       = r->seq;
+    if (out_log_ops)   *out_log_ops   = (int)r->llen;
+    if (out_replayed)  *out_replayed  = r->replayed;
+    if (out_snapshots) *out_snapshots = r->snapshots;
+    return 0;
+}
+
 static const ReplicatorVt LEADER_VT = {
     .destroy      = leader_destroy,
     .publish      = leader_publish,
@@ -289,8 +554,11 @@ Replicator* replicator_create_leader_tcp(NetPoller* np, uint64_t console_id, uin
     if (!np) return NULL;
     LeaderRepl* impl = (LeaderRepl*)calloc(1, sizeof(*impl));
     if (!impl) return NULL;
+    static uint64_t s_nonce = 0;
     impl->np = np;
     impl->console_id = console_id;
+    impl->epoch = mix64((uint64_t)(uintptr_t)impl ^ ((uint64_t)time(NULL) << 20) ^ (++s_nonce * 0x9E3779B97F4A7C15ULL) ^ console_id) | 1u;
+    impl->topics[impl->tn++] = (TopicId){ 1, console_id }; /* консоль: CONSOLE=1 */
     impl->listen_fd = tcp_listen(port, 64);
     if ((intptr_t)impl->listen_fd < 0){
         free(impl);
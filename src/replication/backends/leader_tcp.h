@@ -16,14 +16,32 @@ extern "C" {
      * @param port       порт для прослушивания
      * @return           Replicator* с vtable LEADER_VT или NULL при ошибке
      *
+     * Op потока нумеруются (seq) и хранятся в журнале-кольце (LEADER_LOG_OPS /
+     * LEADER_LOG_BYTES); клиент с HELO v2 продолжает поток с последнего seq.
+     *
      * На Emscripten возвращает NULL (стаб).
      */
 #if defined(__EMSCRIPTEN__)
     static inline Replicator* replicator_create_leader_tcp(NetPoller* np, uint64_t console_id, uint16_t port){
         (void)np; (void)console_id; (void)port; return NULL;
     }
+    static inline int repl_leader_tcp_stat(Replicator* r, uint64_t* out_seq, int* out_log_ops,
+                                           uint64_t* out_replayed, uint64_t* out_snapshots){
+        (void)r; if(out_seq)*out_seq=0; if(out_log_ops)*out_log_ops=0;
+        if(out_replayed)*out_replayed=0; if(out_snapshots)*out_snapshots=0; return -1;
+    }
+    static inline int repl_leader_tcp_lag_stat(Replicator* r, int* out_lagging, uint64_t* out_lagged){
+        (void)r; if(out_lagging)*out_lagging=0; if(out_lagged)*out_lagged=0; return -1;
+    }
 #else
     Replicator* replicator_create_leader_tcp(NetPoller* np, uint64_t console_id, uint16_t port);
+    /* Журнал потока: seq последней op, op в журнале, сколько op дослано
+       переподключившимся клиентам и сколько раз пришлось откатиться на снапшот */
+    int repl_leader_tcp_stat(Replicator* r, uint64_t* out_seq, int* out_log_ops,
+                             uint64_t* out_replayed, uint64_t* out_snapshots);
+    /* Медленные клиенты: сколько сейчас отстаёт (очередь выше high watermark
+       или ждёт дозакачки) и сколько раз клиенты уходили в отставание */
+    int repl_leader_tcp_lag_stat(Replicator* r, int* out_lagging, uint64_t* out_lagged);
 #endif
 
 #ifdef __cplusplus
@@ -8,26 +8,42 @@
 #ifndef HUB_MAX_BACKENDS
 #  define HUB_MAX_BACKENDS 8
 #endif
-#ifndef HUB_MAX_TOPICS
-#  define HUB_MAX_TOPICS 64
+/* Начальная ёмкость таблицы маршрутов (степень двойки); растёт вдвое */
+#ifndef HUB_ROUTES_INIT_CAP
+#  define HUB_ROUTES_INIT_CAP 64
 #endif
+/* Буфер op на время мягкого свитча: арена кусками по HUB_SWITCH_CHUNK байт, всего
+   не больше HUB_SWITCH_BUF_MAX (дальше op не копим — после свитча уйдёт снапшот) */
+#ifndef HUB_SWITCH_CHUNK
+#  define HUB_SWITCH_CHUNK (64u * 1024u)
+#endif
+#ifndef HUB_SWITCH_BUF_MAX
+#  define HUB_SWITCH_BUF_MAX (8u * 1024u * 1024u)
+#endif
+
+/* Запись арены: заголовок, за ним tag/data/init, на которые смотрит op */
+typedef struct BufOp {
+    ConOp   op;
+    size_t  span;    /* до следующей записи куска (с выравниванием) */
+} BufOp;
+typedef struct BufChunk {
+    struct BufChunk* next;
+    size_t  len, cap;
+    uint64_t buf[];  /* записи BufOp, выровнены по 8 */
+} BufChunk;
 
 typedef struct {
     TopicId               topic;
-    int                   have;   /* 0/1 */
     int                   bidx;   /* выбранный backend index */
+    uint32_t              gen;    /* поколение хаба, для которого выбран bidx */
     ReplicatorConfirmCb   cb;     /* внешний колбэк */
     void*                 user;
-    /* Этап 9: мягкий свитч — блокировка и буфер */
+    /* Этап 9: мягкий свитч — блокировка и буфер (арена: op подряд, освобождается разом) */
     int                   blocked;
-    struct BufOp {
-        ConOp   op;      /* полная копия скаляров */
-        /* NB: tag/data/init скопированы, чтобы безопасно буферизовать */
-        char*   tag;     /* если был */
-        void*   data;    size_t dlen;
-        void*   init;    size_t ilen;
-    } *q;
-    int qn, qcap;
+    BufChunk             *qhead, *qtail;
+    size_t                qbytes;
+    int                   qn;
+    int                   overflow; /* упёрлись в предел: op отброшены, дошлём снапшот */
     int required_caps;   // битмаска требований к бэкенду
     int forced_bidx;     // -1 если нет пина
 } TopicRoute;
@@ -37,11 +53,21 @@ typedef struct {
     int             n;
     int             adopt;
     int             required_caps;
-    /* кэш возможностей/здоровья */
+    size_t          switch_cap;  /* предел буфера свитча на маршрут, байт */
+    uint64_t        switch_overflows;
+    /* кэш возможностей/здоровья: перечитывается, только когда бэкенд сообщил о смене */
     int             caps[HUB_MAX_BACKENDS];
-    /* маршруты на темы */
-    TopicRoute      routes[HUB_MAX_TOPICS];
-    int             rn;
+    int             health[HUB_MAX_BACKENDS];
+    uint32_t        gen;        /* растёт на каждое уведомление — выборы маршрутов устаревают */
+    uint32_t        cache_gen;  /* поколение, для которого заполнены caps[]/health[] */
+    /* маршруты на темы: хеш-таблица TopicId → TopicRoute* (открытая адресация);
+       маршрут живёт отдельным блоком — указатель стабилен при росте таблицы */
+    TopicRoute**    rt;
+    size_t          rcap, rn;
+    /* подписчик на смену health/caps самого хаба */
+    ReplicatorChangeCb on_change;
+    void*           change_user;
+    Replicator*     self;
 } HubImpl;
 
 static TopicId topic_from_op(const ConOp* op){
@@ -60,105 +86,150 @@ static TopicId topic_from_op(const ConOp* op){
 /* сравнение TopicId */
 static int topic_eq(TopicId a, TopicId b){ return a.type_id==b.type_id && a.inst_id==b.inst_id; }
 
+/* ===== Таблица маршрутов ===== */
+static size_t topic_hash(TopicId t, size_t mask){
+    uint64_t x = t.type_id * 0x9E3779B185EBCA87ULL ^ t.inst_id;
+    x ^= x>>30; x *= 0xbf58476d1ce4e5b9ULL;   /* xorshift* */
+    x ^= x>>27; x *= 0x94d049bb133111ebULL;
+    x ^= x>>31;
+    return (size_t)(x & (uint64_t)mask);
+}
+static TopicRoute** route_slot(TopicRoute** tab, size_t cap, TopicId t){
+    size_t m = cap - 1;
+    for (size_t i = topic_hash(t, m);; i = (i + 1) & m){
+        if (!tab[i] || topic_eq(tab[i]->topic, t)) return &tab[i];
+    }
+}
+static int route_grow(HubImpl* h){
+    size_t ncap = h->rcap ? h->rcap*2 : HUB_ROUTES_INIT_CAP;
+    TopicRoute** nt = (TopicRoute**)calloc(ncap, sizeof(TopicRoute*));
+    if (!nt) return 0;
+    for (size_t i=0;i<h->rcap;i++){
+        if (h->rt[i]) *route_slot(nt, ncap, h->rt[i]->topic) = h->rt[i];
+    }
+    free(h->rt);
+    h->rt = nt; h->rcap = ncap;
+    return 1;
+}
+static TopicRoute* route_find(HubImpl* h, TopicId t){
+    return h->rcap ? *route_slot(h->rt, h->rcap, t) : NULL;
+}
+/* Найти или создать маршрут; NULL — нет памяти */
+static TopicRoute* route_get(HubImpl* h, TopicId t){
+    TopicRoute* R = route_find(h, t);
+    if (R) return R;
+    if ((h->rn + 1)*2 > h->rcap && !route_grow(h)) return NULL;
+    R = (TopicRoute*)calloc(1, sizeof(TopicRoute));
+    if (!R) return NULL;
+    R->topic = t;
+    R->bidx = -1;
+    R->required_caps = h->required_caps;
+    R->forced_bidx   = -1;
+    *route_slot(h->rt, h->rcap, t) = R;
+    h->rn++;
+    return R;
+}
+
 /* Внутренний колбэк: пробрасываем наружу по найденному route. */
 static void hub_on_confirm(void* user, const ConOp* op){
     HubImpl* h = (HubImpl*)user; if (!h || !op) return;
-    for (int i=0;i<h->rn;i++){
-        if (h->routes[i].have && topic_eq(h->routes[i].topic, topic_from_op(op))) {
-            if (h->routes[i].cb) h->routes[i].cb(h->routes[i].user, op);
-            return;
-        }
-    }
+    TopicRoute* R = route_find(h, topic_from_op(op));
+    if (R && R->cb) R->cb(R->user, op);
 }
 
-/* === Буферизация/клонирование ConOp для мягкого свитча === */
-static void bufop_free(struct BufOp* b){
-    if (!b) return;
-    free(b->tag);    b->tag = NULL;
-    free(b->data);   b->data = NULL; b->dlen = 0;
-    free(b->init);   b->init = NULL; b->ilen = 0;
-    memset(&b->op, 0, sizeof(b->op));
+/* Бэкенд сменил health/caps: все выборы маршрутов пересчитаются при следующей op */
+static void hub_on_backend_change(void* user, Replicator* r){
+    (void)r;
+    HubImpl* h = (HubImpl*)user; if (!h) return;
+    h->gen++;
+    if (h->on_change) h->on_change(h->change_user, h->self);
 }
 
-static int route_queue_push(TopicRoute* r, const ConOp* op){
-    char* tcopy=NULL; void* dcopy=NULL; void* icopy=NULL;
-    size_t dlen=0, ilen=0;
-    /* заранее клонируем */
-    if (op->tag){
-        size_t L = strlen(op->tag);
-        tcopy = (char*)malloc(L+1); if (!tcopy) goto fail;
-        memcpy(tcopy, op->tag, L+1);
-    }
-    if (op->data && op->size){
-        dcopy = malloc(op->size); if(!dcopy) goto fail;
-        memcpy(dcopy, op->data, op->size); dlen = op->size;
-    }
-    if (op->init_blob && op->init_size){
-        icopy = malloc(op->init_size); if(!icopy) goto fail;
-        memcpy(icopy, op->init_blob, op->init_size); ilen = op->init_size;
-    }
-    /* ensure capacity */
-    if (r->qn == r->qcap){
-        int ncap = r->qcap ? r->qcap*2 : 8;
-        void* nb = realloc(r->q, (size_t)ncap * sizeof(*r->q));
-        if (!nb) goto fail;
-        r->q = (struct BufOp*)nb; r->qcap = ncap;
-    }
-    struct BufOp* dst = &r->q[r->qn];
-    memset(dst, 0, sizeof(*dst));
-    dst->op = *op;
-    dst->tag = tcopy; dst->data = dcopy; dst->dlen = dlen; dst->init = icopy; dst->ilen = ilen;
-    if (tcopy) dst->op.tag = tcopy;
-    if (dcopy){ dst->op.data = dcopy; dst->op.size = dlen; }
-    if (icopy){ dst->op.init_blob = icopy; dst->op.init_size = ilen; }
+/* === Буферизация ConOp для мягкого свитча === */
+static size_t bufop_span(size_t n){ return (n + 7u) & ~(size_t)7u; }
+
+/* Скопировать op в хвост арены маршрута; 0 — не влезла (маршрут уходит в overflow) */
+static int route_queue_push(HubImpl* h, TopicRoute* r, const ConOp* op){
+    if (r->overflow) return 0;
+    size_t tlen = op->tag ? strlen(op->tag) + 1 : 0;
+    size_t dlen = (op->data && op->size) ? op->size : 0;
+    size_t ilen = (op->init_blob && op->init_size) ? op->init_size : 0;
+    size_t span = bufop_span(sizeof(BufOp) + tlen + dlen + ilen);
+    if (r->qbytes + span > h->switch_cap){ r->overflow = 1; h->switch_overflows++; return 0; }
+    BufChunk* c = r->qtail;
+    if (!c || c->cap - c->len < span){
+        size_t cap = span > HUB_SWITCH_CHUNK ? span : bufop_span(HUB_SWITCH_CHUNK);
+        BufChunk* nc = (BufChunk*)malloc(sizeof(BufChunk) + cap);
+        if (!nc){ r->overflow = 1; h->switch_overflows++; return 0; }
+        nc->next = NULL; nc->len = 0; nc->cap = cap;
+        if (c) c->next = nc; else r->qhead = nc;
+        r->qtail = c = nc;
+    }
+    BufOp* b = (BufOp*)((unsigned char*)c->buf + c->len);
+    unsigned char* p = (unsigned char*)(b + 1);
+    b->op = *op;
+    b->span = span;
+    b->op.tag = NULL;
+    b->op.data = NULL; b->op.size = 0;
+    b->op.init_blob = NULL; b->op.init_size = 0;
+    if (tlen){ memcpy(p, op->tag, tlen); b->op.tag = (const char*)p; p += tlen; }
+    if (dlen){ memcpy(p, op->data, dlen); b->op.data = p; b->op.size = dlen; p += dlen; }
+    if (ilen){ memcpy(p, op->init_blob, ilen); b->op.init_blob = p; b->op.init_size = ilen; }
+    c->len += span;
+    r->qbytes += span;
     r->qn++;
     return 1;
-fail:
-    free(tcopy); free(dcopy); free(icopy);
-    return 0;
 }
 
+/* Отдать арену целиком */
+static void route_queue_release(TopicRoute* r){
+    for (BufChunk* c = r->qhead; c; ){ BufChunk* nx = c->next; free(c); c = nx; }
+    r->qhead = r->qtail = NULL;
+    r->qbytes = 0; r->qn = 0;
+    r->overflow = 0;
+}
 
-static int hub_choose(HubImpl* h, TopicId topic){
-    /* per-topic настройки по умолчанию: от хаба */
-    int required = h->required_caps;
-    int forced   = -1;
-    /* если у топика уже есть маршрут — используем его политику */
-    for (int i=0;i<h->rn;i++){
-        if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){
-            required = h->routes[i].required_caps;
-            forced   = h->routes[i].forced_bidx;
-            break;
-        }
-    }
-    PolicyCandidate cand[HUB_MAX_BACKENDS];
+/* Перечитать caps/health бэкендов, если с прошлого раза было уведомление */
+static void hub_refresh(HubImpl* h){
+    if (h->cache_gen == h->gen) return;
     for (int i=0;i<h->n;i++){
-        cand[i].r = h->refs[i].r;
-        cand[i].priority = h->refs[i].priority;
-        int caps = 0, hl = -1;
-        if (cand[i].r && cand[i].r->v && cand[i].r->v->capabilities) caps = cand[i].r->v->capabilities(cand[i].r);
-        if (cand[i].r && cand[i].r->v && cand[i].r->v->health)       hl   = cand[i].r->v->health(cand[i].r);
-        cand[i].caps = caps; cand[i].health = hl;
-        h->caps[i] = caps;
+        h->caps[i]   = replicator_capabilities(h->refs[i].r);
+        h->health[i] = replicator_health(h->refs[i].r);
     }
+    h->cache_gen = h->gen;
+}
+
+static int hub_choose(HubImpl* h, const TopicRoute* R){
+    /* per-topic настройки маршрута (по умолчанию — от хаба) */
+    int required = R->required_caps;
+    int forced   = R->forced_bidx;
+    hub_refresh(h);
     /* Если есть принудительный выбор — попытаться его применить, проверив здоровье и cap-ы. */
     if (forced >= 0 && forced < h->n){
-        Replicator* rr = h->refs[forced].r;
-        int caps = 0, hl = -1;
-        if (rr && rr->v && rr->v->capabilities) caps = rr->v->capabilities(rr);
-        if (rr && rr->v && rr->v->health)       hl   = rr->v->health(rr);
-        if (rr && hl==0 && ((caps & required) == required)){
+        if (h->refs[forced].r && h->health[forced]==0 && ((h->caps[forced] & required) == required)){
             return forced;
         }
         /* иначе — падаем на политику выбора */
     }
-    /* обычный выбор по required капам именно этого топика */
-    int idx = repl_policy_default_choose(cand, h->n, required);
-    if (idx < 0){
-        /* fallback: если вообще никого — ничего не делаем */
-        return -1;
+    PolicyCandidate cand[HUB_MAX_BACKENDS];
+    for (int i=0;i<h->n;i++){
+        cand[i].r = h->refs[i].r;
+        cand[i].priority = h->refs[i].priority;
+        cand[i].caps = h->caps[i];
+        cand[i].health = h->health[i];
     }
-    return idx;
+    /* обычный выбор по required капам именно этого топика; -1 — никого */
+    return repl_policy_default_choose(cand, h->n, required);
+}
+
+/* Перевесить маршрут на бэкенд want (listener — вместе с ним) */
+static void route_rebind(HubImpl* h, TopicRoute* R, int want){
+    R->gen = h->gen;
+    if (want == R->bidx) return;
+    int old = R->bidx;
+    if (R->cb && old>=0)  replicator_unset_listener(h->refs[old].r, R->topic);
+    if (R->cb && want>=0) replicator_set_listener(h->refs[want].r, R->topic, hub_on_confirm, h);
+    R->bidx = want;
 }
 
 /* ===== VTable ===== */
@@ -166,11 +237,14 @@ static void hub_destroy(Replicator* rr){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl;
     if (h){
+        for (int i=0;i<h->n;i++) replicator_set_on_change(h->refs[i].r, NULL, NULL);
         /* очистить буферы в маршрутах */
-        for (int i=0;i<h->rn;i++){
-            for (int j=0;j<h->routes[i].qn;j++) bufop_free(&h->routes[i].q[j]);
-            free(h->routes[i].q);
+        for (size_t i=0;i<h->rcap;i++){
+            TopicRoute* R = h->rt[i]; if (!R) continue;
+            route_queue_release(R);
+            free(R);
         }
+        free(h->rt);
         if (h->adopt){
             for (int i=0;i<h->n;i++){
                 if (h->refs[i].r) replicator_destroy(h->refs[i].r);
@@ -184,96 +258,51 @@ static void hub_destroy(Replicator* rr){
 static void hub_publish(Replicator* rr, const ConOp* op){
     if (!rr || !op) return;
     HubImpl* h = (HubImpl*)rr->impl;
-    TopicId t = topic_from_op(op);
     /* найдём/создадим маршрут */
-    int ri = -1;
-    for (int i=0;i<h->rn;i++) if (h->routes[i].have && topic_eq(h->routes[i].topic, t)){ ri=i; break; }
-    if (ri < 0){
-        if (h->rn < HUB_MAX_TOPICS){
-            ri = h->rn++;
-            h->routes[ri].have=1; h->routes[ri].topic = t; h->routes[ri].bidx=-1;
-            h->routes[ri].cb=NULL; h->routes[ri].user=NULL;
-            h->routes[ri].blocked=0; h->routes[ri].q=NULL; h->routes[ri].qn=0; h->routes[ri].qcap=0;
-            h->routes[ri].required_caps = h->required_caps;
-            h->routes[ri].forced_bidx   = -1;
-        }
-    }
+    TopicRoute* R = route_get(h, topic_from_op(op));
+    if (!R) return;
     /* Если идёт мягкий свитч — буферизуем */
-    if (ri>=0 && h->routes[ri].blocked){
-        (void)route_queue_push(&h->routes[ri], op);
+    if (R->blocked){
+        (void)route_queue_push(h, R, op);
         return;
     }
-    int want = hub_choose(h, t);
-    if (ri>=0 && want>=0 && want != h->routes[ri].bidx){
-        /* снять listener со старого бэкенда (если был) */
-        int old = h->routes[ri].bidx;
-        if (h->routes[ri].cb && old>=0 &&
-            h->refs[old].r && h->refs[old].r->v && h->refs[old].r->v->unset_listener)
-        {
-            h->refs[old].r->v->unset_listener(h->refs[old].r, t);
-        }
-        /* переподпишемся на новый бэкенд, если есть внешний listener */
-        if (h->routes[ri].cb && h->refs[want].r && h->refs[want].r->v && h->refs[want].r->v->set_listener){
-            h->refs[want].r->v->set_listener(h->refs[want].r, t, hub_on_confirm, h);
-        }
-        h->routes[ri].bidx = want;
-    }
-    int use = (ri>=0) ? h->routes[ri].bidx : want;
-    if (use>=0 && h->refs[use].r && h->refs[use].r->v && h->refs[use].r->v->publish){
-        h->refs[use].r->v->publish(h->refs[use].r, op);
+    /* выбор кеширован до следующего уведомления о смене health/caps */
+    if (R->gen != h->gen){
+        int want = hub_choose(h, R);
+        if (want >= 0) route_rebind(h, R, want);
+        else R->gen = h->gen;
     }
+    if (R->bidx >= 0) replicator_publish(h->refs[R->bidx].r, op);
 }
 
 static void hub_set_listener(Replicator* rr, TopicId topic, ReplicatorConfirmCb cb, void* user){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl;
     /* найти/создать маршрут */
-    int ri = -1;
-    for (int i=0;i<h->rn;i++) if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){ ri=i; break; }
-    if (ri < 0){
-        if (h->rn < HUB_MAX_TOPICS){
-            ri = h->rn++; h->routes[ri].have=1; h->routes[ri].topic = topic; h->routes[ri].bidx=-1;
-            h->routes[ri].cb=NULL; h->routes[ri].user=NULL;
-            h->routes[ri].blocked=0; h->routes[ri].q=NULL; h->routes[ri].qn=0; h->routes[ri].qcap=0;
-            h->routes[ri].required_caps = h->required_caps;
-            h->routes[ri].forced_bidx   = -1;
-        }
-    }
-    if (ri < 0) return;
+    TopicRoute* R = route_get(h, topic);
+    if (!R) return;
     /* запомним прежний бэкенд маршрута, чтобы корректно снять listener */
-    int old = h->routes[ri].bidx;
-    h->routes[ri].cb = cb;
-    h->routes[ri].user = user;
+    int old = R->bidx;
+    R->cb = cb;
+    R->user = user;
     /* выбрать лучший и подписаться */
-    int idx = hub_choose(h, topic);
+    int idx = hub_choose(h, R);
     /* если меняем бэкенд — снять listener со старого */
-    if (old>=0 && idx!=old &&
-        h->refs[old].r && h->refs[old].r->v && h->refs[old].r->v->unset_listener)
-    {
-        h->refs[old].r->v->unset_listener(h->refs[old].r, topic);
-    }
-    h->routes[ri].bidx = idx;
-    if (idx>=0 && h->refs[idx].r && h->refs[idx].r->v && h->refs[idx].r->v->set_listener){
-        h->refs[idx].r->v->set_listener(h->refs[idx].r, topic, hub_on_confirm, h);
-    }
+    if (old>=0 && idx!=old) replicator_unset_listener(h->refs[old].r, topic);
+    R->bidx = idx;
+    R->gen = h->gen;
+    if (idx>=0) replicator_set_listener(h->refs[idx].r, topic, hub_on_confirm, h);
 }
 
 static void hub_unset_listener(Replicator* rr, TopicId topic){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl;
-    for (int i=0;i<h->rn;i++){
-        TopicRoute* R = &h->routes[i];
-        if (R->have && topic_eq(R->topic, topic)){
-            /* снять listener на активном бэкенде, если поддерживает */
-            int b = R->bidx;
-            if (b>=0 && h->refs[b].r && h->refs[b].r->v && h->refs[b].r->v->unset_listener){
-                h->refs[b].r->v->unset_listener(h->refs[b].r, topic);
-            }
-            R->cb = NULL;
-            R->user = NULL;
-            return;
-        }
-    }
+    TopicRoute* R = route_find(h, topic);
+    if (!R) return;
+    /* снять listener на активном бэкенде, если поддерживает */
+    if (R->bidx>=0) replicator_unset_listener(h->refs[R->bidx].r, topic);
+    R->cb = NULL;
+    R->user = NULL;
 }
 
 static int hub_capabilities(Replicator* rr){
@@ -300,6 +329,12 @@ static int hub_health(Replicator* rr){
     return -1;
 }
 
+static void hub_set_on_change(Replicator* rr, ReplicatorChangeCb cb, void* user){
+    if (!rr) return;
+    HubImpl* h = (HubImpl*)rr->impl; if (!h) return;
+    h->on_change = cb; h->change_user = user;
+}
+
 static const ReplicatorVt HUB_VT = {
     .destroy      = hub_destroy,
     .publish      = hub_publish,
@@ -307,6 +342,7 @@ static const ReplicatorVt HUB_VT = {
     .unset_listener = hub_unset_listener,
     .capabilities = hub_capabilities,
     .health       = hub_health,
+    .set_on_change = hub_set_on_change,
 };
 
 Replicator* replicator_create_hub(const ReplBackendRef* backends, int n_backends,
@@ -319,159 +355,103 @@ Replicator* replicator_create_hub(const ReplBackendRef* backends, int n_backends
     h->n = n_backends;
     h->adopt = adopt_backends ? 1 : 0;
     h->required_caps = required_caps;
-    /* Дефолты для всех потенциальных маршрутов */
-    h->rn = 0;
-    for (int i=0;i<HUB_MAX_TOPICS;i++){
-        h->routes[i].have = 0;
-        h->routes[i].bidx = -1;
-        h->routes[i].cb = NULL; h->routes[i].user = NULL;
-        h->routes[i].blocked = 0;
-        h->routes[i].q = NULL; h->routes[i].qn = 0; h->routes[i].qcap = 0;
-        h->routes[i].required_caps = required_caps;
-        h->routes[i].forced_bidx   = -1;
-    }
+    h->switch_cap = HUB_SWITCH_BUF_MAX;
+    h->gen = 1; /* cache_gen=0: первый выбор перечитает caps/health */
     Replicator* r = (Replicator*)calloc(1, sizeof(Replicator));
     if (!r){ free(h); return NULL; }
     r->v = &HUB_VT;
     r->impl = h;
+    h->self = r;
+    for (int i=0;i<h->n;i++) replicator_set_on_change(h->refs[i].r, hub_on_backend_change, h);
     return r;
 }
 
+void replhub_notify_backend_changed(Replicator* rr){
+    if (!rr) return;
+    hub_on_backend_change(rr->impl, NULL);
+}
+
 
 
 /* ===== мягкий свитч бэкенда ===== */
+/* Снапшот топика по type_registry (если тип его умеет) — в бэкенд to */
+static void route_send_snapshot(HubImpl* h, TopicId topic, int to){
+    void* user = NULL;
+    const TypeVt* vt = type_registry_get_default(topic.type_id, &user);
+    if (!vt || !vt->snapshot) return;
+    void* blob=NULL; size_t blen=0; uint32_t schema=0;
+    if (vt->snapshot(user, &schema, &blob, &blen) == 0 && blob && blen>0){
+        ConOp sop = (ConOp){0};
+        sop.topic = topic;
+        sop.console_id = topic.inst_id;
+        sop.schema = schema;        // <--- теперь несём версию
+        sop.tag = "snapshot";
+        sop.init_blob = blob; sop.init_size = blen;
+        replicator_publish(h->refs[to].r, &sop);
+    }
+    free(blob);
+}
+
 void replhub_switch_backend(Replicator* rr, TopicId topic, int to_backend){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl; if (!h) return;
     /* найти/создать маршрут */
-    int ri = -1;
-    for (int i=0;i<h->rn;i++) if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){ ri=i; break; }
-    if (ri < 0){
-        if (h->rn >= HUB_MAX_TOPICS) return;
-        ri = h->rn++;
-        h->routes[ri].have=1; h->routes[ri].topic=topic; h->routes[ri].bidx=-1;
-        h->routes[ri].cb=NULL; h->routes[ri].user=NULL;
-        h->routes[ri].blocked=0; h->routes[ri].q=NULL; h->routes[ri].qn=0; h->routes[ri].qcap=0;
-        h->routes[ri].required_caps = h->required_caps;
-        h->routes[ri].forced_bidx   = -1;
-    }
-    TopicRoute* R = &h->routes[ri];
+    TopicRoute* R = route_get(h, topic);
+    if (!R) return;
     /* блокируем публикации */
     R->blocked = 1;
     /* выбрать целевой бэкенд */
     int to = to_backend;
     if (to < 0 || to >= h->n){
-        to = hub_choose(h, topic);
+        to = hub_choose(h, R);
         if (to < 0){ R->blocked = 0; return; }
     }
     /* снапшот по типу (если доступен) */
-    void* user = NULL;
-    const TypeVt* vt = type_registry_get_default(topic.type_id, &user);
-    if (vt && vt->snapshot){
-        void* blob=NULL; size_t blen=0; uint32_t schema=0;
-        if (vt->snapshot(user, &schema, &blob, &blen) == 0 && blob && blen>0){
-            ConOp sop = (ConOp){0};
-            sop.topic = topic;
-            sop.console_id = topic.inst_id;
-            sop.schema = schema;        // <--- теперь несём версию
-            sop.tag = "snapshot";
-            sop.init_blob = blob; sop.init_size = blen;
-            replicator_publish(h->refs[to].r, &sop);
-            free(blob);
+    route_send_snapshot(h, topic, to);
+    /* перевесить listener (если был); выбор держится до смены health/caps */
+    route_rebind(h, R, to);
+    /* дослать буфер по порядку. Маршрут ещё заблокирован: op, пришедшие из
+       колбэков во время досылки, встают в хвост арены и уходят в этом же проходе */
+    for (BufChunk* c = R->qhead; c && !R->overflow; c = c->next){
+        for (size_t off = 0; off < c->len && !R->overflow; ){
+            const BufOp* b = (const BufOp*)((const unsigned char*)c->buf + off);
+            off += b->span;
+            replicator_publish(h->refs[R->bidx].r, &b->op);
         }
     }
-    /* перевесить listener (если был) */
-    {
-        int from = R->bidx;
-        if (R->cb && from>=0 &&
-            h->refs[from].r && h->refs[from].r->v && h->refs[from].r->v->unset_listener)
-        {
-            h->refs[from].r->v->unset_listener(h->refs[from].r, topic);
-        }
-    }
-    if (R->cb && h->refs[to].r && h->refs[to].r->v && h->refs[to].r->v->set_listener){
-        h->refs[to].r->v->set_listener(h->refs[to].r, topic, hub_on_confirm, h);
-    }
-    R->bidx = to;
-    /* разблокировать и дослать буфер */
+    /* буфер переполнился — часть op потеряна, состояние передаём снапшотом */
+    int overflow = R->overflow;
+    route_queue_release(R);
     R->blocked = 0;
-    if (R->bidx>=0 && h->refs[R->bidx].r && h->refs[R->bidx].r->v && h->refs[R->bidx].r->v->publish){
-        for (int i=0;i<R->qn;i++){
-            h->refs[R->bidx].r->v->publish(h->refs[R->bidx].r, &R->q[i].op);
-            bufop_free(&R->q[i]);
-        }
-    }
-    free(R->q); R->q=NULL; R->qn=R->qcap=0;
+    if (overflow) route_send_snapshot(h, topic, R->bidx);
+}
+
+void replhub_set_switch_buffer_cap(Replicator* rr, size_t max_bytes){
+    if (!rr) return;
+    HubImpl* h = (HubImpl*)rr->impl; if (!h) return;
+    h->switch_cap = max_bytes ? max_bytes : HUB_SWITCH_BUF_MAX;
 }
 
 /* === Per-topic политика: требования по возможностям === */
 void replhub_set_topic_caps(Replicator* rr, TopicId topic, int required_caps){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl; if (!h) return;
-    /* найти/создать маршрут */
-    int ri = -1;
-    for (int i=0;i<h->rn;i++) if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){ ri=i; break; }
-    if (ri < 0){
-        if (h->rn >= HUB_MAX_TOPICS) return;
-        ri = h->rn++;
-        h->routes[ri].have=1; h->routes[ri].topic=topic; h->routes[ri].bidx=-1;
-        h->routes[ri].cb=NULL; h->routes[ri].user=NULL;
-        h->routes[ri].blocked=0; h->routes[ri].q=NULL; h->routes[ri].qn=0; h->routes[ri].qcap=0;
-        h->routes[ri].required_caps = h->required_caps;
-        h->routes[ri].forced_bidx   = -1;
-    }
-    TopicRoute* R = &h->routes[ri];
+    TopicRoute* R = route_get(h, topic);
+    if (!R) return;
     R->required_caps = required_caps;
     /* Перевыбор и перевешивание listener’а при необходимости */
-    int want = hub_choose(h, topic);
-    if (want != R->bidx){
-        /* снять listener со старого бэкенда, если он был */
-        int old = R->bidx;
-        if (R->cb && old>=0 &&
-            h->refs[old].r && h->refs[old].r->v && h->refs[old].r->v->unset_listener)
-        {
-            h->refs[old].r->v->unset_listener(h->refs[old].r, topic);
-        }
-        if (R->cb && want>=0 && h->refs[want].r && h->refs[want].r->v && h->refs[want].r->v->set_listener){
-            h->refs[want].r->v->set_listener(h->refs[want].r, topic, hub_on_confirm, h);
-        }
-        R->bidx = want;
-    }
+    route_rebind(h, R, hub_choose(h, R));
 }
 
 /* === Per-topic политика: принудительный бэкенд (пин) === */
 void replhub_force_backend(Replicator* rr, TopicId topic, int backend_index){
     if (!rr) return;
     HubImpl* h = (HubImpl*)rr->impl; if (!h) return;
-    /* найти/создать маршрут */
-    int ri = -1;
-    for (int i=0;i<h->rn;i++) if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){ ri=i; break; }
-    if (ri < 0){
-        if (h->rn >= HUB_MAX_TOPICS) return;
-        ri = h->rn++;
-        h->routes[ri].have=1; h->routes[ri].topic=topic; h->routes[ri].bidx=-1;
-        h->routes[ri].cb=NULL; h->routes[ri].user=NULL;
-        h->routes[ri].blocked=0; h->routes[ri].q=NULL; h->routes[ri].qn=0; h->routes[ri].qcap=0;
-        h->routes[ri].required_caps = h->required_caps;
-        h->routes[ri].forced_bidx   = -1;
-    }
-    TopicRoute* R = &h->routes[ri];
+    TopicRoute* R = route_get(h, topic);
+    if (!R) return;
     R->forced_bidx = backend_index; /* -1 снимает пин */
     /* Перевыбор и перевешивание listener’а при необходимости */
-    int want = hub_choose(h, topic);
-    if (want != R->bidx){
-        /* снять listener со старого бэкенда, если он был */
-        int old = R->bidx;
-        if (R->cb && old>=0 &&
-            h->refs[old].r && h->refs[old].r->v && h->refs[old].r->v->unset_listener)
-        {
-            h->refs[old].r->v->unset_listener(h->refs[old].r, topic);
-        }
-        if (R->cb && want>=0 && h->refs[want].r && h->refs[want].r->v && h->refs[want].r->v->set_listener){
-            h->refs[want].r->v->set_listener(h->refs[want].r, topic, hub_on_confirm, h);
-        }
-        R->bidx = want;
-    }
+    route_rebind(h, R, hub_choose(h, R));
 }
 
 
@@ -499,12 +479,20 @@ int replhub_debug_backend_info(Replicator* rr, int idx, int* out_priority, int*
 int replhub_debug_route_backend(Replicator* rr, TopicId topic){
     if (!rr) return -1;
     HubImpl* h = (HubImpl*)rr->impl; if (!h) return -1;
-    for (int i=0;i<h->rn;i++){
-        if (h->routes[i].have && topic_eq(h->routes[i].topic, topic)){
-            return h->routes[i].bidx;
-        }
-    }
-    return -1;
+    TopicRoute* R = route_find(h, topic);
+    return R ? R->bidx : -1;
+}
+
+int replhub_debug_count_routes(Replicator* rr){
+    if (!rr) return 0;
+    HubImpl* h = (HubImpl*)rr->impl;
+    return h ? (int)h->rn : 0;
+}
+
+uint64_t replhub_debug_switch_overflows(Replicator* rr){
+    if (!rr) return 0;
+    HubImpl* h = (HubImpl*)rr->impl;
+    return h ? h->switch_overflows : 0;
 }
 
 Replicator* replhub_debug_get_backend(Replicator* rr, int idx){
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 #include "replication/repl_iface.h"
 
 #ifdef __cplusplus
@@ -24,15 +25,24 @@ extern "C" {
      * - Блокирует publish(topик) и буферизует входящие операции.
      * - Если для type_id зарегистрирован snapshot(), берёт снапшот и
      *   публикует его в новый бэкенд как ConOp{ topic=..., console_id=inst_id, init_blob=... }.
-     * - Перевешивает listener на новый бэкенд, разблокирует publish
-     *   и досылает накопленный буфер по порядку.
+     * - Перевешивает listener на новый бэкенд, досылает накопленный буфер
+     *   по порядку (op, пришедшие во время досылки, — за ним) и разблокирует publish.
      */
     void replhub_switch_backend(Replicator* hub, TopicId topic, int to_backend /* index в backends[] или <0 выбрать политикой */);
+    /* Op на время свитча копятся в арене маршрута (одним куском, освобождается
+       разом после досылки) не больше max_bytes (0 — HUB_SWITCH_BUF_MAX). Сверх
+       предела op отбрасываются, а после свитча новому бэкенду уходит снапшот. */
+    void replhub_set_switch_buffer_cap(Replicator* hub, size_t max_bytes);
 
 
     void replhub_set_topic_caps(Replicator* hub, TopicId topic, int required_caps);
     void replhub_force_backend(Replicator* hub, TopicId topic, int backend_index /* -1 снять пин */);
 
+    /* Маршруты топиков кешируют выбор бэкенда; пересчёт — когда бэкенд сообщит о
+       смене health/caps (ReplicatorVt.set_on_change). Для бэкенда без такого
+       уведомления владелец зовёт это сам. */
+    void replhub_notify_backend_changed(Replicator* hub);
+
     /* ===== Debug/информация (для UI/консоли) ===== */
     /* Количество известных Hub’у бэкендов. */
     int  replhub_debug_count_backends(Replicator* hub);
@@ -40,6 +50,10 @@ extern "C" {
     int  replhub_debug_backend_info(Replicator* hub, int idx, int* out_priority, int* out_caps, int* out_health);
     /* Текущий выбранный бэкенд для topic (или -1, если ещё не выбран/нет). */
     int  replhub_debug_route_backend(Replicator* hub, TopicId topic);
+    /* Сколько топиков в таблице маршрутов. */
+    int  replhub_debug_count_routes(Replicator* hub);
+    /* Сколько раз буфер мягкого свитча переполнялся (откат на снапшот). */
+    uint64_t replhub_debug_switch_overflows(Replicator* hub);
 
     /* Получить «живую» ручку бэкенда по индексу (для отладочных команд). */
     Replicator* replhub_debug_get_backend(Replicator* hub, int idx);
@@ -11,6 +11,9 @@ extern "C" {
     typedef struct Replicator Replicator;
     typedef struct ReplicatorVt ReplicatorVt;
 
+    /* Бэкенд сменил health()/capabilities() */
+    typedef void (*ReplicatorChangeCb)(void* user, Replicator* r);
+
     struct Replicator {
         const ReplicatorVt* v;
         void* impl;  // приватная реализация конкретного бэкенда
@@ -23,6 +26,9 @@ extern "C" {
         void (*unset_listener)(Replicator*, TopicId);
         int  (*capabilities)(Replicator*); // битовая маска ReplCaps
         int  (*health)(Replicator*);       // 0=OK, !=0 — код деградации
+        // необязательно: один подписчик на смену health/caps (cb=NULL — снять).
+        // Без него health/caps бэкенда считаются неизменными (Hub кеширует выбор)
+        void (*set_on_change)(Replicator*, ReplicatorChangeCb cb, void* user);
     };
 
 // Удобные thin-wrappers
@@ -44,6 +50,10 @@ extern "C" {
 
     static inline int  replicator_health(Replicator* r){ return (r && r->v && r->v->health) ? r->v->health(r) : -1; }
 
+    static inline void replicator_set_on_change(Replicator* r, ReplicatorChangeCb cb, void* u){
+        if (r && r->v && r->v->set_on_change) r->v->set_on_change(r, cb, u);
+    }
+
 #ifdef __cplusplus
 }
 #endif
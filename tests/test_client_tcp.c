@@ -0,0 +1,239 @@
+// tests/test_client_tcp.c
+/* Таймеры поллера, расписание переподключения и outbox клиента. Внутренности
+   клиента (backoff, outbox) берём static'ами прямо из client_tcp.c */
+#include "replication/backends/client_tcp.c"
+#include "replication/backends/leader_tcp.h"
+#include "net/net_timer.h"
+#include <assert.h>
+#include <stdio.h>
+#if defined(_WIN32)
+#  include <winsock2.h>
+#else
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#endif
+
+/* ===== net_timer.h ===== */
+static NetTimers g_ts;
+static int g_fired[4];
+
+static void t_count(void* u, uint32_t now){ (void)now; (*(int*)u)++; }
+/* взводит себя заново на «уже наступило» */
+static void t_rearm(void* u, uint32_t now){ (*(int*)u)++; net_timers_set(&g_ts, now, t_rearm, u); }
+/* снимает соседа и ставит новый таймер на «уже наступило» */
+static void t_meddle(void* u, uint32_t now){
+    (*(int*)u)++;
+    net_timers_cancel(&g_ts, t_count, &g_fired[1]);
+    net_timers_set(&g_ts, now, t_count, &g_fired[2]);
+}
+
+static void test_timers(void){
+    int a = 0, b = 0;
+    net_timers_set(&g_ts, 10, t_count, &a);
+    net_timers_set(&g_ts, 20, t_count, &b);
+    net_timers_run(&g_ts, 9);  assert(a == 0 && b == 0);
+    net_timers_run(&g_ts, 10); assert(a == 1 && b == 0 && g_ts.n == 1);
+    /* тот же (cb, user) — перенос срока, не второй таймер */
+    net_timers_set(&g_ts, 30, t_count, &b);
+    assert(g_ts.n == 1);
+    net_timers_run(&g_ts, 25); assert(b == 0);
+    net_timers_cancel(&g_ts, t_count, &b);
+    net_timers_run(&g_ts, 40); assert(b == 0 && g_ts.n == 0);
+    /* срок за переполнением u32 */
+    net_timers_set(&g_ts, 5, t_count, &a);
+    net_timers_run(&g_ts, 0xFFFFFFF0u); assert(a == 1);
+    net_timers_run(&g_ts, 5);           assert(a == 2);
+
+    /* взведённый из колбэка на «уже наступило» ждёт следующего run */
+    int r = 0;
+    net_timers_set(&g_ts, 100, t_rearm, &r);
+    net_timers_run(&g_ts, 100); assert(r == 1 && g_ts.n == 1);
+    net_timers_run(&g_ts, 100); assert(r == 2);
+    net_timers_cancel(&g_ts, t_rearm, &r);
+
+    /* колбэк снял наступивший таймер — тот не срабатывает; новый — только в следующем run */
+    net_timers_set(&g_ts, 200, t_meddle, &g_fired[0]);
+    net_timers_set(&g_ts, 200, t_count, &g_fired[1]);
+    net_timers_run(&g_ts, 200);
+    assert(g_fired[0] == 1 && g_fired[1] == 0 && g_fired[2] == 0 && g_ts.n == 1);
+    net_timers_run(&g_ts, 200);
+    assert(g_fired[2] == 1 && g_ts.n == 0);
+    net_timers_free(&g_ts);
+}
+
+/* ===== loopback ===== */
+enum { CID = 77 };
+static NetPoller* g_np;
+static uint32_t   g_now;
+
+static void spin_ms(int ticks, int budget_ms){
+    for (int i = 0; i < ticks; i++){ net_poller_tick(g_np, ++g_now, budget_ms); cow1tcp_flush_pending(); }
+}
+static void spin(int ticks){ spin_ms(ticks, 0); }
+/* Порт, на котором заведомо никто не слушает */
+static uint16_t closed_port(void){
+    tcp_fd_t fd = tcp_listen(0, 1);
+    assert((intptr_t)fd >= 0);
+    struct sockaddr_in sa; socklen_t sl = sizeof(sa);
+    getsockname(fd, (struct sockaddr*)&sa, &sl);
+    uint16_t port = ntohs(sa.sin_port);
+    tcp_close(fd);
+    return port;
+}
+
+/* Попытки к закрытому порту: задержка удваивается от MIN до MAX, срок — в [d/2, d] */
+static void test_backoff(void){
+    g_np = net_poller_create(); g_now = 1;
+    spin(1);
+    Replicator* R = replicator_create_client_tcp(g_np, CID, NULL, 0);
+    CliImpl* c = (CliImpl*)R->impl;
+    repl_client_tcp_connect(R, "127.0.0.1", closed_port());
+    static const uint32_t want[] = { 100, 200, 400, 800, 1600, 3200, 6400, 10000, 10000, 10000 };
+    enum { N = sizeof(want) / sizeof(want[0]) };
+    /* каждое планирование сдвигает xorshift — по нему и видим попытки */
+    uint32_t rng = c->rng, t_prev = 0, d_prev = 0, spread = 0;
+    int k = 0;
+    while (k < N && g_now < 100000){
+        spin(1);
+        if (c->rng == rng) continue;
+        if (k){
+            uint32_t dt = g_now - t_prev;
+            assert(dt + 1 >= d_prev / 2 && dt <= d_prev + 2);
+            if (dt + 1 < d_prev) spread++;
+        }
+        assert(c->backoff_ms == (want[k] >= CLIENT_RECONNECT_MAX_MS / 2 ? CLIENT_RECONNECT_MAX_MS : want[k] * 2));
+        rng = c->rng; t_prev = g_now; d_prev = want[k];
+        k++;
+    }
+    assert(k == N && spread > 0); /* джиттер есть */
+    assert(c->st == ST_IDLE || c->st == ST_CONNECTING);
+    /* disconnect гасит расписание */
+    repl_client_tcp_disconnect(R);
+    rng = c->rng;
+    spin(CLIENT_RECONNECT_MAX_MS + 10);
+    assert(c->rng == rng && c->st == ST_IDLE);
+    replicator_destroy(R);
+    net_poller_destroy(g_np);
+}
+
+/* Слушатель лидера: сколько раз каждая op применена */
+static uint8_t g_applied[512];
+static void on_leader(void* u, const ConOp* op){
+    (void)u;
+    assert(op->op_id > 0 && op->op_id < sizeof(g_applied));
+    g_applied[op->op_id]++;
+}
+/* len > 0 — текстовые op с payload'ом, иначе PROMPT_META */
+static void pub(Replicator* r, uint64_t* id, int n, size_t len){
+    static char text[256];
+    memset(text, 'x', sizeof(text));
+    for (int i = 0; i < n; i++){
+        ConOp op = {0};
+        op.topic = (TopicId){ 1, CID }; op.console_id = CID; op.actor_id = 1;
+        op.op_id = ++*id;
+        op.type = len ? CON_OP_INSERT_TEXT : CON_OP_PROMPT_META;
+        op.data = len ? text : NULL; op.size = len;
+        replicator_publish(r, &op);
+    }
+}
+/* Ожидания — с реальным временем в poll: loopback тоже теряет сегменты,
+   а повтор у TCP приходит не раньше RTO (~200 мс) */
+static int wait_up(Replicator* R){
+    for (int i = 0; i < 3000 && !repl_client_tcp_is_connected(R); i++) spin_ms(1, 1);
+    return repl_client_tcp_is_connected(R);
+}
+static void wait_echo(const CliImpl* c){
+    for (int i = 0; i < 3000 && c->obn; i++) spin_ms(1, 1);
+}
+
+/* Обрыв с op без эха: после переподключения лидер применяет каждую ровно раз */
+static void test_reconnect(void){
+    g_np = net_poller_create(); g_now = 1;
+    Replicator* L = NULL; uint16_t port;
+    for (port = 47651; port < 47671 && !L; port++) L = replicator_create_leader_tcp(g_np, CID, port);
+    assert(L);
+    replicator_set_listener(L, (TopicId){ 1, CID }, on_leader, NULL);
+    spin(1);
+    Replicator* R = replicator_create_client_tcp(g_np, CID, "127.0.0.1", (uint16_t)(port - 1));
+    CliImpl* c = (CliImpl*)R->impl;
+    assert(wait_up(R));
+
+    uint64_t id = 0;
+    pub(R, &id, 5, 0);
+    assert(c->obn == 5 && c->obsent == 5); /* ждут эха */
+    wait_echo(c);
+    assert(c->obn == 0 && c->obbytes == 0);
+    for (uint64_t i = 1; i <= id; i++) assert(g_applied[i] == 1);
+
+    /* ушли в очередь, но связь рвётся раньше, чем они в сокете */
+    pub(R, &id, 3, 0);
+    assert(c->obn == 3 && c->obsent == 3);
+    cli_drop(c);
+    assert(c->obn == 3 && c->obsent == 0 && c->st == ST_IDLE);
+    /* без связи копятся за ними */
+    pub(R, &id, 2, 0);
+    assert(c->obn == 5 && c->obsent == 0);
+    assert(wait_up(R));
+    wait_echo(c);
+    assert(c->obn == 0);
+    for (uint64_t i = 1; i <= id; i++) assert(g_applied[i] == 1);
+    uint64_t reconn = 0;
+    repl_client_tcp_stat(R, NULL, NULL, NULL, &reconn);
+    assert(reconn == 1 && repl_client_tcp_last_seq(R) == id);
+
+    /* лидер op получил и применил, но эхо ещё в его очереди — обрыв. Досылка ждёт
+       head из WLCM: эхо в дозакачке снимает их из outbox, второй раз они не уходят */
+    uint64_t first = id + 1;
+    pub(R, &id, 3, 0);
+    cow1tcp_flush_pending();
+    for (int i = 0; i < 3000 && !g_applied[id]; i++) net_poller_tick(g_np, ++g_now, 1);
+    for (uint64_t i = first; i <= id; i++) assert(g_applied[i] == 1);
+    assert(c->obn == 3);
+    cli_drop(c);
+    pub(R, &id, 2, 0);
+    assert(wait_up(R));
+    wait_echo(c);
+    assert(c->obn == 0 && !c->hold);
+    for (uint64_t i = 1; i <= id; i++) assert(g_applied[i] == 1);
+    assert(repl_client_tcp_last_seq(R) == id);
+
+    replicator_destroy(R); replicator_destroy(L);
+    net_poller_destroy(g_np);
+}
+
+/* Очередь к лидеру выше high: outbox держит хвост и досылает его по on_pressure(0) */
+static void test_pressure(void){
+    g_np = net_poller_create(); g_now = 1;
+    memset(g_applied, 0, sizeof(g_applied));
+    Replicator* L = NULL; uint16_t port;
+    for (port = 47671; port < 47691 && !L; port++) L = replicator_create_leader_tcp(g_np, CID, port);
+    assert(L);
+    replicator_set_listener(L, (TopicId){ 1, CID }, on_leader, NULL);
+    spin(1);
+    Replicator* R = replicator_create_client_tcp(g_np, CID, "127.0.0.1", (uint16_t)(port - 1));
+    CliImpl* c = (CliImpl*)R->impl;
+    assert(wait_up(R));
+    cow1tcp_set_watermarks(c->cow, 4096, 1024);
+
+    uint64_t id = 0;
+    pub(R, &id, 200, 200);
+    /* в очередь встало чуть больше high, остальное ждёт в outbox */
+    assert(c->obn == 200 && c->obsent > 0 && c->obsent < 40);
+    assert(cow1tcp_queued(c->cow) >= 4096);
+    wait_echo(c);
+    assert(c->obn == 0 && c->obbytes == 0);
+    for (uint64_t i = 1; i <= id; i++) assert(g_applied[i] == 1);
+
+    replicator_destroy(R); replicator_destroy(L);
+    net_poller_destroy(g_np);
+}
+
+int main(void){
+    tcp_init();
+    test_timers();
+    test_backoff();
+    test_reconnect();
+    test_pressure();
+    printf("OK: net timers + client_tcp reconnect/outbox/pressure\n");
+    return 0;
+}
@@ -95,6 +95,50 @@ static void test_streaming_chunks(void){
     free(buf);
 }
 
+/* Кадр почти без payload (tag+data+init < 6 байт) тоже должен разбираться */
+static void test_tiny_frame(void){
+    ConOp in = make_op_basic();
+    in.tag = "t"; in.data = "x"; in.size = 1;
+    uint8_t* buf = NULL; size_t len = 0;
+    assert(conop_wire_encode(&in, &buf, &len) == 0);
+    ConOp out;
+    assert(conop_wire_decode_view(buf, len, &out) == 0);
+    assert(out.tag && strcmp(out.tag, "t")==0);
+    assert(out.size == 1 && memcmp(out.data, "x", 1)==0);
+    free(buf);
+}
+
+/* Пачка кадров в одном куске + хвост в следующем: view-декодирование */
+static void test_streaming_view(void){
+    ConOp in = make_op_basic();
+    uint8_t* one = NULL; size_t len = 0;
+    assert(conop_wire_encode(&in, &one, &len) == 0);
+    enum { N = 50 };
+    uint8_t* burst = (uint8_t*)malloc(len * N);
+    for (int i=0;i<N;i++) memcpy(burst + (size_t)i*len, one, len);
+
+    Cow1Decoder d; cow1_decoder_init(&d);
+    size_t split = len * (N/2) + len/3; /* середина кадра */
+    int taken = 0;
+    for (int part=0; part<2; part++){
+        if (part==0) cow1_decoder_consume(&d, burst, split);
+        else         cow1_decoder_consume(&d, burst + split, len*N - split);
+        ConOp out;
+        while (cow1_decoder_take_view(&d, &out) == 1){
+            assert(out.op_id == in.op_id);
+            assert(out.pos.comp[1].actor == in.pos.comp[1].actor);
+            assert(out.tag && strcmp(out.tag, "cw.delta")==0);
+            assert(out.size == in.size && memcmp(out.data, in.data, in.size)==0);
+            assert(out.init_blob == NULL && out.init_size == 0);
+            taken++;
+        }
+    }
+    assert(taken == N);
+    assert(d.len == 0 && d.off == 0);
+    cow1_decoder_reset(&d);
+    free(burst); free(one);
+}
+
 static void test_limits_validation(void){
     /* Сконструируем руками повреждённый буфер: верно всё, кроме tag_len > COW1_MAX_TAG */
     ConOp in = make_op_basic();
@@ -106,6 +150,7 @@ static void test_limits_validation(void){
     {
         /* просчитаем offset вручную аналогично encode() */
         size_t off = 4 /* prefix */ + 4 /* magic */ + 2 /* ver */ +
+            8 + 8 /* topic */ + 4 /* schema */ +
             2 /* type */ + 8 + 8 + 4 + 8 + 4 + 8 + 4 + 8 + 8 + 8 +
             (1 + (size_t)CON_POS_MAX_DEPTH*(2+4)) + 8 + 4 + 4;
         pos_tag_len = off;
@@ -122,10 +167,142 @@ static void test_limits_validation(void){
     free(buf);
 }
 
+/* Кодирование в заданной версии в свежий буфер */
+static uint8_t* encode_ver(const ConOp* op, uint16_t ver, size_t* out_len){
+    size_t len = conop_wire_encoded_size_ver(op, ver);
+    assert(len > 0);
+    uint8_t* buf = (uint8_t*)malloc(len);
+    assert(conop_wire_encode_into_ver(op, ver, buf, len) == len);
+    *out_len = len;
+    return buf;
+}
+
+static void assert_same_op(const ConOp* a, const ConOp* b){
+    assert(a->topic.type_id == b->topic.type_id && a->topic.inst_id == b->topic.inst_id);
+    assert(a->schema == b->schema && a->type == b->type);
+    assert(a->console_id == b->console_id && a->op_id == b->op_id);
+    assert(a->actor_id == b->actor_id && a->hlc == b->hlc && a->user_id == b->user_id);
+    assert(a->widget_id == b->widget_id && a->widget_kind == b->widget_kind);
+    assert(a->new_item_id == b->new_item_id);
+    assert(a->parent_left == b->parent_left && a->parent_right == b->parent_right);
+    assert(a->pos.depth == b->pos.depth);
+    for (int i=0;i<a->pos.depth;i++){
+        assert(a->pos.comp[i].digit == b->pos.comp[i].digit);
+        assert(a->pos.comp[i].actor == b->pos.comp[i].actor);
+    }
+    assert(a->init_hash == b->init_hash);
+    assert(a->prompt_edits_inc == b->prompt_edits_inc && a->prompt_nonempty == b->prompt_nonempty);
+    assert((a->tag == NULL) == (b->tag == NULL));
+    if (a->tag) assert(strcmp(a->tag, b->tag)==0);
+    assert(a->size == b->size && (!a->size || memcmp(a->data, b->data, a->size)==0));
+    assert(a->init_size == b->init_size && (!a->init_size || memcmp(a->init_blob, b->init_blob, a->init_size)==0));
+}
+
+/* v1 и v2 дают одинаковый ConOp; v2 заметно компактнее */
+static void test_versions_roundtrip(void){
+    ConOp ops[3];
+    ops[0] = make_op_basic();
+    /* широкие значения, отрицательные int'ы, полная глубина pos, init */
+    ops[1] = make_op_basic();
+    ops[1].type = CON_OP_INSERT_WIDGET; ops[1].widget_kind = 7; ops[1].widget_id = UINT64_MAX;
+    ops[1].hlc = 0x8000000000000001ull; ops[1].user_id = -5; ops[1].schema = 3;
+    ops[1].topic.type_id = 9; ops[1].topic.inst_id = 77;
+    ops[1].pos.depth = CON_POS_MAX_DEPTH;
+    for (int i=0;i<CON_POS_MAX_DEPTH;i++){ ops[1].pos.comp[i].digit = (uint16_t)(65535 - i); ops[1].pos.comp[i].actor = 0xFFFFFFF0u + (uint32_t)i; }
+    ops[1].init_hash = 0xDEADBEEFCAFEF00Dull; ops[1].init_blob = "\x01\x02\x03"; ops[1].init_size = 3;
+    ops[1].tag = NULL; ops[1].data = NULL; ops[1].size = 0;
+    /* нажатие клавиши в промпте */
+    memset(&ops[2], 0, sizeof(ops[2]));
+    ops[2].type = CON_OP_PROMPT_META; ops[2].console_id = 42; ops[2].user_id = 3;
+    ops[2].op_id = 1001; ops[2].actor_id = 0x1234; ops[2].hlc = 1700000000000ull << 16;
+    ops[2].prompt_edits_inc = -1; ops[2].prompt_nonempty = 1;
+
+    for (int k=0;k<3;k++){
+        size_t l1 = 0, l2 = 0;
+        uint8_t* f1 = encode_ver(&ops[k], CONOP_WIRE_VERSION, &l1);
+        uint8_t* f2 = encode_ver(&ops[k], CONOP_WIRE_VERSION_2, &l2);
+        assert(l2 < l1);
+        /* копирующий декодер понимает обе версии */
+        ConOp o1, o2; char* tag=NULL; void* data=NULL; size_t dlen=0; void* init=NULL; size_t ilen=0;
+        assert(conop_wire_decode(f1, l1, &o1, &tag, &data, &dlen, &init, &ilen) == 0);
+        assert(conop_wire_decode_view(f2, l2, &o2) == 0); /* view портит кадр — он последний */
+        assert_same_op(&o1, &o2);
+        assert(o2.op_id == ops[k].op_id && o2.user_id == ops[k].user_id);
+        assert(o2.pos.depth == ops[k].pos.depth);
+        conop_wire_free_decoded(tag, data, init);
+        /* любое усечение v2-кадра отвергается */
+        uint8_t* g = encode_ver(&ops[k], CONOP_WIRE_VERSION_2, &l2);
+        for (size_t cut = 1; cut < l2 - 4; cut++){
+            uint32_t fl = (uint32_t)(l2 - 4 - cut);
+            uint8_t* t = (uint8_t*)malloc(l2 - cut);
+            memcpy(t, g, l2 - cut);
+            t[0] = (uint8_t)fl; t[1] = (uint8_t)(fl >> 8); t[2] = (uint8_t)(fl >> 16); t[3] = (uint8_t)(fl >> 24);
+            ConOp bad;
+            assert(conop_wire_decode_view(t, l2 - cut, &bad) != 0);
+            free(t);
+        }
+        free(g);
+        free(f1); free(f2);
+    }
+    /* PROMPT_META: десятки байт вместо ~200 */
+    size_t l2 = conop_wire_encoded_size_ver(&ops[2], CONOP_WIRE_VERSION_2);
+    assert(l2 <= 32);
+    assert(conop_wire_encoded_size_ver(&ops[2], 3) == 0);
+
+    /* varint шире поля не усекается: digit = 65536 (тот же размер, что 65535) — отказ */
+    ConOp wide; memset(&wide, 0, sizeof(wide));
+    wide.type = CON_OP_INSERT_TEXT; wide.console_id = 42;
+    wide.pos.depth = 1; wide.pos.comp[0].digit = 65535; wide.pos.comp[0].actor = 1;
+    size_t lw = 0;
+    uint8_t* fw = encode_ver(&wide, CONOP_WIRE_VERSION_2, &lw);
+    static const uint8_t d65535[] = { 1, 0xFF, 0xFF, 0x03, 1 };
+    uint8_t* at = NULL;
+    for (size_t i = 0; i + sizeof(d65535) <= lw; i++) if (!memcmp(fw + i, d65535, sizeof(d65535))){ at = fw + i; break; }
+    assert(at);
+    ConOp ok;
+    uint8_t* fw2 = (uint8_t*)malloc(lw); memcpy(fw2, fw, lw);
+    assert(conop_wire_decode_view(fw2, lw, &ok) == 0 && ok.pos.comp[0].digit == 65535);
+    at[1] = 0x80; at[2] = 0x80; at[3] = 0x04;
+    assert(conop_wire_decode_view(fw, lw, &ok) != 0);
+    free(fw); free(fw2);
+
+    /* поток из вперемешку v1/v2 кадров */
+    Cow1Decoder d; cow1_decoder_init(&d);
+    for (int k=0;k<6;k++){
+        size_t l = 0;
+        uint8_t* f = encode_ver(&ops[k % 3], (k & 1) ? CONOP_WIRE_VERSION_2 : CONOP_WIRE_VERSION, &l);
+        cow1_decoder_consume(&d, f, l);
+        free(f);
+    }
+    for (int k=0;k<6;k++){
+        ConOp out;
+        assert(cow1_decoder_take_view(&d, &out) == 1);
+        assert(out.op_id == ops[k % 3].op_id && out.type == ops[k % 3].type);
+    }
+    cow1_decoder_reset(&d);
+}
+
+static void test_encode_into(void){
+    ConOp in = make_op_basic();
+    uint8_t* buf = NULL; size_t len = 0;
+    assert(conop_wire_encode(&in, &buf, &len) == 0);
+    assert(conop_wire_encoded_size(&in) == len);
+    uint8_t dst[1024];
+    assert(len <= sizeof(dst));
+    assert(conop_wire_encode_into(&in, dst, len - 1) == 0); /* мало места */
+    assert(conop_wire_encode_into(&in, dst, sizeof(dst)) == len);
+    assert(memcmp(dst, buf, len) == 0);
+    free(buf);
+}
+
 int main(void){
     test_roundtrip();
+    test_encode_into();
+    test_streaming_view();
+    test_tiny_frame();
+    test_versions_roundtrip();
     test_streaming_chunks();
     test_limits_validation();
-    printf("OK: conop_wire roundtrip + streaming + limits\n");
+    printf("OK: conop_wire roundtrip (v1/v2) + streaming + limits\n");
     return 0;
 }
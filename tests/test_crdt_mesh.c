@@ -0,0 +1,190 @@
+// tests/test_crdt_mesh.c
+/* Внутренности mesh (окно вектора версий) проверяем напрямую — берём static'и
+   из самого crdt_mesh.c */
+#include "replication/backends/crdt_mesh.c"
+#include <assert.h>
+#include <stdio.h>
+#if defined(_WIN32)
+#  include <winsock2.h>
+#  define SHUT_RDWR SD_BOTH
+#else
+#  include <sys/socket.h>
+#endif
+
+enum { W = CRDT_VV_WINDOW };
+
+static ConOp vop(uint32_t actor, uint64_t seq){
+    ConOp op = {0};
+    op.console_id = 5; op.actor_id = actor;
+    op.op_id = ((uint64_t)actor << 32) | seq;
+    return op;
+}
+static int mark(CrdtMesh* r, uint32_t actor, uint64_t seq, int local){
+    ConOp op = vop(actor, seq);
+    return vv_test_and_mark(r, &op, local);
+}
+static int win_bit(const VvEnt* e, uint64_t d){ return (int)((e->win[d/64] >> (d%64)) & 1u); }
+
+/* vv_shift: сдвиг окна через границу слова и на всё окно */
+static void test_vv_shift(void){
+    VvEnt e; memset(&e, 0, sizeof(e));
+    e.win[0] = 1ull << 63;   /* seq hi+64 */
+    e.win[1] = 1ull << 1;    /* seq hi+66 */
+    e.win[W/64 - 1] = 1ull << 63;
+    vv_shift(&e, 60);
+    assert(e.hi == 60);
+    assert(win_bit(&e, 3) && win_bit(&e, 5) && win_bit(&e, W - 61));
+    assert(!win_bit(&e, 4) && !win_bit(&e, 63) && !win_bit(&e, W - 1));
+    vv_shift(&e, 64);
+    assert(e.hi == 124 && win_bit(&e, W - 125) && e.win[0] == 0);
+    vv_shift(&e, W);
+    assert(e.hi == 124 + W);
+    for (int i = 0; i < W/64; i++) assert(e.win[i] == 0);
+}
+
+/* Края окна: d=0, d=W-1, d=W */
+static void test_vv_window(void){
+    CrdtMesh* r = calloc(1, sizeof(*r));
+    assert(mark(r, 1, 1, 0) == VV_NEW);                 /* d=0 — сразу в hi */
+    VvEnt* e = vv_get(r, 5, 1, 0);
+    assert(e && e->hi == 1);
+    assert(mark(r, 1, 1, 0) == VV_SEEN);
+    assert(mark(r, 1, 1 + W, 0) == VV_NEW);             /* d=W-1 — последний бит окна */
+    assert(e->hi == 1 && win_bit(e, W - 1));
+    assert(mark(r, 1, 1 + W, 0) == VV_SEEN);
+    assert(mark(r, 1, 2 + W, 0) == VV_FAR);             /* d=W — за окном: hi не трогаем */
+    assert(e->hi == 1 && r->vv_far == 1 && win_bit(e, W - 1));
+    /* дыры заполнились — непрерывная отметка доходит до конца окна, за ним op принимается */
+    for (uint64_t s = 2; s < 1 + W; s++) assert(mark(r, 1, s, 0) == VV_NEW);
+    assert(e->hi == 1 + W && e->win[0] == 0);
+    assert(mark(r, 1, 2 + W, 0) == VV_NEW && e->hi == 2 + W);
+    /* своя op за окном принимается, но журнал ниже неё пуст — пирам только снапшот */
+    assert(mark(r, 2, 1000, 1) == VV_NEW);
+    e = vv_get(r, 5, 2, 0);
+    assert(e->hi == 1000 - W && win_bit(e, W - 1) && e->evicted == e->hi);
+    free(r->vv); free(r);
+}
+
+/* ===== Два узла по loopback: разрыв, расхождение, повторное подключение ===== */
+enum { MAXSEQ = CRDT_LOG_OPS + 256 };
+typedef struct {
+    uint32_t actor;
+    uint8_t  got[3][MAXSEQ];  /* [актор][seq] — сколько раз op доставлена */
+    int      snaps;
+} Node;
+static NetPoller* g_np;
+static uint32_t   g_now;
+static int        g_snap_calls;
+
+static int  ts_snapshot(void* u, uint32_t* schema, void** blob, size_t* len){
+    (void)u; g_snap_calls++;
+    *schema = 1; *blob = malloc(4); memcpy(*blob, "SNAP", 4); *len = 4;
+    return 0;
+}
+static void ts_apply(void* u, const ConOp* op){ (void)u; (void)op; }
+static const TypeVt TS = { .name = "t", .apply = ts_apply, .snapshot = ts_snapshot };
+
+static void on_confirm(void* u, const ConOp* op){
+    Node* n = (Node*)u;
+    if (op->op_id == 0){ if (op->init_blob) n->snaps++; return; }
+    uint64_t seq = op->op_id & 0xFFFFFFFFull;
+    assert(op->actor_id >= 1 && op->actor_id <= 2 && seq < MAXSEQ);
+    n->got[op->actor_id][seq]++;
+}
+static void spin(int ticks){
+    for (int i = 0; i < ticks; i++){ net_poller_tick(g_np, ++g_now, 1); cow1tcp_flush_pending(); }
+}
+static void pub(Replicator* r, uint32_t actor, uint32_t* seq, int n){
+    for (int i = 0; i < n; i++){
+        ConOp op = {0};
+        op.topic = (TopicId){ 1, 77 }; op.console_id = 77; op.actor_id = actor;
+        op.op_id = ((uint64_t)actor << 32) | ++*seq;
+        /* каждая пятая — PROMPT_META: её повторное применение не идемпотентно */
+        op.type = (*seq % 5 == 0) ? CON_OP_PROMPT_META : CON_OP_INSERT_TEXT;
+        if (op.type == CON_OP_INSERT_TEXT){ op.data = "x"; op.size = 1; }
+        replicator_publish(r, &op);
+    }
+}
+/* Каждая op обоих акторов до seq[actor] доставлена ровно один раз */
+static void check_once(const Node* n, const uint32_t* seq){
+    for (uint32_t a = 1; a <= 2; a++)
+        for (uint32_t s = 1; s <= seq[a]; s++) assert(n->got[a][s] == 1);
+}
+/* Разрыв: сокеты B закрываются на запись и чтение — оба узла замечают закрытие
+   и убирают пира из списка (повторное подключение идёт новым пиром) */
+static void cut(Replicator* b, Replicator* a){
+    CrdtMesh *mb = (CrdtMesh*)b->impl, *ma = (CrdtMesh*)a->impl;
+    for (int i = 0; i < mb->pn; i++) shutdown((tcp_fd_t)mb->peers[i]->fd, SHUT_RDWR);
+    for (int i = 0; i < 3000 && (mb->pn || ma->pn); i++) spin(1);
+    assert(mb->pn == 0 && ma->pn == 0);
+    int peers = -1;
+    repl_crdt_mesh_stat(b, &peers, NULL, NULL);
+    assert(peers == 0 && replicator_health(b) != 0);
+}
+
+static void test_anti_entropy(void){
+    tcp_init();
+    g_np = net_poller_create();
+    type_registry_register_default(1, &TS, NULL);
+    static Node na = { .actor = 1 }, nb = { .actor = 2 };
+    TopicId t = { 1, 77 };
+    Replicator* A = NULL; uint16_t port = 0;
+    for (port = 47611; port < 47631 && !A; port++){
+        A = replicator_create_crdt_mesh(g_np, port, NULL, 0);
+        if (A && (intptr_t)((CrdtMesh*)A->impl)->listen_fd < 0){ replicator_destroy(A); A = NULL; }
+    }
+    assert(A);
+    char seed[32]; snprintf(seed, sizeof(seed), "127.0.0.1:%u", (unsigned)(port - 1));
+    replicator_set_listener(A, t, on_confirm, &na);
+    const char* seeds[1] = { seed };
+    Replicator* B = replicator_create_crdt_mesh(g_np, 0, seeds, 1);
+    replicator_set_listener(B, t, on_confirm, &nb);
+    spin(100);
+    CrdtMesh *a = A->impl, *b = B->impl;
+    /* базы свелись одним снапшотом */
+    assert(a->pn == 1 && b->pn == 1 && a->topics[0].base == b->topics[0].base);
+    assert(g_snap_calls == 1 && na.snaps + nb.snaps == 1);
+
+    uint32_t seq[3] = { 0, 0, 0 };
+    pub(A, 1, &seq[1], 100); pub(B, 2, &seq[2], 50); spin(50);
+    check_once(&na, seq); check_once(&nb, seq);
+
+    /* разрыв и расхождение: после переподключения — журналом, без снапшотов */
+    cut(B, A);
+    pub(A, 1, &seq[1], 30); pub(B, 2, &seq[2], 20); spin(20);
+    assert(na.got[2][seq[2]] == 0 && nb.got[1][seq[1]] == 0);
+    assert(repl_crdt_mesh_seed_add(B, seed) == 0); spin(100);
+    assert(a->pn == 1 && b->pn == 1);
+    check_once(&na, seq); check_once(&nb, seq);
+    assert(g_snap_calls == 1 && a->ae_delta_ops == 30 && b->ae_delta_ops == 20);
+
+    /* журнал A обрезан ниже того, что знает B, — B получает снапшот; свои op,
+       которых в снапшоте нет, B заново не применяет, A получает их журналом */
+    cut(B, A);
+    uint32_t known = seq[1];
+    pub(A, 1, &seq[1], CRDT_LOG_OPS + 10); pub(B, 2, &seq[2], 7); spin(20);
+    int snaps_b = nb.snaps;
+    assert(repl_crdt_mesh_seed_add(B, seed) == 0); spin(200);
+    assert(g_snap_calls == 2 && nb.snaps == snaps_b + 1);
+    for (uint32_t s = 1; s <= seq[2]; s++) assert(nb.got[2][s] == 1 && na.got[2][s] == 1);
+    /* op A, пришедшие снапшотом, по одной не доставляются, но и не ждутся */
+    for (uint32_t s = known + 1; s <= seq[1]; s++) assert(nb.got[1][s] == 0);
+    VvEnt* v = vv_get(b, 77, 1, 0);
+    assert(v && v->hi == seq[1]);
+    /* дальше — снова поштучно (ждём с запасом: потерянный loopback'ом сегмент
+       TCP повторит только через RTO) */
+    pub(A, 1, &seq[1], 3);
+    for (int i = 0; i < 3000 && !nb.got[1][seq[1]]; i++) spin(1);
+    for (uint32_t s = seq[1] - 2; s <= seq[1]; s++) assert(nb.got[1][s] == 1);
+
+    replicator_destroy(B); replicator_destroy(A);
+    net_poller_destroy(g_np);
+}
+
+int main(void){
+    test_vv_shift();
+    test_vv_window();
+    test_anti_entropy();
+    printf("OK: crdt_mesh version vector + anti-entropy\n");
+    return 0;
+}
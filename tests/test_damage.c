@@ -0,0 +1,93 @@
+// tests/test_damage.c
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/damage.h"
+
+/* Маленький экран, чтобы сверять покрытие попиксельно */
+#define SW 320
+#define SH 200
+
+static unsigned char want[SH][SW];
+
+static void mark(Rect r){
+    for (int y=r.y; y<r.y+r.h; y++) for (int x=r.x; x<r.x+r.w; x++)
+        if (x>=0 && y>=0 && x<SW && y<SH) want[y][x] = 1;
+}
+
+/* Выдача: ≤ MAX_DAMAGE, в пределах экрана, без пересечений, покрывает всё добавленное */
+static long long check(DamageList* d){
+    static unsigned char got[SH][SW];
+    memset(got, 0, sizeof(got));
+    int n = damage_count(d);
+    assert(n >= 0 && n <= MAX_DAMAGE);
+    long long area = 0;
+    for (int i=0;i<n;i++){
+        Rect r = damage_at(d, i);
+        assert(r.w > 0 && r.h > 0);
+        assert(r.x >= 0 && r.y >= 0 && r.x + r.w <= SW && r.y + r.h <= SH);
+        for (int y=r.y; y<r.y+r.h; y++) for (int x=r.x; x<r.x+r.w; x++){
+            assert(!got[y][x]);
+            got[y][x] = 1;
+        }
+        area += (long long)r.w * r.h;
+    }
+    for (int y=0;y<SH;y++) for (int x=0;x<SW;x++) if (want[y][x]) assert(got[y][x]);
+    return area;
+}
+
+static void test_merge_and_contain(void){
+    DamageList d; damage_init(&d); damage_set_bounds(&d, SW, SH);
+    memset(want, 0, sizeof(want));
+    /* одно и то же много раз — один rect */
+    for (int i=0;i<100;i++){ Rect r = rect_make(10,10,50,20); damage_add(&d, r); mark(r); }
+    assert(damage_count(&d) == 1);
+    /* соседний по стороне — склеивается */
+    Rect b = rect_make(60,10,30,20); damage_add(&d, b); mark(b);
+    assert(damage_count(&d) == 1);
+    /* вылезающий за экран — обрезается */
+    Rect c = rect_make(-50,150,100,100); damage_add(&d, c); mark(c);
+    assert(check(&d) <= 80*20 + 50*50);
+    damage_clear(&d);
+    assert(damage_count(&d) == 0);
+}
+
+static void test_random_never_drops(void){
+    srand(12345);
+    for (int round=0; round<200; round++){
+        DamageList d; damage_init(&d); damage_set_bounds(&d, SW, SH);
+        memset(want, 0, sizeof(want));
+        int k = 1 + rand() % 300;
+        for (int i=0;i<k;i++){
+            Rect r = rect_make(rand()%(SW+40) - 20, rand()%(SH+40) - 20, 1 + rand()%60, 1 + rand()%40);
+            damage_add(&d, r); mark(r);
+        }
+        check(&d);
+    }
+}
+
+/* Без границ плиток нет — но и потерь нет */
+static void test_unbounded(void){
+    DamageList d; damage_init(&d);
+    memset(want, 0, sizeof(want));
+    for (int i=0;i<500;i++){
+        Rect r = rect_make((i*37)%SW, (i*53)%SH, 3, 3);
+        damage_add(&d, r); mark(r);
+    }
+    int n = damage_count(&d);
+    assert(n >= 1 && n <= MAX_DAMAGE);
+    for (int y=0;y<SH;y++) for (int x=0;x<SW;x++) if (want[y][x]){
+        int hit = 0;
+        for (int i=0;i<n && !hit;i++){ Rect r = damage_at(&d, i); hit = x>=r.x && y>=r.y && x<r.x+r.w && y<r.y+r.h; }
+        assert(hit);
+    }
+}
+
+int main(void){
+    test_merge_and_contain();
+    test_random_never_drops();
+    test_unbounded();
+    printf("OK: damage coalescing\n");
+    return 0;
+}
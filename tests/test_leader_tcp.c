@@ -0,0 +1,140 @@
+// tests/test_leader_tcp.c
+/* Лидер по loopback: медленный клиент догоняется журналом с c->sent. Очередь
+   клиента у лидера берём static'ами прямо из leader_tcp.c */
+/* журнал поменьше: op больше него кодек ещё пропускает (COW1_MAX_INIT) */
+#define LEADER_LOG_BYTES (512u * 1024u)
+#include "replication/backends/leader_tcp.c"
+#include "replication/backends/client_tcp.h"
+#include <assert.h>
+#include <stdio.h>
+
+enum { CID = 77, NOPS = 300 };
+static NetPoller* g_np;
+static uint32_t   g_now;
+
+/* Клиентский слушатель: op идут подряд и по одному разу */
+static uint64_t g_next = 1;
+static void on_client(void* u, const ConOp* op){
+    (void)u;
+    assert(op->op_id == g_next);
+    g_next++;
+}
+
+/* С реальным временем в poll: потерянный loopback'ом сегмент TCP повторит через RTO */
+static void spin(int ticks){
+    for (int i = 0; i < ticks; i++){ net_poller_tick(g_np, ++g_now, 1); cow1tcp_flush_pending(); }
+}
+
+static void test_catch_up(void){
+    g_np = net_poller_create(); g_now = 1;
+    Replicator* L = NULL; uint16_t port;
+    for (port = 47691; port < 47711 && !L; port++) L = replicator_create_leader_tcp(g_np, CID, port);
+    assert(L);
+    spin(1);
+    Replicator* R = replicator_create_client_tcp(g_np, CID, "127.0.0.1", (uint16_t)(port - 1));
+    replicator_set_listener(R, (TopicId){ 1, CID }, on_client, NULL);
+    for (int i = 0; i < 3000 && !repl_client_tcp_is_connected(R); i++) spin(1);
+    assert(repl_client_tcp_is_connected(R));
+    LeaderRepl* r = (LeaderRepl*)L->impl;
+    assert(r->cn == 1);
+    Client* c = r->cl[0];
+    cow1tcp_set_watermarks(c->cow, 4096, 1024);
+
+    static char text[200];
+    memset(text, 'y', sizeof(text));
+    for (uint64_t id = 1; id <= NOPS; id++){
+        ConOp op = {0};
+        op.topic = (TopicId){ 1, CID }; op.console_id = CID; op.actor_id = 9;
+        op.op_id = id; op.type = CON_OP_INSERT_TEXT;
+        op.data = text; op.size = sizeof(text);
+        replicator_publish(L, &op);
+    }
+    /* очередь перевалила high: клиент отстал, поток ему не копится */
+    int lagging = 0; uint64_t lagged = 0;
+    repl_leader_tcp_lag_stat(L, &lagging, &lagged);
+    assert(c->lagging && lagging == 1 && lagged == 1);
+    assert(c->sent > 0 && c->sent < 40 && cow1tcp_queued(c->cow) >= 4096);
+    uint64_t sent0 = c->sent;
+
+    /* очередь стекает — лидер досылает журналом с c->sent, пока клиент не догонит */
+    for (int i = 0; i < 3000 && g_next <= NOPS; i++) spin(1);
+    assert(g_next == NOPS + 1 && c->sent == NOPS && !c->lagging && !c->dead);
+    uint64_t replayed = 0, snaps = 0;
+    repl_leader_tcp_stat(L, NULL, NULL, &replayed, &snaps);
+    assert(replayed == NOPS - sent0 && snaps == 0);
+    assert(repl_client_tcp_last_seq(R) == NOPS);
+
+    /* негодное соединение закрывается таймером после раздачи событий; клиент возвращается сам */
+    client_kill(r, c);
+    assert(r->cn == 1);
+    spin(1);
+    assert(r->cn == 0);
+    uint64_t reconn = 0;
+    for (int i = 0; i < 3000 && !reconn; i++){ spin(1); repl_client_tcp_stat(R, NULL, NULL, NULL, &reconn); }
+    assert(reconn == 1 && r->cn == 1 && repl_client_tcp_last_seq(R) == NOPS);
+
+    replicator_destroy(R); replicator_destroy(L);
+    net_poller_destroy(g_np);
+}
+
+/* Клиентский слушатель для дыр в журнале: сколько op пришло поштучно */
+static int g_got;
+static void on_count(void* u, const ConOp* op){ (void)u; (void)op; g_got++; }
+
+static void publish(Replicator* L, uint64_t id, size_t dlen, size_t ilen){
+    static char big[600 * 1024];
+    ConOp op = {0};
+    op.topic = (TopicId){ 1, CID }; op.console_id = CID; op.actor_id = 9;
+    op.op_id = id; op.type = CON_OP_INSERT_TEXT;
+    op.data = big; op.size = dlen;
+    op.init_blob = ilen ? big : NULL; op.init_size = ilen;
+    replicator_publish(L, &op);
+}
+
+/* Op больше журнала в него не попала (evicted = её seq), затем вытесняется более
+   ранняя: evicted назад не идёт, и клиент с позицией до дыры получает снапшот, а
+   не журнал без пропавшего seq */
+static void test_evict_gap(void){
+    g_np = net_poller_create(); g_now = 1;
+    Replicator* L = NULL; uint16_t port;
+    for (port = 47711; port < 47731 && !L; port++) L = replicator_create_leader_tcp(g_np, CID, port);
+    assert(L);
+    spin(1);
+    LeaderRepl* r = (LeaderRepl*)L->impl;
+    Replicator* R = replicator_create_client_tcp(g_np, CID, "127.0.0.1", (uint16_t)(port - 1));
+    replicator_set_listener(R, (TopicId){ 1, CID }, on_count, NULL);
+    for (int i = 0; i < 3000 && !repl_client_tcp_is_connected(R); i++) spin(1);
+    assert(repl_client_tcp_is_connected(R));
+
+    publish(L, 1, 100 * 1024, 0);
+    for (int i = 0; i < 3000 && !g_got; i++) spin(1);
+    assert(g_got == 1 && repl_client_tcp_last_seq(R) == 1);
+    repl_client_tcp_disconnect(R);
+    for (int i = 0; i < 3000 && r->cn; i++) spin(1);
+    assert(r->cn == 0);
+
+    publish(L, 2, 0, LEADER_LOG_BYTES + 1024);
+    assert(r->seq == 2 && r->evicted == 2 && r->llen == 1);
+    /* третья крупная вытесняет seq 1 */
+    for (uint64_t id = 3; id <= 5; id++) publish(L, id, 160 * 1024, 0);
+    assert(r->log[r->lhead].seq == 3 && r->evicted == 2);
+
+    uint64_t snaps0 = 0, snaps = 0;
+    repl_leader_tcp_stat(L, NULL, NULL, NULL, &snaps0);
+    assert(repl_client_tcp_connect(R, "127.0.0.1", (uint16_t)(port - 1)) == 0);
+    for (int i = 0; i < 3000 && repl_client_tcp_last_seq(R) != r->seq; i++) spin(1);
+    repl_leader_tcp_stat(L, NULL, NULL, NULL, &snaps);
+    /* снапшот без зарегистрированного типа — только перенос seq; поштучно ничего */
+    assert(snaps == snaps0 + 1 && g_got == 1 && repl_client_tcp_last_seq(R) == 5);
+
+    replicator_destroy(R); replicator_destroy(L);
+    net_poller_destroy(g_np);
+}
+
+int main(void){
+    tcp_init();
+    test_catch_up();
+    test_evict_gap();
+    printf("OK: leader_tcp catch-up + eviction gap\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+// tests/test_pixops.c
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gfx/pixops.h"
+
+#define N 300
+
+static uint32_t rnd32(void){ return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+
+/* Пиксель с «интересной» альфой: 0 и 255 чаще, чтобы ловить быстрые пути */
+static uint32_t rnd_px(void){
+    uint32_t p = rnd32() & 0x00FFFFFFu, a;
+    switch (rand() % 4){
+    case 0:  a = 0;   break;
+    case 1:  a = 255; break;
+    default: a = (uint32_t)(rand() & 0xFF);
+    }
+    return p | a << 24;
+}
+
+/* Эталонные значения формулы смешивания */
+static void test_blend_reference(void){
+    pixops_set_isa(PIXOPS_SCALAR);
+    uint32_t d = 0xFF000000u, s = 0x80FFFFFFu;
+    pixops_blend(&d, &s, 1);
+    assert(d == 0xFF808080u);
+    d = 0x00000000u; s = 0x80FF0000u;
+    pixops_blend(&d, &s, 1);
+    assert(d == 0x80800000u);
+    d = 0x12345678u; s = 0x00FFFFFFu;
+    pixops_blend(&d, &s, 1);
+    assert(d == 0x12345678u);
+    s = 0xFFABCDEFu;
+    pixops_blend(&d, &s, 1);
+    assert(d == 0xFFABCDEFu);
+}
+
+/* Все доступные реализации совпадают со скаляром бит-в-бит — на любых длинах и смещениях */
+static void test_isa_match(void){
+    PixopsIsa best = pixops_set_isa(PIXOPS_AVX2); /* максимум доступного */
+    static uint32_t src[N + 8], dst0[N + 8], ref[N + 8], got[N + 8];
+    for (int round = 0; round < 200; round++){
+        for (int i = 0; i < N + 8; i++){ src[i] = rnd_px(); dst0[i] = rnd_px(); }
+        size_t off = (size_t)(rand() % 8), n = (size_t)(rand() % (N - 8));
+        uint32_t col = rnd32();
+        for (int isa = PIXOPS_SSE2; isa <= (int)best; isa++){
+            /* blend */
+            pixops_set_isa(PIXOPS_SCALAR);
+            memcpy(ref, dst0, sizeof(ref)); pixops_blend(ref + off, src, n);
+            pixops_set_isa((PixopsIsa)isa);
+            memcpy(got, dst0, sizeof(got)); pixops_blend(got + off, src, n);
+            assert(memcmp(ref, got, sizeof(ref)) == 0);
+            /* copy */
+            memcpy(got, dst0, sizeof(got)); pixops_copy(got + off, src + 1, n);
+            memcpy(ref, dst0, sizeof(ref)); memcpy(ref + off, src + 1, n * sizeof(uint32_t));
+            assert(memcmp(ref, got, sizeof(ref)) == 0);
+            /* fill */
+            memcpy(got, dst0, sizeof(got)); pixops_fill(got + off, n, col);
+            memcpy(ref, dst0, sizeof(ref)); for (size_t i = 0; i < n; i++) ref[off + i] = col;
+            assert(memcmp(ref, got, sizeof(ref)) == 0);
+        }
+    }
+    pixops_set_isa(best);
+}
+
+/* Маска покрытия: совпадает с pixops_blend по тонированному пикселю и не выходит за клип */
+static void test_blend_mask(void){
+    enum { W = 16, H = 12, MW = 7, MH = 5 };
+    static uint32_t dst[W * H], ref[W * H];
+    static uint8_t cov[MH * MW];
+    for (int i = 0; i < MH * MW; i++) cov[i] = (uint8_t)(i * 37 % 256);
+    cov[0] = 255; cov[1] = 0;
+    const uint32_t col = 0xC0336699u;
+    PixopsIsa isa = pixops_isa();
+    /* клип (3,2,8,6); маска торчит за него со всех сторон по очереди */
+    const int cx = 3, cy = 2, cw = 8, ch = 6;
+    const int at[][2] = { { 4, 3 }, { 0, 0 }, { 8, 6 }, { -3, 1 }, { 20, 20 } };
+    for (size_t k = 0; k < sizeof(at) / sizeof(at[0]); k++){
+        for (int i = 0; i < W * H; i++) dst[i] = ref[i] = rnd_px();
+        int mx = at[k][0], my = at[k][1];
+        for (int yy = 0; yy < MH; yy++) for (int xx = 0; xx < MW; xx++){
+            int px = mx + xx, py = my + yy;
+            if (px < cx || py < cy || px >= cx + cw || py >= cy + ch) continue;
+            uint32_t a = ((uint32_t)cov[yy * MW + xx] * (col >> 24) + 127) / 255;
+            uint32_t s = a << 24 | (col & 0x00FFFFFFu);
+            pixops_set_isa(PIXOPS_SCALAR);
+            pixops_blend(&ref[py * W + px], &s, 1);
+        }
+        pixops_blend_mask(dst, W, cx, cy, cw, ch, cov, MW, mx, my, MW, MH, col);
+        assert(memcmp(dst, ref, sizeof(dst)) == 0);
+    }
+    pixops_set_isa(isa);
+}
+
+int main(void){
+    srand(7);
+    test_blend_reference();
+    test_isa_match();
+    test_blend_mask();
+    printf("OK: pixops (%s)\n", pixops_isa_name(pixops_isa()));
+    return 0;
+}
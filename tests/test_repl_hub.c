@@ -1,25 +1,54 @@
 // tests/test_repl_hub.c
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "replication/hub.h"
 #include "replication/repl_iface.h"
 #include "replication/repl_types.h"
 #include "console/replicator.h"
+#include "replication/type_registry.h"
 
 /* TODO:хороший smoke, но не покрывает:
-   - смену здоровья/health → перевыбор бэкенда;
-   - мягкий replhub_switch_backend(...) + доставка буфера;
-   - per-topic required_caps и force_backend.
-   - Я бы добавил второй мини-тест: форс-свитч и проверку, что буфер отправился после разблокировки. */
+   - per-topic required_caps и force_backend. */
 
-typedef struct { int caps, health, publ, listened; ReplicatorConfirmCb cb; void* user; } Fake;
+typedef struct { int caps, health, publ, listened; ReplicatorConfirmCb cb; void* user;
+                 int polls; ReplicatorChangeCb on_change; void* change_user;
+                 uint64_t last_id; int disorder, snaps; } Fake;
 static void fk_destroy(Replicator* r){ free(r->impl); free(r); }
-static void fk_publish(Replicator* r, const ConOp* op){ Fake* f=r->impl; f->publ++; if(f->cb) f->cb(f->user,op); }
+static void fk_publish(Replicator* r, const ConOp* op){
+    Fake* f=r->impl; f->publ++;
+    if (op->init_blob && op->op_id==0) f->snaps++;
+    else if (op->topic.type_id==3){ if (op->op_id != f->last_id+1) f->disorder++; f->last_id = op->op_id; }
+    if(f->cb) f->cb(f->user,op);
+}
 static void fk_set(Replicator* r, TopicId t, ReplicatorConfirmCb cb, void* u){ (void)t; Fake* f=r->impl; f->listened=1; f->cb=cb; f->user=u; }
+static void fk_unset(Replicator* r, TopicId t){ (void)t; Fake* f=r->impl; f->listened=0; f->cb=NULL; }
 static int  fk_caps(Replicator* r){ return ((Fake*)r->impl)->caps; }
-static int  fk_health(Replicator* r){ return ((Fake*)r->impl)->health; }
-static const ReplicatorVt VT = { fk_destroy,fk_publish,fk_set,fk_caps,fk_health };
+static int  fk_health(Replicator* r){ Fake* f=r->impl; f->polls++; return f->health; }
+static void fk_on_change(Replicator* r, ReplicatorChangeCb cb, void* u){ Fake* f=r->impl; f->on_change=cb; f->change_user=u; }
+static const ReplicatorVt VT = { .destroy=fk_destroy, .publish=fk_publish, .set_listener=fk_set, .unset_listener=fk_unset,
+                                 .capabilities=fk_caps, .health=fk_health, .set_on_change=fk_on_change };
 static Replicator* make_fake(int caps,int health){ Fake* f=calloc(1,sizeof* f); f->caps=caps; f->health=health; Replicator* r=calloc(1,sizeof* r); r->v=&VT; r->impl=f; return r; }
+static void fk_set_health(Replicator* r, int health){ Fake* f=r->impl; f->health=health; if(f->on_change) f->on_change(f->change_user, r); }
+
+/* Снапшот типа 3: первый вызов публикует пачку op в хаб — они приходятся на
+   заблокированный маршрут и копятся в буфере свитча */
+static Replicator* g_hub; static int g_burst; static uint64_t g_burst_id;
+static int t3_snapshot(void* u, uint32_t* schema, void** blob, size_t* len){
+    (void)u;
+    for (int n = g_burst; n > 0; n--){
+        static char payload[64];
+        ConOp o = {0}; o.topic = (TopicId){ 3, 7 }; o.op_id = ++g_burst_id; o.tag = "t";
+        o.data = payload; o.size = sizeof(payload);
+        replicator_publish(g_hub, &o);
+    }
+    g_burst = 0;
+    *schema = 1; *blob = malloc(4); memcpy(*blob, "SNAP", 4); *len = 4;
+    return 0;
+}
+static void t3_apply(void* u, const ConOp* op){ (void)u; (void)op; }
+static const TypeVt T3 = { .apply = t3_apply, .snapshot = t3_snapshot };
 
 /* Глобальный счётчик подтверждений для простоты */
 static int g_confirms = 0;
@@ -43,8 +72,54 @@ int main(void){
     assert(((Fake*)leader->impl)->publ == 0);
     assert(g_confirms == 1);
 
+    /* выбор кеширован: health не опрашивается на каждую op */
+    int polls = ((Fake*)leader->impl)->polls;
+    for (int i=0;i<100;i++) replicator_publish(hub, &op);
+    assert(((Fake*)leader->impl)->polls == polls);
+    assert(((Fake*)local->impl)->publ == 101 && g_confirms == 101);
+
+    /* лидер ожил — по уведомлению маршрут и listener переезжают */
+    fk_set_health(leader, 0);
+    replicator_publish(hub, &op);
+    assert(((Fake*)leader->impl)->publ == 1 && ((Fake*)leader->impl)->listened);
+    assert(!((Fake*)local->impl)->listened);
+    assert(replhub_debug_route_backend(hub, t) == 0);
+    assert(g_confirms == 102);
+
+    /* тысячи топиков — таблица растёт */
+    for (uint64_t k=1;k<=5000;k++){ ConOp o = {0}; o.topic = (TopicId){ 2, k }; replicator_publish(hub, &o); }
+    assert(replhub_debug_count_routes(hub) == 5001);
+    assert(replhub_debug_route_backend(hub, (TopicId){ 2, 4321 }) == 0);
+    assert(replhub_debug_route_backend(hub, (TopicId){ 2, 9999 }) == -1);
+    assert(((Fake*)leader->impl)->publ == 5001);
+
+    /* мягкий свитч: op, пришедшие во время свитча, доходят до нового бэкенда по порядку */
+    g_hub = hub;
+    type_registry_register_default(3, &T3, NULL);
+    TopicId t3 = (TopicId){ 3, 7 };
+    Fake* lf = local->impl;
+    int lp = lf->publ;
+    g_burst = 3000;
+    replhub_switch_backend(hub, t3, 1);
+    assert(replhub_debug_route_backend(hub, t3) == 1);
+    assert(lf->publ == lp + 1 + 3000 && lf->snaps == 1 && lf->disorder == 0 && lf->last_id == 3000);
+    /* выбор держится: следующая op — туда же */
+    ConOp o3 = {0}; o3.topic = t3; o3.op_id = ++g_burst_id;
+    replicator_publish(hub, &o3);
+    assert(lf->publ == lp + 3002 && lf->disorder == 0);
+
+    /* переполнение буфера — op отброшены, новому бэкенду уходит второй снапшот */
+    Fake* df = leader->impl;
+    int dp = df->publ, ds = df->snaps;
+    replhub_set_switch_buffer_cap(hub, 4096);
+    g_burst = 1000;
+    replhub_switch_backend(hub, t3, 0);
+    assert(replhub_debug_switch_overflows(hub) == 1);
+    assert(df->snaps == ds + 2 && df->publ == dp + 2);
+
     replicator_destroy(hub);
     replicator_destroy(leader);
     replicator_destroy(local);
+    printf("OK: repl hub routing + cached health + soft switch\n");
     return 0;
 }
@@ -0,0 +1,168 @@
+// tests/test_wire_tcp.c
+/* Cow1Tcp поверх socketpair: пороги очереди и общие кадры. Очередь и её блоки смотрим
+   напрямую — берём static'и из самого wire_tcp.c */
+#include "net/wire_tcp.c"
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static NetPoller* g_np;
+
+typedef struct {
+    uint64_t next;    /* ожидаемый op_id */
+    int      got;
+    int      over[2]; /* сколько раз on_pressure(0/1) */
+} Peer;
+
+static void on_op(void* u, const ConOp* op, const char* tag, const void* d, size_t dl, const void* i, size_t il){
+    (void)tag; (void)d; (void)i; (void)il;
+    Peer* p = (Peer*)u;
+    assert(op->op_id == p->next && dl == op->size);
+    for (size_t k = 0; k < dl; k++) assert(((const char*)d)[k] == 'a' + (int)(op->op_id % 26));
+    p->next++; p->got++;
+}
+static void on_pressure(void* u, int over){ ((Peer*)u)->over[over ? 1 : 0]++; }
+
+static ConOp mk(uint64_t id, size_t len){
+    static char buf[4096];
+    memset(buf, 'a' + (int)(id % 26), sizeof(buf));
+    ConOp op = {0};
+    op.topic = (TopicId){ 1, 7 }; op.console_id = 7;
+    op.type = CON_OP_INSERT_TEXT; op.op_id = id;
+    op.data = buf; op.size = len;
+    return op;
+}
+static void spin(int n){
+    for (int i = 0; i < n; i++){ net_poller_tick(g_np, (uint32_t)i, 0); cow1tcp_flush_pending(); }
+}
+static void pair(Cow1Tcp** a, Peer* pa, Cow1Tcp** b, Peer* pb){
+    int sv[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    net_set_nonblocking(sv[0], 1); net_set_nonblocking(sv[1], 1);
+    *a = cow1tcp_create(g_np, sv[0], on_op, pa);
+    *b = cow1tcp_create(g_np, sv[1], on_op, pb);
+}
+static void unpair(Cow1Tcp* a, Cow1Tcp* b){
+    net_fd_t fa = a->fd, fb = b->fd;
+    cow1tcp_destroy(a); cow1tcp_destroy(b);
+    close(fa); close(fb);
+}
+
+/* Выше high send отвечает 1, on_pressure(1) — один раз, on_pressure(0) — только из сброса */
+static void test_watermarks(void){
+    Peer pa = { .next = 1 }, pb = { .next = 1 };
+    Cow1Tcp *a, *b;
+    pair(&a, &pa, &b, &pb);
+    cow1tcp_set_on_pressure(a, on_pressure);
+    cow1tcp_set_watermarks(a, 4096, 1024);
+    assert(a->hi_wm == 4096 && a->lo_wm == 1024);
+
+    Cow1TcpStats s0; cow1tcp_stats(&s0);
+    uint64_t id = 1;
+    int rc;
+    for (;;){
+        ConOp op = mk(id, 200);
+        if ((rc = cow1tcp_send(a, &op)) != 0) break;
+        id++;
+    }
+    /* кадр, на котором перевалили high, принят; следующий — нет */
+    assert(rc == 1 && a->over && pa.over[1] == 1 && pa.over[0] == 0);
+    assert(cow1tcp_queued(a) >= 4096 && cow1tcp_queued(a) < 4096 + 300);
+    ConOp more = mk(id, 200);
+    assert(cow1tcp_send(a, &more) == 1 && pa.over[1] == 1 && pa.over[0] == 0);
+    Cow1TcpStats s1; cow1tcp_stats(&s1);
+    assert(s1.tx_refused - s0.tx_refused == 2);
+
+    /* сброс в сокет: очередь стекла до low — on_pressure(0) */
+    spin(1);
+    assert(!a->over && pa.over[0] == 1 && cow1tcp_queued(a) == 0);
+    spin(5);
+    assert(pb.got == (int)(id - 1));
+    /* снова принимает, с того же места */
+    assert(cow1tcp_send(a, &more) == 0);
+    spin(5);
+    assert(pb.got == (int)id);
+
+    /* low ≥ high — low = high/2 */
+    cow1tcp_set_watermarks(a, 1000, 5000);
+    assert(a->hi_wm == 1000 && a->lo_wm == 500);
+    unpair(a, b);
+}
+
+/* Общий кадр на N соединений: ссылки считаются, каждый peer декодирует ровно то,
+   что поставлено, вперемешку с кадрами-копиями и обычным send */
+enum { NC = 4, NF = 60 };
+static void test_shared_frames(void){
+    Peer pa[NC], pb[NC];
+    Cow1Tcp *a[NC], *b[NC];
+    for (int i = 0; i < NC; i++){
+        pa[i] = (Peer){ .next = 1 }; pb[i] = (Peer){ .next = 1 };
+        pair(&a[i], &pa[i], &b[i], &pb[i]);
+    }
+    /* маленький буфер отправки — sendmsg рвёт очередь посреди блоков */
+    int sb = 4096;
+    setsockopt(a[0]->fd, SOL_SOCKET, SO_SNDBUF, &sb, sizeof(sb));
+
+    Cow1TcpStats s0; cow1tcp_stats(&s0);
+    Cow1TcpFrame* keep[NF] = {0};
+    for (uint64_t id = 1; id <= NF; id++){
+        /* каждая третья — через cow1tcp_send, остальные — общим кадром: мелкий
+           копируется в хвост, крупный встаёт ссылкой */
+        size_t len = id % 3 == 0 ? 300 : (id % 3 == 1 ? 40 : 1500 + id * 37);
+        ConOp op = mk(id, len);
+        if (id % 3 == 0){
+            for (int i = 0; i < NC; i++) assert(cow1tcp_send(a[i], &op) == 0);
+            continue;
+        }
+        Cow1TcpFrame* f = cow1tcp_frame_encode(&op, CONOP_WIRE_VERSION);
+        assert(f && f->refs == 1);
+        for (int i = 0; i < NC; i++) assert(cow1tcp_send_frame(a[i], f) == 0);
+        /* ссылкой стоит только крупный */
+        assert(f->refs == (f->len > COW1TCP_FRAME_COPY_MAX ? 1u + NC : 1u));
+        keep[id - 1] = f;
+    }
+    Cow1TcpStats s1; cow1tcp_stats(&s1);
+    assert(s1.tx_shared - s0.tx_shared == (uint64_t)NC * (NF - NF / 3));
+
+    /* порядок блоков в очереди: за каждой ссылкой — новый блок под копии */
+    int refs = 0, copies = 0, prev_ref = 1;
+    for (const OutBlk* k = a[1]->out.head; k; k = k->next){
+        assert((k->ref != NULL) != prev_ref);
+        prev_ref = k->ref != NULL;
+        if (prev_ref) refs++; else copies++;
+    }
+    assert(refs == NF / 3 && copies == NF / 3 + 1);
+
+    /* выталкиваем a[0] по кусочку: хоть раз голова — блок-ссылка с off посередине */
+    int seen_mid = 0;
+    for (int i = 0; i < 3000 && (pb[0].got < NF || cow1tcp_queued(a[0])); i++){
+        cow1tcp_flush(a[0]);
+        const OutBlk* h = a[0]->out.head;
+        if (h && h->ref && h->off > 0 && h->off < h->len) seen_mid = 1;
+        net_poller_tick(g_np, (uint32_t)i, 0);
+    }
+    assert(seen_mid && pb[0].got == NF);
+    /* остальные — обычным сбросом */
+    for (int i = 0; i < 200 && (pb[1].got + pb[2].got + pb[3].got) < 3 * NF; i++) spin(1);
+    for (int i = 1; i < NC; i++) assert(pb[i].got == NF && cow1tcp_queued(a[i]) == 0);
+    /* всё ушло — у кадров осталась только наша ссылка */
+    for (int k = 0; k < NF; k++) assert(!keep[k] || keep[k]->refs == 1);
+
+    /* кадры в очереди при destroy: outq_free отдаёт их ссылки */
+    for (int k = 0; k < NF; k++) if (keep[k]) for (int i = 0; i < NC; i++) assert(cow1tcp_send_frame(a[i], keep[k]) == 0);
+    for (int k = 0; k < NF; k++) assert(!keep[k] || keep[k]->refs == (keep[k]->len > COW1TCP_FRAME_COPY_MAX ? 1u + NC : 1u));
+    for (int i = 0; i < NC; i++) unpair(a[i], b[i]);
+    for (int k = 0; k < NF; k++){ assert(!keep[k] || keep[k]->refs == 1); cow1tcp_frame_unref(keep[k]); }
+    /* соединений не осталось — пул заголовков пуст */
+    assert(g_conns == 0 && !g_ref_pool && g_ref_pooled == 0);
+}
+
+int main(void){
+    g_np = net_poller_create();
+    test_watermarks();
+    test_shared_frames();
+    net_poller_destroy(g_np);
+    printf("OK: cow1tcp watermarks + shared frames\n");
+    return 0;
+}